@@ -0,0 +1,51 @@
+// Runs every benchmark, or those whose name contains the first argument. The remaining
+// arguments are passed on, eg. the texture directory.
+
+#include "stdafx.h"
+
+#include "Benchmark.h"
+
+namespace
+{
+	volatile uintptr_t g_sink = 0;
+}
+
+namespace dx::bench
+{
+	std::vector<BenchmarkCase>& GetBenchmarks()
+	{
+		static std::vector<BenchmarkCase> benchmarks;
+		return benchmarks;
+	}
+
+	void KeepResult(uintptr_t value)
+	{
+		g_sink = g_sink + value;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	using namespace dx::bench;
+
+	const std::string filter = argc > 1 ? argv[1] : "";
+	const std::vector<std::string> args(argv + std::min(argc, 2), argv + argc);
+	for (const auto& benchmark : GetBenchmarks())
+	{
+		if (std::string_view(benchmark.name).find(filter) == std::string_view::npos)
+		{
+			continue;
+		}
+
+		std::cout << benchmark.name << "\n";
+		try
+		{
+			benchmark.func(args);
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "  failed: " << e.what() << "\n";
+		}
+	}
+	return 0;
+}
\ No newline at end of file
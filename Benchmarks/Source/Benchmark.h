@@ -0,0 +1,49 @@
+#pragma once
+
+// Minimal benchmark harness. BENCHMARK defines a case that main runs with the command line
+// arguments, and Measure times repeated runs of the code under test. Build in Release.
+namespace dx::bench
+{
+	using BenchmarkFunc = void (*)(const std::vector<std::string>& args);
+
+	struct BenchmarkCase
+	{
+		const char* name;
+		BenchmarkFunc func;
+	};
+
+	std::vector<BenchmarkCase>& GetBenchmarks();
+
+	struct Registrar
+	{
+		Registrar(const char* name, BenchmarkFunc func)
+		{
+			GetBenchmarks().push_back({ name, func });
+		}
+	};
+
+	// Stores a value where the compiler cannot see it unused, so the work producing it is kept
+	void KeepResult(uintptr_t value);
+
+	// Runs fn once to warm caches, then repetitions more times, and returns the median run in
+	// milliseconds
+	template<typename F>
+	double Measure(int repetitions, F&& fn)
+	{
+		fn();
+		std::vector<double> times;
+		for (int i = 0; i < repetitions; i++)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			fn();
+			times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+		return times[times.size() / 2];
+	}
+}
+
+#define BENCHMARK(name) \
+	static void name(const std::vector<std::string>& args); \
+	static const dx::bench::Registrar name##Registrar(#name, name); \
+	static void name([[maybe_unused]] const std::vector<std::string>& args)
\ No newline at end of file
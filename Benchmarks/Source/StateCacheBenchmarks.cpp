@@ -0,0 +1,111 @@
+#include "stdafx.h"
+
+#include "Benchmark.h"
+#include "Util.h"
+#include "ResourceCache.h"
+#include "FlatHashMap.h"
+
+using namespace dx;
+
+namespace
+{
+	constexpr int LOOKUPS = 1'000'000;
+	constexpr int REPETITIONS = 5;
+
+	// The keying the state caches used before descriptions were hashed directly: every byte of
+	// the description streamed into a string, which the map then hashes again
+	template<typename T>
+	std::string CreateStreamedKey(const T& desc)
+	{
+		std::array<unsigned char, sizeof(T)> bytes{};
+		memcpy(bytes.data(), &desc, sizeof(T));
+		std::stringstream ss;
+		for (const auto& byte : bytes)
+		{
+			ss << byte;
+		}
+		return ss.str();
+	}
+
+	// A frame's worth of distinct states, zero initialized as the caches require
+	std::vector<D3D11_SAMPLER_DESC> MakeSamplerDescs()
+	{
+		std::vector<D3D11_SAMPLER_DESC> descs;
+		for (auto filter : { D3D11_FILTER_MIN_MAG_MIP_POINT, D3D11_FILTER_MIN_MAG_MIP_LINEAR, D3D11_FILTER_ANISOTROPIC,
+			D3D11_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT })
+		{
+			for (auto address : { D3D11_TEXTURE_ADDRESS_WRAP, D3D11_TEXTURE_ADDRESS_CLAMP })
+			{
+				D3D11_SAMPLER_DESC desc{};
+				desc.Filter = filter;
+				desc.AddressU = desc.AddressV = desc.AddressW = address;
+				desc.MaxAnisotropy = filter == D3D11_FILTER_ANISOTROPIC ? 16 : 1;
+				desc.ComparisonFunc = D3D11_COMPARISON_LESS_EQUAL;
+				desc.MaxLOD = D3D11_FLOAT32_MAX;
+				descs.push_back(desc);
+			}
+		}
+		return descs;
+	}
+
+	std::vector<D3D11_BLEND_DESC> MakeBlendDescs()
+	{
+		std::vector<D3D11_BLEND_DESC> descs;
+		for (BOOL enable : { FALSE, TRUE })
+		{
+			for (auto src : { D3D11_BLEND_ONE, D3D11_BLEND_SRC_ALPHA, D3D11_BLEND_DEST_COLOR, D3D11_BLEND_ZERO })
+			{
+				D3D11_BLEND_DESC desc{};
+				desc.RenderTarget[0].BlendEnable = enable;
+				desc.RenderTarget[0].SrcBlend = src;
+				desc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+				desc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+				desc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+				desc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
+				desc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+				desc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+				descs.push_back(desc);
+			}
+		}
+		return descs;
+	}
+
+	// Looks up every description in turn until LOOKUPS hits, after one miss each. The cached
+	// value stands in for the state object, which would need a device to create.
+	template<typename Key, typename Cache, typename Desc, typename MakeKey>
+	double MeasureLookups(Cache& cache, const std::vector<Desc>& descs, MakeKey makeKey)
+	{
+		auto create = [&]() { return typename Cache::Created{ std::make_shared<int>(0), sizeof(Desc) }; };
+		return bench::Measure(REPETITIONS, [&]()
+			{
+				for (int i = 0; i < LOOKUPS; i++)
+				{
+					const Key key = makeKey(descs[i % descs.size()]);
+					bench::KeepResult(reinterpret_cast<uintptr_t>(cache.GetOrCreate(key, create).get()));
+				}
+			});
+	}
+
+	template<typename Desc>
+	void CompareStateKeys(const char* label, const std::vector<Desc>& descs)
+	{
+		ResourceCache<std::string, std::shared_ptr<int>> streamed("Streamed keys");
+		ResourceCache<Desc, std::shared_ptr<int>, PodHash<Desc>, PodEqual<Desc>, FlatHashMap> hashed("Hashed keys");
+
+		const double streamedMs = MeasureLookups<std::string>(streamed, descs,
+			[](const Desc& desc) { return CreateStreamedKey(desc); });
+		const double hashedMs = MeasureLookups<Desc>(hashed, descs,
+			[](const Desc& desc) { return desc; });
+
+		const double toNs = 1e6 / LOOKUPS;
+		std::cout << "  " << label << " (" << sizeof(Desc) << " bytes, " << descs.size() << " states): "
+			<< "streamed string key " << streamedMs * toNs << " ns, "
+			<< "hashed description " << hashedMs * toNs << " ns per lookup\n";
+	}
+}
+
+BENCHMARK(StateCacheLookup)
+{
+	CompareStateKeys("Sampler", MakeSamplerDescs());
+	CompareStateKeys("Blend", MakeBlendDescs());
+}
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include "stdafx.h"
+
+#include "Benchmark.h"
+#include "MappedFile.h"
+#include "TextureStreamer.h"
+
+using namespace dx;
+using winrt::com_ptr;
+using winrt::check_hresult;
+
+namespace
+{
+	constexpr int REPETITIONS = 5;
+
+	// Textures are created on a device without a window. Falls back to WARP where there is no
+	// hardware device, which is slower but still compares the ways of reading the files.
+	com_ptr<ID3D11Device> CreateDevice()
+	{
+		constexpr D3D_FEATURE_LEVEL level = D3D_FEATURE_LEVEL_11_1;
+
+		com_ptr<ID3D11Device> pDevice;
+		for (auto driverType : { D3D_DRIVER_TYPE_HARDWARE, D3D_DRIVER_TYPE_WARP })
+		{
+			if (SUCCEEDED(D3D11CreateDevice(nullptr, driverType, nullptr, 0, &level, 1, D3D11_SDK_VERSION,
+				pDevice.put(), nullptr, nullptr)))
+			{
+				return pDevice;
+			}
+		}
+		throw std::runtime_error("Could not create a D3D11 device");
+	}
+
+	struct TextureFiles
+	{
+		std::vector<std::string> filenames;
+		uint64_t totalBytes = 0;
+	};
+
+	// Every DDS file under the directory given as the first argument, or under the sample assets
+	TextureFiles FindTextureFiles(const std::vector<std::string>& args)
+	{
+		const std::filesystem::path directory = args.empty() ? "../Graphics/Assets" : args[0];
+
+		TextureFiles files;
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(directory))
+		{
+			if (entry.is_regular_file() && entry.path().extension() == ".dds")
+			{
+				files.filenames.push_back(entry.path().string());
+				files.totalBytes += entry.file_size();
+			}
+		}
+		if (files.filenames.empty())
+		{
+			throw std::runtime_error("No DDS files in " + directory.string());
+		}
+		std::sort(files.filenames.begin(), files.filenames.end());
+		return files;
+	}
+
+	// Each run after the warm-up reads files already in the OS file cache, so the rates compare
+	// the copies and mappings made, not the disk
+	void Report(const char* label, double ms, uint64_t bytes)
+	{
+		std::cout << "  " << label << ": " << ms << " ms, " << bytes / (ms * 1000.0) << " MB/s\n";
+	}
+
+	std::vector<uint8_t> ReadWholeFile(const std::string& filename)
+	{
+		std::ifstream file(filename, std::ios::binary | std::ios::ate);
+		std::vector<uint8_t> data(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(data.data()), data.size());
+		return data;
+	}
+}
+
+// Creates every texture whole, from a heap copy of the file against straight from a mapping
+BENCHMARK(TextureFileLoad)
+{
+	const auto files = FindTextureFiles(args);
+	const auto pDevice = CreateDevice();
+	std::cout << "  " << files.filenames.size() << " files, " << files.totalBytes / 1'000'000 << " MB\n";
+
+	const double readMs = bench::Measure(REPETITIONS, [&]()
+		{
+			for (const auto& filename : files.filenames)
+			{
+				const auto data = ReadWholeFile(filename);
+				const auto pView = CreateTextureFromDDSMemory(pDevice.get(), data.data(), data.size());
+				bench::KeepResult(reinterpret_cast<uintptr_t>(pView.get()));
+			}
+		});
+	Report("Read into memory", readMs, files.totalBytes);
+
+	const double mappedMs = bench::Measure(REPETITIONS, [&]()
+		{
+			for (const auto& filename : files.filenames)
+			{
+				const MappedFile file(filename);
+				const auto pView = CreateTextureFromDDSMemory(pDevice.get(), file.GetData(), file.GetSize());
+				bench::KeepResult(reinterpret_cast<uintptr_t>(pView.get()));
+			}
+		});
+	Report("Memory mapped", mappedMs, files.totalBytes);
+}
+
+// Loads the mip tails of every texture with each streamer read mode. A new streamer per run
+// keeps textures from being shared with the previous run.
+BENCHMARK(TextureStreamerLoad)
+{
+	const auto files = FindTextureFiles(args);
+	const auto pDevice = CreateDevice();
+
+	for (const auto& mode : { std::pair(TextureReadMode::eRead, "Read"),
+		std::pair(TextureReadMode::eMemoryMapped, "Memory mapped") })
+	{
+		uint64_t bytesRead = 0;
+		const double ms = bench::Measure(REPETITIONS, [&]()
+			{
+				TextureStreamer streamer(pDevice.get(), mode.first);
+				bench::KeepResult(streamer.LoadBatch(files.filenames).size());
+				bytesRead = streamer.GetBytesRead();
+			});
+		Report(mode.second, ms, bytesRead);
+	}
+}
+
+// Loads every texture one at a time against as a batch, on one worker and on one per hardware
+// thread. One worker loads the files in turn like Load does, so it separates the cost of the
+// pool from what running the loads in parallel gains.
+BENCHMARK(TextureBatchLoad)
+{
+	const auto files = FindTextureFiles(args);
+	const auto pDevice = CreateDevice();
+
+	uint64_t bytesRead = 0;
+	const double sequentialMs = bench::Measure(REPETITIONS, [&]()
+		{
+			TextureStreamer streamer(pDevice.get());
+			for (const auto& filename : files.filenames)
+			{
+				bench::KeepResult(reinterpret_cast<uintptr_t>(streamer.Load(filename)->GetView()));
+			}
+			bytesRead = streamer.GetBytesRead();
+		});
+	Report("Sequential", sequentialMs, bytesRead);
+
+	for (const auto& threads : { std::pair(1u, "Batch, one thread"), std::pair(0u, "Batch, all threads") })
+	{
+		const double ms = bench::Measure(REPETITIONS, [&]()
+			{
+				TextureStreamer streamer(pDevice.get());
+				bench::KeepResult(streamer.LoadBatch(files.filenames, threads.first).size());
+				bytesRead = streamer.GetBytesRead();
+			});
+		Report(threads.second, ms, bytesRead);
+	}
+}
\ No newline at end of file
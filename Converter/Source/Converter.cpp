@@ -1,6 +1,10 @@
 #include "Converter.h"
+#include "EnvironmentBaker.h"
+#include "TextureContainer.h"
+#include "ParallelFor.h"
 
 #include <winrt/base.h>
+#include <compressapi.h>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -12,6 +16,9 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <mutex>
+#include <unordered_map>
 
 using winrt::check_hresult;
 
@@ -22,6 +29,9 @@ using namespace std::string_literals;
 
 namespace
 {
+	// Set by --compress, writes textures as compressed containers instead of plain DDS files
+	bool g_compressTextures = false;
+
 	struct AssimpTextureInfo
 	{
 		std::filesystem::path baseColor;
@@ -110,20 +120,147 @@ namespace
 		return aiInfo;
 	}
 
+	// A texture to convert once the whole model has been traversed. Jobs run in parallel and
+	// write their progress to log, which is printed in one piece when the job is done.
+	using TextureJob = std::function<void(std::ostream& log, TEX_COMPRESS_FLAGS compressFlags)>;
+
+	// Textures queued for conversion. Each unique combination of source contents and processing
+	// parameters is converted once, and every material using it refers to the same file.
+	struct TextureSet
+	{
+		std::vector<TextureJob> jobs;
+		std::unordered_map<uint64_t, std::string> filenames;	// By content and parameter key
+		std::unordered_map<std::string, uint64_t> fileHashes;	// By source path
+		size_t referenceCount = 0;
+	};
+
+	// Hash of a source image's contents, read once per path. Missing sources hash to zero.
+	uint64_t HashSourceFile(TextureSet* pSet, const std::filesystem::path& path)
+	{
+		if (path.empty())
+		{
+			return 0;
+		}
+		if (auto it = pSet->fileHashes.find(path.string()); it != pSet->fileHashes.end())
+		{
+			return it->second;
+		}
+
+		std::ifstream ifs(path, std::ios::binary);
+		if (!ifs)
+		{
+			throw std::runtime_error("Failed to open texture " + path.string());
+		}
+		const std::string contents((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+		const uint64_t hash = HashString(contents);
+		pSet->fileHashes.emplace(path.string(), hash);
+		return hash;
+	}
+
+	// Finds the file a texture with this key is written to. Returns true if it has not been
+	// queued yet, and the caller should queue the job producing it.
+	bool AddTexture(TextureSet* pSet, const std::string& name, uint64_t key, std::string* pFilename)
+	{
+		pSet->referenceCount++;
+		key = HashString(name, key);
+		key = HashBytes(&g_compressTextures, sizeof(g_compressTextures), key);
+		if (auto it = pSet->filenames.find(key); it != pSet->filenames.end())
+		{
+			*pFilename = it->second;
+			return false;
+		}
+
+		std::array<char, 17> hex{};
+		snprintf(hex.data(), hex.size(), "%016llx", static_cast<unsigned long long>(key));
+		*pFilename = name + hex.data() + (g_compressTextures ? ".ddsz" : ".dds");
+		pSet->filenames.emplace(key, *pFilename);
+		return true;
+	}
+
+	// Writes the DDS file as a chunked compressed container, see TextureContainer.h
+	void SaveToCompressedDDSFile(const ScratchImage& image, const std::filesystem::path& dst, std::ostream& log)
+	{
+		Blob dds;
+		check_hresult(SaveToDDSMemory(image.GetImages(), image.GetImageCount(), image.GetMetadata(),
+			DDS_FLAGS_NONE, dds));
+		const auto* pDDS = static_cast<const uint8_t*>(dds.GetBufferPointer());
+
+		// The images follow the header in the order they are stored in the scratch image
+		size_t pixelSize = 0;
+		for (size_t i = 0; i < image.GetImageCount(); i++)
+		{
+			pixelSize += image.GetImages()[i].slicePitch;
+		}
+		const size_t ddsHeaderSize = dds.GetBufferSize() - pixelSize;
+
+		COMPRESSOR_HANDLE compressor = nullptr;
+		winrt::check_bool(CreateCompressor(COMPRESS_ALGORITHM_XPRESS_HUFF | COMPRESS_RAW, nullptr, &compressor));
+
+		std::vector<ContainerChunk> chunks;
+		std::vector<std::vector<uint8_t>> payloads;
+		size_t dataOffset = ddsHeaderSize;
+		for (size_t i = 0; i < image.GetImageCount(); i++)
+		{
+			const size_t imageEnd = dataOffset + image.GetImages()[i].slicePitch;
+			while (dataOffset < imageEnd)
+			{
+				const size_t size = std::min<size_t>(imageEnd - dataOffset, CONTAINER_CHUNK_SIZE);
+				std::vector<uint8_t> payload(size);
+				SIZE_T compressedSize = 0;
+				if (!Compress(compressor, pDDS + dataOffset, size, payload.data(), payload.size(), &compressedSize) ||
+					compressedSize >= size)
+				{
+					// Incompressible, store as is
+					payload.assign(pDDS + dataOffset, pDDS + dataOffset + size);
+					compressedSize = size;
+				}
+				payload.resize(compressedSize);
+
+				chunks.push_back({ dataOffset, 0, static_cast<uint32_t>(size), static_cast<uint32_t>(compressedSize) });
+				payloads.push_back(std::move(payload));
+				dataOffset += size;
+			}
+		}
+		CloseCompressor(compressor);
+
+		ContainerHeader header{ CONTAINER_MAGIC, CONTAINER_VERSION, static_cast<uint32_t>(ddsHeaderSize),
+			static_cast<uint32_t>(chunks.size()) };
+		uint64_t fileOffset = sizeof(header) + ddsHeaderSize + chunks.size() * sizeof(ContainerChunk);
+		for (auto& chunk : chunks)
+		{
+			chunk.fileOffset = fileOffset;
+			fileOffset += chunk.compressedSize;
+		}
+
+		std::ofstream ofs(dst, std::ios::binary);
+		ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		ofs.write(reinterpret_cast<const char*>(pDDS), ddsHeaderSize);
+		ofs.write(reinterpret_cast<const char*>(chunks.data()), chunks.size() * sizeof(ContainerChunk));
+		for (const auto& payload : payloads)
+		{
+			ofs.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+		}
+		if (!ofs)
+		{
+			throw std::runtime_error("Failed to write compressed texture " + dst.string());
+		}
+		log << "\tCompressed " << dds.GetBufferSize() / 1024 << " KiB to " << fileOffset / 1024 << " KiB\n";
+	}
+
 	void ProcessAndSaveTexture(const DirectX::ScratchImage& image, DXGI_FORMAT fmt,
-		const std::filesystem::path& dst, 
+		const std::filesystem::path& dst, std::ostream& log, TEX_COMPRESS_FLAGS compressFlags,
 		AlphaMode alpha = AlphaMode::eOpaque, float alphaRef = 0.5f)
 	{
 		ScratchImage premultiplied;
 		premultiplied.InitializeFromImage(*image.GetImage(0, 0, 0));
 		if (alpha != AlphaMode::eOpaque)
 		{
-			std::cout << "\tPremultiplying alpha\n";
+			log << "\tPremultiplying alpha\n";
 			check_hresult(PremultiplyAlpha(*image.GetImage(0, 0, 0), TEX_PMALPHA_DEFAULT, premultiplied));
 		}
 
 		ScratchImage mipchain;
-		std::cout << "\tGenerating mipmaps\n";
+		log << "\tGenerating mipmaps\n";
 		check_hresult(GenerateMipMaps(*premultiplied.GetImage(0, 0, 0), TEX_FILTER_DEFAULT, 0, mipchain));
 
 		if (alpha == AlphaMode::eMask)
@@ -131,7 +268,7 @@ namespace
 			ScratchImage scaled;
 			auto& info = mipchain.GetMetadata();
 			check_hresult(scaled.Initialize(info));
-			std::cout << "\tScaling mipmaps for coverage\n";
+			log << "\tScaling mipmaps for coverage\n";
 			check_hresult(ScaleMipMapsAlphaForCoverage(mipchain.GetImages(), info.mipLevels, info,
 				0, alphaRef, scaled));
 			mipchain = std::move(scaled);
@@ -139,139 +276,186 @@ namespace
 
 		ScratchImage compressed;
 		std::string fmtString = FormatToString(fmt);
-		std::cout << "\tCompressing to format " << fmtString << "\n";
+		log << "\tCompressing to format " << fmtString << "\n";
 		check_hresult(Compress(mipchain.GetImages(), mipchain.GetImageCount(), mipchain.GetMetadata(), fmt,
-			TEX_COMPRESS_DEFAULT, TEX_THRESHOLD_DEFAULT, compressed));
+			compressFlags, TEX_THRESHOLD_DEFAULT, compressed));
 		
-		std::wcout << L"\tSaving to " << dst << "\n";
-		check_hresult(SaveToDDSFile(compressed.GetImages(), compressed.GetImageCount(), compressed.GetMetadata(),
-			DDS_FLAGS_NONE, dst.c_str()));
+		log << "\tSaving to " << dst.string() << "\n";
+		if (g_compressTextures)
+		{
+			SaveToCompressedDDSFile(compressed, dst, log);
+		}
+		else
+		{
+			check_hresult(SaveToDDSFile(compressed.GetImages(), compressed.GetImageCount(), compressed.GetMetadata(),
+				DDS_FLAGS_NONE, dst.c_str()));
+		}
 	}
 
 	void ConvertTexture(const std::filesystem::path& src, WIC_FLAGS flags, 
-		DXGI_FORMAT fmt, const std::filesystem::path& dst, AlphaMode alpha = AlphaMode::eOpaque,
-		float alphaRef = 0.5f)
+		DXGI_FORMAT fmt, const std::filesystem::path& dst, std::ostream& log, TEX_COMPRESS_FLAGS compressFlags,
+		AlphaMode alpha = AlphaMode::eOpaque, float alphaRef = 0.5f)
 	{
 		ScratchImage out;
 		check_hresult(LoadFromWICFile(src.c_str(), flags, nullptr, out));
-		ProcessAndSaveTexture(out, fmt, dst, alpha, alphaRef);
+		ProcessAndSaveTexture(out, fmt, dst, log, compressFlags, alpha, alphaRef);
 	}
 
-	void PackTextures(Material& material, const AssimpTextureInfo& aiInfo, const std::filesystem::path& targetDir)
+	// Packs occlusion, roughness and metalness into the red, green and blue channels
+	ScratchImage PackOcclusionRoughnessMetalness(const AssimpTextureInfo& aiInfo)
 	{
-		static int textureID = 0;
-
-		// Pack Occlusion-Roughness-Metalness map if required
-		if ((!aiInfo.occlusion.empty()) || (!aiInfo.roughness.empty()) || (!aiInfo.metalness.empty()))
+		TexMetadata md{};
+		ScratchImage out;
+		ScratchImage occlusion;
+		ScratchImage roughness;
+		ScratchImage metalness;
+		if (!aiInfo.occlusion.empty())
 		{
-			TexMetadata md{};
-			ScratchImage out;
-			ScratchImage occlusion;
-			ScratchImage roughness;
-			ScratchImage metalness;
-			if (!aiInfo.occlusion.empty())
+			check_hresult(LoadFromWICFile(aiInfo.occlusion.c_str(), WIC_FLAGS_FORCE_LINEAR, &md, occlusion));
+			if (out.GetImageCount() == 0)
 			{
-				check_hresult(LoadFromWICFile(aiInfo.occlusion.c_str(), WIC_FLAGS_FORCE_LINEAR, &md, occlusion));
-				if (out.GetImageCount() == 0)
-				{
-					check_hresult(out.Initialize(md));
-				}
+				check_hresult(out.Initialize(md));
 			}
-			if (!aiInfo.roughness.empty())
+		}
+		if (!aiInfo.roughness.empty())
+		{
+			check_hresult(LoadFromWICFile(aiInfo.roughness.c_str(), WIC_FLAGS_FORCE_LINEAR, &md, roughness));
+			if (out.GetImageCount() == 0)
 			{
-				check_hresult(LoadFromWICFile(aiInfo.roughness.c_str(), WIC_FLAGS_FORCE_LINEAR, &md, roughness));
-				if (out.GetImageCount() == 0)
-				{
-					check_hresult(out.Initialize(md));
-				}
+				check_hresult(out.Initialize(md));
 			}
-			if (!aiInfo.metalness.empty())
+		}
+		if (!aiInfo.metalness.empty())
+		{
+			check_hresult(LoadFromWICFile(aiInfo.metalness.c_str(), WIC_FLAGS_FORCE_LINEAR, &md, metalness));
+			if (out.GetImageCount() == 0)
 			{
-				check_hresult(LoadFromWICFile(aiInfo.metalness.c_str(), WIC_FLAGS_FORCE_LINEAR, &md, metalness));
-				if (out.GetImageCount() == 0)
-				{
-					check_hresult(out.Initialize(md));
-				}
+				check_hresult(out.Initialize(md));
 			}
+		}
 
-			if (occlusion.GetImageCount() != 0)
-			{
-				check_hresult(TransformImage(*occlusion.GetImage(0, 0, 0), [](XMVECTOR* outPixels,
-					const XMVECTOR* inPixels,
-					size_t width, [[maybe_unused]] size_t y)
+		if (occlusion.GetImageCount() != 0)
+		{
+			check_hresult(TransformImage(*occlusion.GetImage(0, 0, 0), [](XMVECTOR* outPixels,
+				const XMVECTOR* inPixels,
+				size_t width, [[maybe_unused]] size_t y)
+				{
+					for (size_t i = 0; i < width; i++)
 					{
-						for (size_t i = 0; i < width; i++)
-						{
-							assert(i < width);
-							float r = XMVectorGetX(inPixels[i]);
-							outPixels[i] = XMVectorSetX(inPixels[i], r);
-						}
-					}, out));
-			}
-			if (roughness.GetImageCount() != 0)
-			{
-				check_hresult(TransformImage(*roughness.GetImage(0, 0, 0), [](XMVECTOR* outPixels,
-					const XMVECTOR* inPixels,
-					size_t width, [[maybe_unused]] size_t y)
+						assert(i < width);
+						float r = XMVectorGetX(inPixels[i]);
+						outPixels[i] = XMVectorSetX(inPixels[i], r);
+					}
+				}, out));
+		}
+		if (roughness.GetImageCount() != 0)
+		{
+			check_hresult(TransformImage(*roughness.GetImage(0, 0, 0), [](XMVECTOR* outPixels,
+				const XMVECTOR* inPixels,
+				size_t width, [[maybe_unused]] size_t y)
+				{
+					for (size_t i = 0; i < width; i++)
 					{
-						for (size_t i = 0; i < width; i++)
-						{
-							assert(i < width);
-							float g = XMVectorGetY(inPixels[i]);
-							outPixels[i] = XMVectorSetY(inPixels[i], g);
-						}
-					}, out));
-			}
-			if (metalness.GetImageCount() != 0)
+						assert(i < width);
+						float g = XMVectorGetY(inPixels[i]);
+						outPixels[i] = XMVectorSetY(inPixels[i], g);
+					}
+				}, out));
+		}
+		if (metalness.GetImageCount() != 0)
+		{
+			check_hresult(TransformImage(*metalness.GetImage(0, 0, 0), [](XMVECTOR* outPixels,
+				const XMVECTOR* inPixels,
+				size_t width, [[maybe_unused]] size_t y)
+				{
+					for (size_t i = 0; i < width; i++)
+					{
+						assert(i < width);
+						float b = XMVectorGetZ(inPixels[i]);
+						outPixels[i] = XMVectorSetZ(inPixels[i], b);
+					}
+				}, out));
+		}
+		return out;
+	}
+
+	// Names the material's textures and queues the jobs that convert any not seen before. Output
+	// files are named after a hash of the sources and every parameter that affects the result.
+	void PackTextures(Material& material, const AssimpTextureInfo& aiInfo, const std::filesystem::path& targetDir,
+		TextureSet* pTextures)
+	{
+		std::string filename;
+		auto& jobs = pTextures->jobs;
+
+		// Pack Occlusion-Roughness-Metalness map if required
+		if ((!aiInfo.occlusion.empty()) || (!aiInfo.roughness.empty()) || (!aiInfo.metalness.empty()))
+		{
+			// Which channel each source fills depends on its position in the key
+			uint64_t key = HashSourceFile(pTextures, aiInfo.occlusion);
+			key = HashBytes(&key, sizeof(key), HashSourceFile(pTextures, aiInfo.roughness));
+			key = HashBytes(&key, sizeof(key), HashSourceFile(pTextures, aiInfo.metalness));
+			if (AddTexture(pTextures, "occlusionRoughnessMetalness", key, &filename))
 			{
-				check_hresult(TransformImage(*metalness.GetImage(0, 0, 0), [](XMVECTOR* outPixels,
-					const XMVECTOR* inPixels,
-					size_t width, [[maybe_unused]] size_t y)
+				jobs.push_back([aiInfo, dst = targetDir / filename](std::ostream& log, TEX_COMPRESS_FLAGS compressFlags)
 					{
-						for (size_t i = 0; i < width; i++)
-						{
-							assert(i < width);
-							float b = XMVectorGetZ(inPixels[i]);
-							outPixels[i] = XMVectorSetZ(inPixels[i], b);
-						}
-					}, out));
+						log << "Processing occlusion-roughness-metalness map\n";
+						ProcessAndSaveTexture(PackOcclusionRoughnessMetalness(aiInfo), DXGI_FORMAT_BC1_UNORM, dst, log,
+							compressFlags);
+					});
 			}
-			std::cout << "Processing occlusion-roughness-metalness map\n";
-			std::string filename = "occlusionRoughnessMetalness" + std::to_string(textureID) + ".dds";
-			ProcessAndSaveTexture(out, DXGI_FORMAT_BC1_UNORM, targetDir / filename);
 			material.occlusionRoughnessMetalness = filename;
 		}
 		if (!aiInfo.baseColor.empty())
 		{
-			std::cout << "Processing base color map\n";
-			std::string filename = "baseColor" + std::to_string(textureID) + ".dds";
 			DXGI_FORMAT fmt = (material.alphaMode == AlphaMode::eOpaque)
 				? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM_SRGB;
-			ConvertTexture(aiInfo.baseColor, WIC_FLAGS_FORCE_SRGB, fmt, targetDir / filename, 
-				material.alphaMode, material.alphaCutoff);
+
+			// Alpha is premultiplied unless opaque, and the cutoff only matters when masking
+			const float alphaCutoff = (material.alphaMode == AlphaMode::eMask) ? material.alphaCutoff : 0.0f;
+			uint64_t key = HashSourceFile(pTextures, aiInfo.baseColor);
+			key = HashBytes(&material.alphaMode, sizeof(material.alphaMode), key);
+			key = HashBytes(&alphaCutoff, sizeof(alphaCutoff), key);
+			if (AddTexture(pTextures, "baseColor", key, &filename))
+			{
+				jobs.push_back([src = aiInfo.baseColor, fmt, dst = targetDir / filename, alphaMode = material.alphaMode,
+					alphaCutoff](std::ostream& log, TEX_COMPRESS_FLAGS compressFlags)
+					{
+						log << "Processing base color map\n";
+						ConvertTexture(src, WIC_FLAGS_FORCE_SRGB, fmt, dst, log, compressFlags, alphaMode, alphaCutoff);
+					});
+			}
 			material.baseColor = filename;
 		}
 		if (!aiInfo.emissive.empty())
 		{
-			std::cout << "Processing emissive map\n";
-			std::string filename = "emissive" + std::to_string(textureID) + ".dds";
-			ConvertTexture(aiInfo.emissive, WIC_FLAGS_FORCE_SRGB,
-				DXGI_FORMAT_BC1_UNORM_SRGB, targetDir / filename);
+			if (AddTexture(pTextures, "emissive", HashSourceFile(pTextures, aiInfo.emissive), &filename))
+			{
+				jobs.push_back([src = aiInfo.emissive, dst = targetDir / filename](std::ostream& log,
+					TEX_COMPRESS_FLAGS compressFlags)
+					{
+						log << "Processing emissive map\n";
+						ConvertTexture(src, WIC_FLAGS_FORCE_SRGB, DXGI_FORMAT_BC1_UNORM_SRGB, dst, log, compressFlags);
+					});
+			}
 			material.emissive = filename;
 		}
 		if (!aiInfo.normal.empty())
 		{
-			std::cout << "Processing normal map\n";
-			std::string filename = "normal" + std::to_string(textureID) + ".dds";
-			ConvertTexture(aiInfo.normal, WIC_FLAGS_FORCE_LINEAR,
-				DXGI_FORMAT_BC5_UNORM, targetDir / filename);
+			if (AddTexture(pTextures, "normal", HashSourceFile(pTextures, aiInfo.normal), &filename))
+			{
+				jobs.push_back([src = aiInfo.normal, dst = targetDir / filename](std::ostream& log,
+					TEX_COMPRESS_FLAGS compressFlags)
+					{
+						log << "Processing normal map\n";
+						ConvertTexture(src, WIC_FLAGS_FORCE_LINEAR, DXGI_FORMAT_BC5_UNORM, dst, log, compressFlags);
+					});
+			}
 			material.normal = filename;
 		}
-		textureID++;
 	}
 
 	Material GetMaterial(const aiMaterial* aiMat, const std::filesystem::path& targetDir,
-		const std::filesystem::path& srcDir)
+		const std::filesystem::path& srcDir, TextureSet* pTextures)
 	{
 		Material mat{};
 
@@ -357,12 +541,12 @@ namespace
 		}
 
 		const AssimpTextureInfo info = GetTextures(aiMat, mat, srcDir);
-		PackTextures(mat, info, targetDir);
+		PackTextures(mat, info, targetDir, pTextures);
 		return mat;
 	}
 
 	Mesh ProcessNode(const aiNode* node, const aiScene* scene, const std::filesystem::path& targetDir,
-		const std::filesystem::path& srcDir)
+		const std::filesystem::path& srcDir, TextureSet* pTextures)
 	{
 		Mesh ret;
 
@@ -372,7 +556,7 @@ namespace
 		const aiMaterial* mat = scene->mMaterials[materialIdx];
 
 		// Textures and other material info
-		ret.material = GetMaterial(mat, targetDir, srcDir);
+		ret.material = GetMaterial(mat, targetDir, srcDir, pTextures);
 
 		// Index buffer
 		for (unsigned int i = 0; i < mesh->mNumFaces; i++)
@@ -451,12 +635,13 @@ namespace
 		}
 
 		const auto srcDir = src.parent_path();
+		TextureSet textures;
 		int nodeIdx = 0;
 		const aiNode* root = scene->mRootNode;
 		if (root->mNumMeshes > 0)
 		{
 			std::cout << "\nProcessing node " << nodeIdx++ << "\n";
-			ret.meshes.push_back(ProcessNode(root, scene, targetDir, srcDir));
+			ret.meshes.push_back(ProcessNode(root, scene, targetDir, srcDir, &textures));
 		}
 		for (unsigned int i = 0; i < root->mNumChildren; i++)
 		{
@@ -464,16 +649,36 @@ namespace
 			if (node->mNumMeshes > 0)
 			{
 				std::cout << "\nProcessing node " << nodeIdx++ << "\n";
-				ret.meshes.push_back(ProcessNode(node, scene, targetDir, srcDir));
+				ret.meshes.push_back(ProcessNode(node, scene, targetDir, srcDir, &textures));
 			}
 		}
+
+		// Textures of every material are converted together, one per thread. The last wave of
+		// jobs leaves threads idle, so those also compress each texture on several threads.
+		// Workers use WIC through the implicit multithreaded apartment set up by wmain.
+		const auto& textureJobs = textures.jobs;
+		std::cout << "\nConverting " << textureJobs.size() << " unique textures of " << textures.referenceCount
+			<< " referenced\n";
+		const size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+		std::mutex logMutex;
+		ParallelFor(textureJobs.size(), [&](size_t i)
+			{
+				const TEX_COMPRESS_FLAGS compressFlags = (i + threadCount >= textureJobs.size())
+					? TEX_COMPRESS_PARALLEL : TEX_COMPRESS_DEFAULT;
+				std::ostringstream log;
+				textureJobs[i](log, compressFlags);
+
+				std::lock_guard lock(logMutex);
+				std::cout << log.str();
+			});
 		std::cout << "Finished processing model\n";
 		return ret;
 	}
 
 	void PrintUsage()
 	{
-		std::cerr << "Usage: convert [filename] [output folder]\n";
+		std::cerr << "Usage: convert [--compress] [filename] [output folder]\n";
+		std::cerr << "       convert --ibl [environment.hdr] [output folder]\n";
 	}
 }
 
@@ -481,21 +686,30 @@ int wmain(int argc, wchar_t** argv)
 {
 	check_hresult(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
 
-	if (argc != 3)
+	const bool bakeEnvironment = (argc == 4) && (std::wstring(argv[1]) == L"--ibl");
+	g_compressTextures = (argc == 4) && (std::wstring(argv[1]) == L"--compress");
+	if ((argc != 3) && !bakeEnvironment && !g_compressTextures)
 	{
 		PrintUsage();
 		return 0;
 	}
 
-	std::filesystem::path target(argv[2]);
+	std::filesystem::path target(argv[argc - 1]);
 	if ((!std::filesystem::exists(target)) && (!std::filesystem::create_directory(target)))
 	{
 		std::cerr << "Failed to create target directory " << target << "\n";
 		return 1;
 	}
-	const auto model = LoadModel(argv[1], target);
 
-	std::filesystem::path filename = std::filesystem::path(argv[2]).stem();
+	if (bakeEnvironment)
+	{
+		BakeEnvironment(argv[2], target);
+		return 0;
+	}
+
+	const auto model = LoadModel(argv[argc - 2], target);
+
+	std::filesystem::path filename = std::filesystem::path(argv[argc - 1]).stem();
 	filename += ".mdl";
 	std::filesystem::path dst = target / filename;
 	std::ofstream ofs(dst, std::ios::binary);
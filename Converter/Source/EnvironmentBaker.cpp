@@ -0,0 +1,405 @@
+#include "EnvironmentBaker.h"
+#include "ParallelFor.h"
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+
+#include <winrt/base.h>
+
+#include <DirectXMath.h>
+#include <DirectXTex.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using winrt::check_hresult;
+using dx::ParallelFor;
+
+using namespace DirectX;
+using namespace std::string_literals;
+
+namespace
+{
+	constexpr float PI = 3.14159265358979f;
+
+	// Low discrepancy sample points for importance sampling
+	XMFLOAT2 Hammersley(uint32_t i, uint32_t count)
+	{
+		uint32_t bits = i;
+		bits = (bits << 16u) | (bits >> 16u);
+		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+		return XMFLOAT2(static_cast<float>(i) / count, bits * 2.3283064365386963e-10f);
+	}
+
+	// Samples a GGX distributed half vector around n. alpha is the squared linear roughness.
+	XMVECTOR ImportanceSampleGGX(XMFLOAT2 xi, float alpha, FXMVECTOR n)
+	{
+		float phi = 2.0f * PI * xi.x;
+		float cosTheta = std::sqrt((1.0f - xi.y) / (1.0f + (alpha * alpha - 1.0f) * xi.y));
+		float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+
+		// Tangent frame around n
+		auto up = std::abs(XMVectorGetY(n)) < 0.999f ? XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f) : XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+		auto tangent = XMVector3Normalize(XMVector3Cross(up, n));
+		auto bitangent = XMVector3Cross(n, tangent);
+
+		auto h = XMVectorScale(tangent, sinTheta * std::cos(phi));
+		h = XMVectorAdd(h, XMVectorScale(bitangent, sinTheta * std::sin(phi)));
+		h = XMVectorAdd(h, XMVectorScale(n, cosTheta));
+		return XMVector3Normalize(h);
+	}
+
+	float D_GGX(float NdotH, float alpha)
+	{
+		float a2 = alpha * alpha;
+		float f = (NdotH * a2 - NdotH) * NdotH + 1.0f;
+		return a2 / (PI * f * f);
+	}
+
+	// Must match V_SmithGGXCorrelated in PBR.ps.hlsl
+	float V_SmithGGXCorrelated(float NdotV, float NdotL, float alpha)
+	{
+		float a2 = alpha * alpha;
+		float ggxL = NdotV * std::sqrt((-NdotL * a2 + NdotL) * NdotL + a2);
+		float ggxV = NdotL * std::sqrt((-NdotV * a2 + NdotV) * NdotV + a2);
+		return 0.5f / (ggxV + ggxL);
+	}
+
+	// Direction through the center of a cubemap texel, using the D3D face order +X, -X, +Y, -Y, +Z, -Z
+	XMVECTOR CubemapDirection(size_t face, size_t x, size_t y, size_t size)
+	{
+		float u = 2.0f * (x + 0.5f) / size - 1.0f;
+		float v = 2.0f * (y + 0.5f) / size - 1.0f;
+		XMVECTOR dir;
+		switch (face)
+		{
+		case 0: dir = XMVectorSet(1.0f, -v, -u, 0.0f); break;
+		case 1: dir = XMVectorSet(-1.0f, -v, u, 0.0f); break;
+		case 2: dir = XMVectorSet(u, 1.0f, v, 0.0f); break;
+		case 3: dir = XMVectorSet(u, -1.0f, -v, 0.0f); break;
+		case 4: dir = XMVectorSet(u, -v, 1.0f, 0.0f); break;
+		default: dir = XMVectorSet(-u, -v, -1.0f, 0.0f); break;
+		}
+		return XMVector3Normalize(dir);
+	}
+
+	// Bilinearly filtered lookups into a lat-long environment with a full mip chain
+	class LatLongMap
+	{
+	public:
+		explicit LatLongMap(ScratchImage&& mipchain) :
+			m_mipchain(std::move(mipchain))
+		{
+		}
+
+		size_t GetWidth() const { return m_mipchain.GetMetadata().width; }
+		size_t GetHeight() const { return m_mipchain.GetMetadata().height; }
+
+		XMVECTOR Load(size_t mip, size_t x, size_t y) const
+		{
+			const Image* image = m_mipchain.GetImage(mip, 0, 0);
+			const auto* row = reinterpret_cast<const XMFLOAT4*>(image->pixels + y * image->rowPitch);
+			return XMLoadFloat4(&row[x]);
+		}
+
+		// Direction of the center of a texel in the top mip
+		XMVECTOR TexelDirection(size_t x, size_t y) const
+		{
+			float phi = ((x + 0.5f) / GetWidth() - 0.5f) * 2.0f * PI;
+			float theta = (y + 0.5f) / GetHeight() * PI;
+			return XMVectorSet(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi), 0.0f);
+		}
+
+		// Solid angle covered by a texel in the top mip
+		float TexelSolidAngle(size_t y) const
+		{
+			float theta = (y + 0.5f) / GetHeight() * PI;
+			return (2.0f * PI / GetWidth()) * (PI / GetHeight()) * std::sin(theta);
+		}
+
+		XMVECTOR Sample(FXMVECTOR dir, float lod) const
+		{
+			size_t mip = std::min(static_cast<size_t>(std::max(lod, 0.0f) + 0.5f), m_mipchain.GetMetadata().mipLevels - 1);
+			const Image* image = m_mipchain.GetImage(mip, 0, 0);
+
+			XMFLOAT3 d;
+			XMStoreFloat3(&d, dir);
+			float u = std::atan2(d.z, d.x) / (2.0f * PI) + 0.5f;
+			float v = std::acos(std::clamp(d.y, -1.0f, 1.0f)) / PI;
+
+			// Wrap horizontally, clamp vertically
+			float fx = u * image->width - 0.5f;
+			float fy = std::clamp(v * image->height - 0.5f, 0.0f, image->height - 1.0f);
+			float x0 = std::floor(fx);
+			float y0 = std::floor(fy);
+			float tx = fx - x0;
+			float ty = fy - y0;
+
+			auto wrapX = [&](float x) { return static_cast<size_t>((static_cast<int64_t>(x) % static_cast<int64_t>(image->width) + image->width) % image->width); };
+			size_t ix0 = wrapX(x0);
+			size_t ix1 = wrapX(x0 + 1.0f);
+			size_t iy0 = static_cast<size_t>(y0);
+			size_t iy1 = std::min(iy0 + 1, image->height - 1);
+
+			auto top = XMVectorLerp(Load(mip, ix0, iy0), Load(mip, ix1, iy0), tx);
+			auto bottom = XMVectorLerp(Load(mip, ix0, iy1), Load(mip, ix1, iy1), tx);
+			return XMVectorLerp(top, bottom, ty);
+		}
+
+	private:
+		ScratchImage m_mipchain;
+	};
+
+	LatLongMap LoadEnvironment(const std::filesystem::path& src)
+	{
+		ScratchImage loaded;
+		if (src.extension() == ".hdr")
+		{
+			check_hresult(LoadFromHDRFile(src.c_str(), nullptr, loaded));
+		}
+		else if (src.extension() == ".dds")
+		{
+			check_hresult(LoadFromDDSFile(src.c_str(), DDS_FLAGS_NONE, nullptr, loaded));
+		}
+		else
+		{
+			throw std::runtime_error("Unsupported environment format " + src.extension().string());
+		}
+
+		ScratchImage converted;
+		const Image* image = loaded.GetImage(0, 0, 0);
+		if (image->format != DXGI_FORMAT_R32G32B32A32_FLOAT)
+		{
+			check_hresult(Convert(*image, DXGI_FORMAT_R32G32B32A32_FLOAT, TEX_FILTER_DEFAULT,
+				TEX_THRESHOLD_DEFAULT, converted));
+			image = converted.GetImage(0, 0, 0);
+		}
+
+		ScratchImage mipchain;
+		check_hresult(GenerateMipMaps(*image, TEX_FILTER_BOX | TEX_FILTER_WRAP_U, 0, mipchain));
+		return LatLongMap(std::move(mipchain));
+	}
+
+	// Prefilters the environment for the split-sum approximation, assuming n = v = r.
+	// Samples are taken from a lower environment mip in proportion to their solid angle
+	// (filtered importance sampling), which removes most of the noise at low sample counts.
+	ScratchImage PrefilterSpecular(const LatLongMap& env, const dx::importer::EnvironmentBakeSettings& settings)
+	{
+		ScratchImage cubemap;
+		check_hresult(cubemap.InitializeCube(DXGI_FORMAT_R32G32B32A32_FLOAT, settings.specularSize,
+			settings.specularSize, 1, settings.specularMips));
+
+		const auto& info = cubemap.GetMetadata();
+		float texelSolidAngle = 4.0f * PI / (env.GetWidth() * env.GetHeight());
+
+		// One job per row of every face and mip, so the expensive rough mips are split up too
+		struct Job
+		{
+			size_t face;
+			size_t mip;
+			size_t row;
+		};
+		std::vector<Job> jobs;
+		for (size_t mip = 0; mip < info.mipLevels; mip++)
+		{
+			for (size_t face = 0; face < 6; face++)
+			{
+				for (size_t row = 0; row < cubemap.GetImage(mip, face, 0)->height; row++)
+				{
+					jobs.push_back({ face, mip, row });
+				}
+			}
+		}
+
+		ParallelFor(jobs.size(), [&](size_t i)
+			{
+				const auto& job = jobs[i];
+				const Image* image = cubemap.GetImage(job.mip, job.face, 0);
+				auto* row = reinterpret_cast<XMFLOAT4*>(image->pixels + job.row * image->rowPitch);
+
+				float linearRoughness = info.mipLevels > 1 ? job.mip / static_cast<float>(info.mipLevels - 1) : 0.0f;
+				float alpha = std::max(linearRoughness * linearRoughness, 0.001f);
+				for (size_t x = 0; x < image->width; x++)
+				{
+					auto n = CubemapDirection(job.face, x, job.row, image->width);
+
+					// The top mip is a mirror reflection of the environment
+					if (job.mip == 0)
+					{
+						XMStoreFloat4(&row[x], env.Sample(n, 0.0f));
+						continue;
+					}
+
+					auto sum = XMVectorZero();
+					float weight = 0.0f;
+					for (uint32_t s = 0; s < settings.specularSamples; s++)
+					{
+						auto h = ImportanceSampleGGX(Hammersley(s, settings.specularSamples), alpha, n);
+						float NdotH = XMVectorGetX(XMVector3Dot(n, h));
+						auto l = XMVectorSubtract(XMVectorScale(h, 2.0f * NdotH), n);
+						float NdotL = XMVectorGetX(XMVector3Dot(n, l));
+						if (NdotL > 0.0f)
+						{
+							// With v = n, pdf(l) = D(h) / 4
+							float pdf = D_GGX(NdotH, alpha) * 0.25f;
+							float sampleSolidAngle = 1.0f / (settings.specularSamples * pdf + 1e-6f);
+							float lod = 0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.0f;
+
+							sum = XMVectorAdd(sum, XMVectorScale(env.Sample(l, lod), NdotL));
+							weight += NdotL;
+						}
+					}
+					XMStoreFloat4(&row[x], XMVectorScale(sum, 1.0f / std::max(weight, 1e-6f)));
+				}
+			});
+
+		ScratchImage half;
+		check_hresult(Convert(cubemap.GetImages(), cubemap.GetImageCount(), info,
+			DXGI_FORMAT_R16G16B16A16_FLOAT, TEX_FILTER_DEFAULT, TEX_THRESHOLD_DEFAULT, half));
+		return half;
+	}
+
+	// Projects the environment onto the first 9 real spherical harmonics and convolves them
+	// with a clamped cosine lobe, so irradiance is a dot product with the basis at runtime.
+	ScratchImage ProjectIrradianceSH(const LatLongMap& env)
+	{
+		constexpr std::array<float, 9> bandFactors = {
+			PI,
+			2.0f * PI / 3.0f, 2.0f * PI / 3.0f, 2.0f * PI / 3.0f,
+			PI / 4.0f, PI / 4.0f, PI / 4.0f, PI / 4.0f, PI / 4.0f
+		};
+
+		// Each row is projected separately and the partial sums added afterwards
+		std::vector<std::array<XMFLOAT4, 9>> rows(env.GetHeight());
+		ParallelFor(env.GetHeight(), [&](size_t y)
+			{
+				std::array<XMVECTOR, 9> sums;
+				sums.fill(XMVectorZero());
+				float solidAngle = env.TexelSolidAngle(y);
+				for (size_t x = 0; x < env.GetWidth(); x++)
+				{
+					XMFLOAT3 d;
+					XMStoreFloat3(&d, env.TexelDirection(x, y));
+					std::array<float, 9> basis = {
+						0.282095f,
+						0.488603f * d.y,
+						0.488603f * d.z,
+						0.488603f * d.x,
+						1.092548f * d.x * d.y,
+						1.092548f * d.y * d.z,
+						0.315392f * (3.0f * d.z * d.z - 1.0f),
+						1.092548f * d.x * d.z,
+						0.546274f * (d.x * d.x - d.y * d.y)
+					};
+					auto radiance = XMVectorScale(env.Load(0, x, y), solidAngle);
+					for (size_t i = 0; i < 9; i++)
+					{
+						sums[i] = XMVectorAdd(sums[i], XMVectorScale(radiance, basis[i]));
+					}
+				}
+				for (size_t i = 0; i < 9; i++)
+				{
+					XMStoreFloat4(&rows[y][i], sums[i]);
+				}
+			});
+
+		ScratchImage sh;
+		check_hresult(sh.Initialize2D(DXGI_FORMAT_R32G32B32A32_FLOAT, 9, 1, 1, 1));
+		auto* coefficients = reinterpret_cast<XMFLOAT4*>(sh.GetImage(0, 0, 0)->pixels);
+		for (size_t i = 0; i < 9; i++)
+		{
+			auto sum = XMVectorZero();
+			for (const auto& row : rows)
+			{
+				sum = XMVectorAdd(sum, XMLoadFloat4(&row[i]));
+			}
+			XMStoreFloat4(&coefficients[i], XMVectorSetW(XMVectorScale(sum, bandFactors[i]), 1.0f));
+		}
+		return sh;
+	}
+
+	// Integrates the specular BRDF against a white environment. The result is a scale and bias
+	// applied to F0, so runtime specular is prefiltered * (F0 * x + y).
+	ScratchImage IntegrateBRDF(const dx::importer::EnvironmentBakeSettings& settings)
+	{
+		ScratchImage lut;
+		check_hresult(lut.Initialize2D(DXGI_FORMAT_R32G32_FLOAT, settings.brdfSize, settings.brdfSize, 1, 1));
+		const Image* image = lut.GetImage(0, 0, 0);
+
+		ParallelFor(settings.brdfSize, [&](size_t y)
+			{
+				auto* row = reinterpret_cast<XMFLOAT2*>(image->pixels + y * image->rowPitch);
+				float linearRoughness = (y + 0.5f) / settings.brdfSize;
+				float alpha = std::max(linearRoughness * linearRoughness, 0.001f);
+				auto n = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+				for (size_t x = 0; x < settings.brdfSize; x++)
+				{
+					float NdotV = (x + 0.5f) / settings.brdfSize;
+					auto v = XMVectorSet(std::sqrt(1.0f - NdotV * NdotV), 0.0f, NdotV, 0.0f);
+
+					float scale = 0.0f;
+					float bias = 0.0f;
+					for (uint32_t s = 0; s < settings.brdfSamples; s++)
+					{
+						auto h = ImportanceSampleGGX(Hammersley(s, settings.brdfSamples), alpha, n);
+						float VdotH = XMVectorGetX(XMVector3Dot(v, h));
+						auto l = XMVectorSubtract(XMVectorScale(h, 2.0f * VdotH), v);
+
+						float NdotL = XMVectorGetZ(l);
+						float NdotH = XMVectorGetZ(h);
+						if (NdotL > 0.0f)
+						{
+							// Visibility times the inverse sampling pdf
+							float Gv = V_SmithGGXCorrelated(NdotV, NdotL, alpha) * 4.0f * NdotL * VdotH / NdotH;
+							float Fc = std::pow(1.0f - VdotH, 5.0f);
+							scale += Gv * (1.0f - Fc);
+							bias += Gv * Fc;
+						}
+					}
+					row[x] = XMFLOAT2(scale / settings.brdfSamples, bias / settings.brdfSamples);
+				}
+			});
+
+		ScratchImage half;
+		check_hresult(Convert(*image, DXGI_FORMAT_R16G16_FLOAT, TEX_FILTER_DEFAULT, TEX_THRESHOLD_DEFAULT, half));
+		return half;
+	}
+
+	void Save(const ScratchImage& image, const std::filesystem::path& dst)
+	{
+		std::wcout << L"\tSaving to " << dst << "\n";
+		check_hresult(SaveToDDSFile(image.GetImages(), image.GetImageCount(), image.GetMetadata(),
+			DDS_FLAGS_NONE, dst.c_str()));
+	}
+}
+
+namespace dx::importer
+{
+	void BakeEnvironment(const std::filesystem::path& src, const std::filesystem::path& targetDir,
+		const EnvironmentBakeSettings& settings)
+	{
+		std::cout << "Loading environment: " << src << "\n";
+		const LatLongMap env = LoadEnvironment(src);
+
+		std::cout << "Prefiltering specular cubemap\n";
+		Save(PrefilterSpecular(env, settings), targetDir / "specular.dds");
+
+		std::cout << "Projecting irradiance to SH9\n";
+		Save(ProjectIrradianceSH(env), targetDir / "irradiance.dds");
+
+		std::cout << "Integrating BRDF lookup table\n";
+		Save(IntegrateBRDF(settings), targetDir / "brdf.dds");
+
+		std::cout << "Finished baking environment\n";
+	}
+}
\ No newline at end of file
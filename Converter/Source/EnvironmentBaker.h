@@ -0,0 +1,24 @@
+#pragma once
+
+#include <filesystem>
+
+namespace dx::importer
+{
+	struct EnvironmentBakeSettings
+	{
+		unsigned int specularSize = 256;		// Top mip size of the prefiltered cubemap
+		unsigned int specularMips = 6;			// Mip i is prefiltered for linear roughness i / (mips - 1)
+		unsigned int specularSamples = 512;		// GGX importance samples per texel
+		unsigned int brdfSize = 256;			// Width and height of the split-sum BRDF lookup table
+		unsigned int brdfSamples = 1024;		// Importance samples per lookup table texel
+	};
+
+	// Bakes image based lighting from an HDR lat-long environment (.hdr or floating point .dds)
+	// into three DDS files in targetDir:
+	//   specular.dds   - GGX prefiltered cubemap, one roughness level per mip, RGBA16F
+	//   irradiance.dds - 9 SH coefficients of the cosine convolved irradiance, 9x1 RGBA32F
+	//   brdf.dds       - Split-sum scale and bias for F0, indexed by (NdotV, linear roughness), RG16F
+	// The work is spread over all hardware threads.
+	void BakeEnvironment(const std::filesystem::path& src, const std::filesystem::path& targetDir,
+		const EnvironmentBakeSettings& settings = {});
+}
\ No newline at end of file
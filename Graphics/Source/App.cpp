@@ -8,13 +8,41 @@
 #include "ShadowMapEffect.h"
 #include "Components.h"
 #include "GeometryHelper.h"
+#include "Environment.h"
+#include "ShaderCache.h"
+#include "ShaderArchive.h"
+
+namespace
+{
+	const std::filesystem::path g_warmupPath = "ShaderCache/warmup.bin";
+	const std::filesystem::path g_shaderPath = "Source/Shaders";
+
+	// Share of dedicated video memory that streamed textures may use, leaving the rest for
+	// render targets, geometry and the driver
+	constexpr uint64_t TEXTURE_BUDGET_PERCENT = 50;
+
+	// Low memory builds drop the top mip of every material texture, a quarter of its memory
+#ifdef DX_LOW_MEMORY_TEXTURES
+	constexpr uint32_t TEXTURE_SKIP_MIPS = 1;
+#else
+	constexpr uint32_t TEXTURE_SKIP_MIPS = 0;
+#endif
+
+	double MillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
 
 namespace dx
 {
 	App::App() :
+		m_startTime(std::chrono::steady_clock::now()),
+		m_startupReported(false),
 		m_window(),
 		m_resources(m_window.GetHWnd()), 
 		m_helper(m_resources.GetDevice()),
+		m_textureStreamer(m_resources.GetDevice()),
 		m_camera(m_resources.GetSize().first, m_resources.GetSize().second),
 		m_pRegistry(std::make_shared<entt::registry>()),
 		m_sceneGraph(m_pRegistry)
@@ -22,9 +50,25 @@ namespace dx
 		auto* pDevice = m_resources.GetDevice();
 		auto* pContext = m_resources.GetContext();
 
+		if (uint64_t videoMemory = m_resources.GetAdapterDesc().DedicatedVideoMemory; videoMemory > 0)
+		{
+			m_textureStreamer.SetBudget(videoMemory / 100 * TEXTURE_BUDGET_PERCENT);
+		}
+		m_textureStreamer.SetMipLimits(TEXTURE_SKIP_MIPS, 0);
+
 		m_helper.BindSamplers(pContext);
 		m_helper.BindConstantBuffers(pContext);
 
+		// Create everything the previous session used before any of it is needed
+#ifndef DX_NO_WARMUP
+		auto warmupStart = std::chrono::steady_clock::now();
+		size_t warmupCount = WarmUp(pDevice, g_warmupPath);
+		std::cout << "Warm-up: created " << warmupCount << " shaders, states and pipeline states in "
+			<< MillisecondsSince(warmupStart) << " ms\n";
+#else
+		std::cout << "Warm-up: disabled\n";
+#endif
+
 		// Create a directional light
 		Light light{};
 		light.type = Light::Type::eDirectional;
@@ -35,9 +79,17 @@ namespace dx
 		auto lightEntity = m_pRegistry->create();
 		m_pRegistry->emplace<Light>(lightEntity, light);
 
+		// Checked once, so the pass and every material agree on image based lighting
+		const bool useEnvironmentMaps = HasBakedEnvironment();
+
 		m_renderPasses.push_back(std::make_unique<LightsPass>(m_resources, m_cache));
-		m_renderPasses.push_back(std::make_unique<ShadowPass>(m_resources, m_cache));
-		m_renderPasses.push_back(std::make_unique<OpaquePass>(m_resources, m_cache));
+		auto pShadowPass = std::make_unique<ShadowPass>(m_resources, m_cache,
+			ShadowPass::Partitioning::eSampleDistribution, ShadowPass::Scheduling::eTimeSliced);
+#ifdef DX_LOG_SHADOW_SCHEDULE
+		pShadowPass->LogSchedule("ShadowSchedule.csv");
+#endif
+		m_renderPasses.push_back(std::move(pShadowPass));
+		m_renderPasses.push_back(std::make_unique<OpaquePass>(m_resources, m_cache, useEnvironmentMaps));
 		m_renderPasses.push_back(std::make_unique<FullscreenPass>(m_resources, m_cache));
 
 		for (const auto& pass : m_renderPasses)
@@ -45,10 +97,45 @@ namespace dx
 			pass->ResolveResources(m_cache);
 		}
 
-		m_sceneGraph.LoadModel(pDevice, m_cache, "Assets/Sponza/Sponza.mdl");
+		m_sceneGraph.LoadModel(pDevice, m_textureStreamer, "Assets/Sponza/Sponza.mdl", useEnvironmentMaps);
+
+		// Precompiled builds cannot compile shaders, so there is nothing to reload
+#if defined(DX_SHADER_HOT_RELOAD) && !defined(DX_SHADERS_PRECOMPILED)
+		winrt::com_ptr<ID3D11Device> device;
+		device.copy_from(pDevice);
+		m_pShaderWatcher = std::make_unique<FileWatcher>(g_shaderPath,
+			[device](const std::vector<std::string>& paths) { ReloadShaders(device.get(), paths); });
+		std::cout << "Hot reload: watching " << g_shaderPath << "\n";
+#endif
 
 		m_window.OnTick.Register(this, &App::Tick);
 		m_window.OnResize.Register(this, &App::Resize);
+
+		std::cout << "Startup: initialized in " << MillisecondsSince(m_startTime) << " ms, read "
+			<< m_textureStreamer.GetBytesRead() / (1024 * 1024) << " MiB of texture mips\n";
+	}
+
+	App::~App()
+	{
+		m_pShaderWatcher.reset();
+
+		for (const auto& stats : GetResourceCacheStats())
+		{
+			std::cout << stats.name << ": " << stats.entryCount << " entries, " << stats.bytes / 1024 << " KiB, "
+				<< stats.hits << " hits, " << stats.misses << " misses, " << stats.insertions << " insertions, "
+				<< stats.evictions << " evictions\n";
+		}
+		std::cout << "Textures: " << m_textureStreamer.GetResidentBytes() / (1024 * 1024) << " MiB resident, "
+			<< m_textureStreamer.GetEvictionCount() << " mip evictions\n";
+
+		try
+		{
+			SaveWarmupList(g_warmupPath);
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << e.what() << "\n";
+		}
 	}
 
 	int App::Run()
@@ -59,6 +146,29 @@ namespace dx
 	void App::Update()
 	{
 		m_camera.Update();
+
+		// Stream in the texture mips each visible material needs from the current view
+		const float viewportHeight = static_cast<float>(m_resources.GetSize().second);
+		const auto frustum = m_camera.GetFrustum();
+		auto view = m_pRegistry->view<PBREffect, MeshBounds>();
+		for (auto obj : view)
+		{
+			const auto& bounds = view.get<MeshBounds>(obj);
+			if (!frustum.Intersects(bounds.sphere))
+			{
+				continue;
+			}
+			view.get<PBREffect>(obj).RequestTextureSize(GetRequiredTextureSize(m_camera.GetEyePosition(),
+				bounds.sphere, bounds.texcoordDensity, m_camera.GetFov(), viewportHeight));
+		}
+		m_textureStreamer.Update();
+
+		if (size_t reloaded = ApplyShaderReloads(); reloaded > 0)
+		{
+			m_helper.StateTracker().Invalidate();
+			GetShaderArchive().Commit();
+			std::cout << "Hot reload: reloaded " << reloaded << " shaders\n";
+		}
 	}
 
 	void App::Tick()
@@ -88,5 +198,22 @@ namespace dx
 			pass->Draw(m_resources, *m_pRegistry, m_helper, m_camera);
 		}
 		m_resources.Present();
+
+		if (!m_startupReported)
+		{
+			bool ready = true;
+			for (auto obj : m_pRegistry->view<PBREffect>())
+			{
+				ready = ready && m_pRegistry->get<PBREffect>(obj).HasFinalShaders();
+			}
+			if (ready)
+			{
+				std::cout << "Startup: first complete frame after " << MillisecondsSince(m_startTime) << " ms\n";
+				m_startupReported = true;
+
+				// Startup compiles are done, so they are written out as one batch
+				GetShaderArchive().Commit();
+			}
+		}
 	}
 }
@@ -7,6 +7,8 @@
 #include "RenderPass.h"
 #include "SceneGraph.h"
 #include "D3DHelper.h"
+#include "FileWatcher.h"
+#include "TextureStreamer.h"
 
 namespace dx
 {
@@ -14,6 +16,7 @@ namespace dx
 	{
 	public:
 		App();
+		~App();
 
 		int Run();
 
@@ -21,15 +24,24 @@ namespace dx
 		static constexpr int HEIGHT = 720;
 
 	private:
+		// Startup timing, reported once every effect draws with its final shaders. Declared
+		// first so it is initialized before the window and device.
+		std::chrono::steady_clock::time_point m_startTime;
+		bool m_startupReported;
+
 		Win32Window m_window;
 		DeviceResources m_resources;
 		D3DCache m_cache;
 		D3DHelper m_helper;
+		TextureStreamer m_textureStreamer;
 		FlyCamera m_camera;
 		std::vector<std::unique_ptr<RenderPass>> m_renderPasses;
 		std::shared_ptr<entt::registry> m_pRegistry;
 		SceneGraph m_sceneGraph;
 
+		// Recompiles shaders when their files change, in builds with DX_SHADER_HOT_RELOAD
+		std::unique_ptr<FileWatcher> m_pShaderWatcher;
+
 		void Render();
 		void Update();
 		void Tick();
@@ -0,0 +1,125 @@
+#include "stdafx.h"
+
+#include "BindingLayout.h"
+
+using winrt::com_ptr;
+using winrt::check_hresult;
+
+namespace
+{
+	void SetSlots(dx::SlotMask& mask, unsigned int start, unsigned int count)
+	{
+		for (unsigned int slot = start; slot < start + count && slot < mask.size(); slot++)
+		{
+			mask.set(slot);
+		}
+	}
+}
+
+namespace dx
+{
+	ShaderBindings GetShaderBindings(const std::vector<ShaderInputBinding>& inputs)
+	{
+		ShaderBindings bindings;
+		for (const auto& input : inputs)
+		{
+			switch (input.type)
+			{
+			case D3D_SIT_CBUFFER:
+				SetSlots(bindings.constantBuffers, input.bindPoint, input.bindCount);
+				break;
+			case D3D_SIT_SAMPLER:
+				SetSlots(bindings.samplers, input.bindPoint, input.bindCount);
+				break;
+			case D3D_SIT_TBUFFER:
+			case D3D_SIT_TEXTURE:
+			case D3D_SIT_STRUCTURED:
+			case D3D_SIT_BYTEADDRESS:
+				SetSlots(bindings.shaderResources, input.bindPoint, input.bindCount);
+				break;
+			default:
+				break;
+			}
+		}
+		return bindings;
+	}
+
+	ShaderBindings ReflectShaderBindings(const ShaderBytecode& bytecode)
+	{
+		com_ptr<ID3D11ShaderReflection> pReflect;
+		check_hresult(D3DReflect(bytecode.pData, bytecode.size, IID_PPV_ARGS(pReflect.put())));
+
+		D3D11_SHADER_DESC shaderDesc{};
+		check_hresult(pReflect->GetDesc(&shaderDesc));
+
+		std::vector<ShaderInputBinding> inputs;
+		for (unsigned int i = 0; i < shaderDesc.BoundResources; i++)
+		{
+			D3D11_SHADER_INPUT_BIND_DESC bindDesc{};
+			check_hresult(pReflect->GetResourceBindingDesc(i, &bindDesc));
+			inputs.push_back({ bindDesc.Type, bindDesc.BindPoint, bindDesc.BindCount });
+		}
+		return GetShaderBindings(inputs);
+	}
+
+	std::vector<BindingRange> GetBindingRanges(const SlotMask& used, const SlotMask& excluded)
+	{
+		std::vector<BindingRange> ranges;
+		const SlotMask bind = used & ~excluded;
+
+		// Grow the current range to each bound slot unless an excluded slot lies in between
+		std::optional<BindingRange> current;
+		for (unsigned int slot = 0; slot < bind.size(); slot++)
+		{
+			if (excluded[slot] && current)
+			{
+				ranges.push_back(*current);
+				current.reset();
+			}
+			else if (bind[slot])
+			{
+				if (current)
+				{
+					current->count = slot - current->start + 1;
+				}
+				else
+				{
+					current = BindingRange{ slot, 1 };
+				}
+			}
+		}
+		if (current)
+		{
+			ranges.push_back(*current);
+		}
+		return ranges;
+	}
+
+	BindingLayout::BindingLayout(const ShaderBindings& bindings, const ShaderBindings& excluded) :
+		m_shaderResources(GetBindingRanges(bindings.shaderResources, excluded.shaderResources)),
+		m_constantBuffers(GetBindingRanges(bindings.constantBuffers, excluded.constantBuffers)),
+		m_samplers(GetBindingRanges(bindings.samplers, excluded.samplers))
+	{
+	}
+
+	void BindingLayout::BindPS(ID3D11DeviceContext* pContext, ID3D11ShaderResourceView* const* ppViews,
+		size_t viewCount, ID3D11Buffer* const* ppBuffers, size_t bufferCount,
+		ID3D11SamplerState* const* ppSamplers, size_t samplerCount) const
+	{
+		for (const auto& range : m_shaderResources)
+		{
+			assert(range.start + range.count <= viewCount);
+			pContext->PSSetShaderResources(range.start, range.count, ppViews + range.start);
+		}
+		for (const auto& range : m_constantBuffers)
+		{
+			assert(range.start + range.count <= bufferCount);
+			pContext->PSSetConstantBuffers(range.start, range.count, ppBuffers + range.start);
+		}
+		for (const auto& range : m_samplers)
+		{
+			assert(range.start + range.count <= samplerCount);
+			pContext->PSSetSamplers(range.start, range.count, ppSamplers + range.start);
+		}
+	}
+}
\ No newline at end of file
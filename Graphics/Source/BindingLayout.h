@@ -0,0 +1,67 @@
+#pragma once
+
+#include "ShaderCache.h"
+
+namespace dx
+{
+	// One bit per register slot. Shader resource views have the most slots of any binding kind.
+	using SlotMask = std::bitset<D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT>;
+
+	// Register slots a shader reads, by kind
+	struct ShaderBindings
+	{
+		SlotMask shaderResources;
+		SlotMask constantBuffers;
+		SlotMask samplers;
+	};
+
+	// A resource reported by shader reflection, as in D3D11_SHADER_INPUT_BIND_DESC
+	struct ShaderInputBinding
+	{
+		D3D_SHADER_INPUT_TYPE type;
+		unsigned int bindPoint;
+		unsigned int bindCount;
+	};
+
+	// Slots used by a list of reflected resources. Unordered access views are not tracked.
+	ShaderBindings GetShaderBindings(const std::vector<ShaderInputBinding>& inputs);
+
+	// Reflects the resources a compiled shader reads. Resources the compiler optimized away are
+	// not reported.
+	ShaderBindings ReflectShaderBindings(const ShaderBytecode& bytecode);
+
+	// Consecutive slots set by a single call
+	struct BindingRange
+	{
+		unsigned int start;
+		unsigned int count;
+	};
+
+	// The fewest ranges covering every used slot that is not excluded. Unused slots between used
+	// ones are covered too, as whatever is bound there is never read, but excluded slots split
+	// ranges so that they keep what was bound to them.
+	std::vector<BindingRange> GetBindingRanges(const SlotMask& used, const SlotMask& excluded);
+
+	// The range calls needed to bind a shader's resources, leaving out the slots bound elsewhere,
+	// eg. once per pass. Computed once when a shader is loaded.
+	class BindingLayout
+	{
+	public:
+		BindingLayout() = default;
+		BindingLayout(const ShaderBindings& bindings, const ShaderBindings& excluded);
+
+		const std::vector<BindingRange>& GetShaderResources() const { return m_shaderResources; }
+		const std::vector<BindingRange>& GetConstantBuffers() const { return m_constantBuffers; }
+		const std::vector<BindingRange>& GetSamplers() const { return m_samplers; }
+
+		// Binds from tables indexed by slot, which must cover every range
+		void BindPS(ID3D11DeviceContext* pContext, ID3D11ShaderResourceView* const* ppViews, size_t viewCount,
+			ID3D11Buffer* const* ppBuffers, size_t bufferCount,
+			ID3D11SamplerState* const* ppSamplers = nullptr, size_t samplerCount = 0) const;
+
+	private:
+		std::vector<BindingRange> m_shaderResources;
+		std::vector<BindingRange> m_constantBuffers;
+		std::vector<BindingRange> m_samplers;
+	};
+}
\ No newline at end of file
@@ -29,6 +29,15 @@ namespace dx
             return DirectX::XMMatrixMultiply(GetViewMatrix(), GetProjectionMatrix());
         }
 
+        // View frustum in world space
+        DirectX::BoundingFrustum GetFrustum() const
+        {
+            DirectX::BoundingFrustum frustum;
+            DirectX::BoundingFrustum::CreateFromMatrix(frustum, GetProjectionMatrix(), true);
+            frustum.Transform(frustum, DirectX::XMMatrixInverse(nullptr, GetViewMatrix()));
+            return frustum;
+        }
+
         DirectX::XMVECTOR GetEyePosition() const
         {
             return DirectX::XMLoadFloat3(&m_pos);
@@ -39,6 +48,12 @@ namespace dx
             return std::pair{ m_nearPlane, m_farPlane };
         }
 
+        // Vertical field of view in radians
+        float GetFov() const
+        {
+            return m_fov;
+        }
+
         void SetEyePosition(const DirectX::XMFLOAT3& pos)
         {
             m_pos = pos;
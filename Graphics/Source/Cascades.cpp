@@ -0,0 +1,61 @@
+#include "stdafx.h"
+
+#include "Cascades.h"
+
+namespace dx
+{
+	DirectX::XMMATRIX FitLightProjection(const std::array<DirectX::XMVECTOR, 8>& frustumCorners,
+		DirectX::FXMMATRIX lightView, unsigned int shadowMapSize, float guardBand)
+	{
+		using namespace DirectX;
+
+		// Light space bounding box of the slice
+		auto lsMin = XMVectorReplicate(FLT_MAX);
+		auto lsMax = XMVectorReplicate(-FLT_MAX);
+		for (const auto& corner : frustumCorners)
+		{
+			auto p = XMVector3TransformCoord(corner, lightView);
+			lsMin = XMVectorMin(lsMin, p);
+			lsMax = XMVectorMax(lsMax, p);
+		}
+
+		XMFLOAT3 bmin;
+		XMFLOAT3 bmax;
+		XMStoreFloat3(&bmin, lsMin);
+		XMStoreFloat3(&bmax, lsMax);
+
+		// The texel size only depends on the quantized extent, so it is the same from frame to frame
+		float extent = std::max(bmax.x - bmin.x, bmax.y - bmin.y) * (1.0f + 2.0f * guardBand);
+		extent = QuantizeCascadeExtent(extent);
+		float texelSize = extent / shadowMapSize;
+
+		// Snap the center to the texel grid
+		float centerX = std::floor(0.5f * (bmin.x + bmax.x) / texelSize) * texelSize;
+		float centerY = std::floor(0.5f * (bmin.y + bmax.y) / texelSize) * texelSize;
+		float halfExtent = 0.5f * extent;
+		float depthPadding = (bmax.z - bmin.z) * guardBand;
+
+		// Right-handed light view looks down -z, so visible depths are negative
+		return XMMatrixOrthographicOffCenterRH(centerX - halfExtent, centerX + halfExtent,
+			centerY - halfExtent, centerY + halfExtent, -(bmax.z + depthPadding), -(bmin.z - depthPadding));
+	}
+
+	bool CascadeCoversSlice(const std::array<DirectX::XMVECTOR, 8>& frustumCorners,
+		DirectX::FXMMATRIX lightViewProj)
+	{
+		using namespace DirectX;
+
+		// Receivers outside [0, 1] depth are treated as unshadowed by the lighting shader
+		const auto lower = XMVectorSet(-1.0f, -1.0f, 0.0f, 0.0f);
+		const auto upper = XMVectorSet(1.0f, 1.0f, 1.0f, 0.0f);
+		for (const auto& corner : frustumCorners)
+		{
+			auto p = XMVector3TransformCoord(corner, lightViewProj);
+			if (!XMVector3GreaterOrEqual(p, lower) || !XMVector3LessOrEqual(p, upper))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
\ No newline at end of file
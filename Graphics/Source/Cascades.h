@@ -0,0 +1,112 @@
+#pragma once
+
+// Shadow configuration, fixed at compile time. Define these in the build to trade quality
+// for memory, eg. 2 cascades at 1024 for low-end deployments or 4 at 4096 for high-end ones.
+// They are passed to every shader as NUM_CASCADES and SHADOW_MAP_SIZE.
+#ifndef DX_SHADOW_CASCADE_COUNT
+#define DX_SHADOW_CASCADE_COUNT 3
+#endif
+
+#ifndef DX_SHADOW_MAP_SIZE
+#define DX_SHADOW_MAP_SIZE 2048
+#endif
+
+// Set to 1 to filter shadows with prefiltered exponential variance shadow maps instead of PCF.
+// This selects the USE_MOMENT_SHADOWS permutation of the PBR shader.
+#ifndef DX_SHADOW_MOMENTS
+#define DX_SHADOW_MOMENTS 0
+#endif
+
+namespace dx
+{
+	constexpr unsigned int SHADOW_CASCADE_COUNT = DX_SHADOW_CASCADE_COUNT;
+	constexpr unsigned int SHADOW_MAP_SIZE = DX_SHADOW_MAP_SIZE;
+	constexpr bool SHADOW_USE_MOMENTS = DX_SHADOW_MOMENTS != 0;
+
+	static_assert(SHADOW_CASCADE_COUNT >= 1 && SHADOW_CASCADE_COUNT <= 4,
+		"Cascade splits are packed into a single float4 in the per frame constants");
+	static_assert((SHADOW_MAP_SIZE & (SHADOW_MAP_SIZE - 1)) == 0, "Shadow map size must be a power of two");
+
+	// Converts a hardware depth buffer value into a positive view space distance, assuming
+	// the right-handed perspective projection used by FlyCamera.
+	inline float LinearizeDepth(float depth, float zNear, float zFar)
+	{
+		return (zNear * zFar) / (zFar - depth * (zFar - zNear));
+	}
+
+	// Partitions the view space depth range [zBegin, zEnd] into N cascades by blending between
+	// logarithmic and uniform splits. lambda = 1 gives purely logarithmic splits.
+	// Element 0 is the start of the first cascade and element i + 1 is the end of cascade i.
+	template<size_t N>
+	std::array<float, N + 1> ComputeCascadeBoundaries(float zBegin, float zEnd, float lambda)
+	{
+		static_assert(N > 0, "At least one cascade is required");
+
+		std::array<float, N + 1> boundaries{};
+		float range = zEnd - zBegin;
+		float ratio = zEnd / zBegin;
+
+		boundaries[0] = zBegin;
+		for (size_t i = 0; i < N; i++)
+		{
+			float p = (i + 1) / static_cast<float>(N);
+			float log = zBegin * std::pow(ratio, p);
+			float uniform = zBegin + range * p;
+			boundaries[i + 1] = lambda * (log - uniform) + uniform;
+		}
+		return boundaries;
+	}
+
+	// Sample distribution shadow maps: fit the cascades to the view depths that are actually
+	// visible on screen instead of the full clip range. minDepth and maxDepth are the results
+	// of the depth buffer reduction, and margin pads them to hide the readback latency.
+	// Falls back to the full clip range if the reduction has not produced a usable result.
+	template<size_t N>
+	std::array<float, N + 1> FitCascadeBoundaries(float minDepth, float maxDepth, float zNear, float zFar,
+		float lambda, float margin)
+	{
+		float zBegin = std::clamp(minDepth * (1.0f - margin), zNear, zFar);
+		float zEnd = std::clamp(maxDepth * (1.0f + margin), zNear, zFar);
+		if (!(zEnd > zBegin))
+		{
+			return ComputeCascadeBoundaries<N>(zNear, zFar, lambda);
+		}
+		return ComputeCascadeBoundaries<N>(zBegin, zEnd, lambda);
+	}
+
+	// Time sliced cascade updates: cascade i is refreshed every 2^i frames, so the near cascade
+	// updates every frame, the next every second frame and so on. Cascades are staggered by their
+	// index so the distant ones never all land on the same frame.
+	inline unsigned int CascadeUpdatePeriod(unsigned int cascade)
+	{
+		return 1u << cascade;
+	}
+
+	inline bool IsCascadeScheduled(uint64_t frame, unsigned int cascade)
+	{
+		return (frame + cascade) % CascadeUpdatePeriod(cascade) == 0;
+	}
+
+	// Returns true if every corner of a frustum slice still projects inside a previously
+	// rendered cascade, ie. the stale shadow map can be reused for this frame.
+	// lightViewProj is the untransposed matrix the cascade was rendered with.
+	bool CascadeCoversSlice(const std::array<DirectX::XMVECTOR, 8>& frustumCorners,
+		DirectX::FXMMATRIX lightViewProj);
+
+	// Rounds a cascade extent up to one of 8 steps per power of two. Fitted cascades keep the same
+	// texel size while the slice they cover changes by less than a step, so snapping stays stable.
+	inline float QuantizeCascadeExtent(float extent)
+	{
+		extent = std::max(extent, 1e-4f);
+		float step = std::exp2(std::floor(std::log2(extent)) - 3.0f);
+		return std::ceil(extent / step) * step;
+	}
+
+	// Returns an orthographic projection that bounds a frustum slice in light space. The square
+	// xy extent is padded by guardBand on each side and quantized, and its center is snapped to
+	// whole texels, so the map neither shimmers nor needs refitting on every small camera motion.
+	// lightView should only rotate, since a translation that follows the camera moves the texel grid.
+	// Casters in front of the near plane are handled by depth clamping in the shadow map shader.
+	DirectX::XMMATRIX FitLightProjection(const std::array<DirectX::XMVECTOR, 8>& frustumCorners,
+		DirectX::FXMMATRIX lightView, unsigned int shadowMapSize, float guardBand);
+}
\ No newline at end of file
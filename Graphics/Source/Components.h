@@ -16,6 +16,13 @@ namespace dx
 		}
 	};
 
+	// Bounds and texture coordinate density of a mesh, used to choose which texture mips to stream
+	struct MeshBounds
+	{
+		DirectX::BoundingSphere sphere;
+		float texcoordDensity;		// UV units per world unit, zero without texture coordinates
+	};
+
 	struct Light
 	{
 		enum class Type
@@ -3,7 +3,12 @@
 #include "D3DCache.h"
 
 #include "Util.h"
+#include "WarmupList.h"
+#include "ResourceCache.h"
+#include "FlatHashMap.h"
 #include "DDSTextureLoader11.h"
+#include "MappedFile.h"
+#include "TextureStreamer.h"
 
 using winrt::com_ptr;
 using winrt::hresult;
@@ -13,118 +18,774 @@ namespace
 {
     using namespace dx;
 
-    // Pipeline state objects
-    std::unordered_map<std::string, com_ptr<ID3D11SamplerState>> g_samplerStates;
-    std::unordered_map<std::string, com_ptr<ID3D11BlendState>> g_blendStates;
-    std::unordered_map<std::string, com_ptr<ID3D11RasterizerState>> g_rasterizerStates;
-    std::unordered_map<std::string, com_ptr<ID3D11DepthStencilState>> g_depthStencilStates;
+    // Fixed function state objects, keyed by their description
+    template<typename Desc, typename State>
+    using StateCache = ResourceCache<Desc, com_ptr<State>, PodHash<Desc>, PodEqual<Desc>, FlatHashMap>;
 
-    // Shaders
-    std::unordered_map<std::string, std::shared_ptr<VertexShader>> g_vertexShaders;
-    std::unordered_map<std::string, std::shared_ptr<PixelShader>> g_pixelShaders;
-    std::unordered_map<std::string, std::shared_ptr<ComputeShader>> g_computeShaders;
+    StateCache<D3D11_SAMPLER_DESC, ID3D11SamplerState> g_samplerStates("Sampler states");
+    StateCache<D3D11_BLEND_DESC, ID3D11BlendState> g_blendStates("Blend states");
+    StateCache<D3D11_RASTERIZER_DESC, ID3D11RasterizerState> g_rasterizerStates("Rasterizer states");
+    StateCache<D3D11_DEPTH_STENCIL_DESC, ID3D11DepthStencilState> g_depthStencilStates("Depth stencil states");
+
+    // Shaders, keyed by the hash of their bytecode
+    ResourceCache<uint64_t, std::shared_ptr<VertexShader>> g_vertexShaders("Vertex shaders");
+    ResourceCache<uint64_t, std::shared_ptr<PixelShader>> g_pixelShaders("Pixel shaders");
+    ResourceCache<uint64_t, std::shared_ptr<ComputeShader>> g_computeShaders("Compute shaders");
+
+    // Input layouts, keyed by the hash of the vertex format they describe. Vertex shader input
+    // signatures map to the layout they use so that reflection only runs once per signature.
+    ResourceCache<uint64_t, com_ptr<ID3D11InputLayout>> g_inputSignatures("Input signatures");
+    ResourceCache<uint64_t, com_ptr<ID3D11InputLayout>> g_inputLayouts("Input layouts");
 
     // Textures
-    std::unordered_map<std::string, com_ptr<ID3D11ShaderResourceView>> g_textures;
-}
+    ResourceCache<std::string, com_ptr<ID3D11ShaderResourceView>> g_textures("Textures");
 
-namespace dx
-{
-    std::shared_ptr<VertexShader> CreateVertexShader(ID3D11Device* pDevice, const std::string& filename,
-        const std::vector<std::pair<std::string, std::string>>& defines, uint64_t optionsKey)
+    // Pipeline states, keyed by the objects they are made of
+    struct PipelineStateKey
     {
-        std::string key = filename + std::to_string(optionsKey);
-        std::shared_ptr<VertexShader> ret = g_vertexShaders[key];
-        if (!ret)
+        const void* pVS;
+        const void* pPS;
+        const void* pRasterizerState;
+        const void* pBlendState;
+        const void* pDepthStencilState;
+        unsigned int stencilRef;
+        D3D11_PRIMITIVE_TOPOLOGY topology;
+    };
+
+    ResourceCache<PipelineStateKey, std::shared_ptr<const PipelineState>, PodHash<PipelineStateKey>,
+        PodEqual<PipelineStateKey>, FlatHashMap> g_pipelineStates("Pipeline states");
+    std::atomic<uint32_t> g_nextPipelineStateId = 0;
+
+    // Everything requested this session, recorded once created. Objects created by WarmUp are
+    // not recorded, so entries the session no longer asks for, or that fail, drop out.
+    WarmupList g_warmupList;
+
+    // Every shader object in the caches with the first request that produced it, so it can be
+    // recompiled in place when one of its files changes. Requests that shared an object before
+    // an edit keep sharing it until restart, even if the edit sets them apart.
+    struct LiveShader
+    {
+        using Swap = std::function<void(uint64_t previousKey)>;
+
+        ShaderStage stage;
+        std::string filename;
+        std::vector<std::pair<std::string, std::string>> defines;
+        uint64_t key;
+        uint32_t generation;
+
+        // Creates a replacement from new bytecode off the render thread, and returns the swap
+        std::function<Swap(ID3D11Device*, const ShaderBytecode&)> prepareReload;
+    };
+
+    // Recompiled shaders waiting for the render thread to swap them in
+    struct PendingReload
+    {
+        size_t index;
+        uint32_t generation;
+        uint64_t key;
+        LiveShader::Swap swap;
+    };
+
+    std::mutex g_liveShadersMutex;
+    std::vector<LiveShader> g_liveShaders;
+    std::unordered_map<const void*, size_t> g_liveShaderIndices;
+    std::vector<PendingReload> g_pendingReloads;
+
+    // The files each failed shader read, and the callbacks to run when one of them changes
+    std::vector<std::vector<std::string>> g_failedShaders;
+    std::vector<std::function<void()>> g_retryHandlers;
+
+    template<typename T>
+    void AddLiveShader(ResourceCache<uint64_t, std::shared_ptr<T>>& cache, std::shared_ptr<T> pShader,
+        const std::string& filename, const std::vector<std::pair<std::string, std::string>>& defines,
+        ShaderStage stage, uint64_t key)
+    {
+        using Cache = ResourceCache<uint64_t, std::shared_ptr<T>>;
+
+        LiveShader live{ stage, filename, defines, key, 0 };
+        live.prepareReload = [&cache, pShader](ID3D11Device* pDevice, const ShaderBytecode& bytecode)
         {
-            ret = std::make_shared<VertexShader>(pDevice, filename, optionsKey, defines);
+            auto pReplacement = std::make_shared<T>(pDevice, bytecode);
+            return LiveShader::Swap([&cache, pShader, pReplacement, key = bytecode.key, size = bytecode.size](
+                uint64_t previousKey)
+                {
+                    pShader->Reload(std::move(*pReplacement));
+
+                    // Move the cache entry to the new bytecode, unless another object holds either key
+                    std::shared_ptr<T> pCached;
+                    if (cache.Find(previousKey, &pCached) && pCached == pShader)
+                    {
+                        cache.Evict(previousKey);
+                    }
+                    cache.GetOrCreate(key, [&]() { return typename Cache::Created{ pShader, size }; });
+                });
+        };
+
+        std::lock_guard lock(g_liveShadersMutex);
+        g_liveShaderIndices[pShader.get()] = g_liveShaders.size();
+        g_liveShaders.push_back(std::move(live));
+    }
+
+    // Runs on the compile pool. Errors are reported and the shader keeps its current code.
+    void RecompileLiveShader(ID3D11Device* pDevice, size_t index, uint32_t generation)
+    {
+        LiveShader live;
+        {
+            std::lock_guard lock(g_liveShadersMutex);
+            live = g_liveShaders[index];
+        }
+
+        try
+        {
+            auto bytecode = CompileShader(live.filename, live.defines, live.stage);
+            if (bytecode.key == live.key)
+            {
+                return;
+            }
+            auto swap = live.prepareReload(pDevice, bytecode);
+
+            std::lock_guard lock(g_liveShadersMutex);
+            g_pendingReloads.push_back({ index, generation, bytecode.key, std::move(swap) });
+        }
+        catch (const winrt::hresult_error&)
+        {
+            // The compiler output has been printed already
+            std::cerr << "Failed to reload " << live.filename << ", keeping the previous shader\n";
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Failed to reload " << live.filename << ", keeping the previous shader: " << e.what() << "\n";
         }
-        return ret;
     }
 
-    std::shared_ptr<PixelShader> CreatePixelShader(ID3D11Device* pDevice, const std::string& filename,
-        const std::vector<std::pair<std::string, std::string>>& defines, uint64_t optionsKey)
+    // Whether a shader built from the given files is affected by a change to a file or directory
+    bool DependsOn(const std::vector<std::string>& dependencies, const std::string& changed)
     {
-        std::string key = filename + std::to_string(optionsKey);
-        std::shared_ptr<PixelShader> ret = g_pixelShaders[key];
-        if (!ret)
+        for (const auto& dependency : dependencies)
         {
-            ret = std::make_shared<PixelShader>(pDevice, filename, optionsKey, defines);
+            if (dependency == changed ||
+                (dependency.size() > changed.size() && dependency.compare(0, changed.size(), changed) == 0 &&
+                dependency[changed.size()] == '/'))
+            {
+                return true;
+            }
         }
-        return ret;
+        return false;
     }
 
-    std::shared_ptr<ComputeShader> CreateComputeShader(ID3D11Device* pDevice, const std::string& filename,
-        const std::vector<std::pair<std::string, std::string>>& defines, uint64_t optionsKey)
+    // Different defines often preprocess to the same source, eg. material options in a vertex
+    // shader, in which case the existing shader object is returned
+    template<typename T>
+    std::shared_ptr<T> GetOrCreateShader(ResourceCache<uint64_t, std::shared_ptr<T>>& cache, ID3D11Device* pDevice,
+        const std::string& filename, const std::vector<std::pair<std::string, std::string>>& defines, ShaderStage stage)
     {
-        std::string key = filename + std::to_string(optionsKey);
-        std::shared_ptr<ComputeShader> ret = g_computeShaders[key];
-        if (!ret)
+        ShaderBytecode bytecode{};
+        try
         {
-            ret = std::make_shared<ComputeShader>(pDevice, filename, optionsKey, defines);
+            bytecode = CompileShader(filename, defines, stage);
         }
-        return ret;
+        catch (const ShaderCompileError& e)
+        {
+            std::lock_guard lock(g_liveShadersMutex);
+            g_failedShaders.push_back(e.GetDependencies());
+            throw;
+        }
+        std::shared_ptr<T> pCreated;
+        auto pShader = cache.GetOrCreate(bytecode.key, [&]()
+            {
+                pCreated = std::make_shared<T>(pDevice, bytecode);
+                return typename ResourceCache<uint64_t, std::shared_ptr<T>>::Created{ pCreated, bytecode.size };
+            });
+        if (pShader == pCreated)
+        {
+            AddLiveShader(cache, pShader, filename, defines, stage, bytecode.key);
+        }
+        return pShader;
     }
 
-    com_ptr<ID3D11SamplerState> CreateSamplerState(ID3D11Device* pDevice,
-        const D3D11_SAMPLER_DESC& desc)
+    template<typename T>
+    std::shared_ptr<T> CreateRecordedShader(ResourceCache<uint64_t, std::shared_ptr<T>>& cache, ID3D11Device* pDevice,
+        const std::string& filename, const std::vector<std::pair<std::string, std::string>>& defines, ShaderStage stage)
+    {
+        auto pShader = GetOrCreateShader(cache, pDevice, filename, defines, stage);
+        g_warmupList.AddShader(stage, filename, defines);
+        return pShader;
+    }
+
+    template<typename Desc, typename State>
+    com_ptr<State> GetOrCreateState(StateCache<Desc, State>& cache, ID3D11Device* pDevice, const Desc& desc,
+        HRESULT(STDMETHODCALLTYPE ID3D11Device::* create)(const Desc*, State**))
+    {
+        return cache.GetOrCreate(desc, [&]()
+            {
+                com_ptr<State> ret;
+                check_hresult((pDevice->*create)(&desc, ret.put()));
+                return typename StateCache<Desc, State>::Created{ ret, sizeof(desc) };
+            });
+    }
+
+    // Creates the state a warm-up entry describes. Loading checked the description's size.
+    template<typename Desc, typename State>
+    com_ptr<State> GetOrCreateState(StateCache<Desc, State>& cache, ID3D11Device* pDevice,
+        const WarmupList::Entry& entry, HRESULT(STDMETHODCALLTYPE ID3D11Device::* create)(const Desc*, State**))
+    {
+        Desc desc{};
+        entry.GetDesc(&desc);
+        return GetOrCreateState(cache, pDevice, desc, create);
+    }
+
+    std::shared_ptr<const PipelineState> GetOrCreatePipelineState(const PipelineStateDesc& desc)
+    {
+        PipelineStateKey key{};
+        key.pVS = desc.pVS.get();
+        key.pPS = desc.pPS.get();
+        key.pRasterizerState = desc.pRasterizerState.get();
+        key.pBlendState = desc.pBlendState.get();
+        key.pDepthStencilState = desc.pDepthStencilState.get();
+        key.stencilRef = desc.stencilRef;
+        key.topology = desc.topology;
+        return g_pipelineStates.GetOrCreate(key, [&]()
+            {
+                return decltype(g_pipelineStates)::Created{
+                    std::make_shared<const PipelineState>(desc, g_nextPipelineStateId++), sizeof(PipelineState) };
+            });
+    }
+
+    template<typename State, typename Desc>
+    uint32_t RecordState(WarmupList::EntryType type, State* pState)
+    {
+        if (!pState)
+        {
+            return WarmupList::NO_ENTRY;
+        }
+        Desc desc{};
+        pState->GetDesc(&desc);
+        return g_warmupList.AddState(type, desc);
+    }
+
+    // Records a pipeline state after the entries it is made of. Shaders are recorded with the
+    // request that first created them, and states with the description read back from them.
+    void RecordPipelineState(const PipelineStateDesc& desc)
+    {
+        using EntryType = WarmupList::EntryType;
+
+        std::lock_guard lock(g_liveShadersMutex);
+        auto recordShader = [](const void* pShader)
+        {
+            auto it = g_liveShaderIndices.find(pShader);
+            if (it == g_liveShaderIndices.end())
+            {
+                return WarmupList::NO_ENTRY;
+            }
+            const auto& live = g_liveShaders[it->second];
+            return g_warmupList.AddShader(live.stage, live.filename, live.defines);
+        };
+
+        WarmupList::PipelineStateEntry pipeline{};
+        pipeline.vs = recordShader(desc.pVS.get());
+        pipeline.ps = desc.pPS ? recordShader(desc.pPS.get()) : WarmupList::NO_ENTRY;
+        if ((pipeline.vs == WarmupList::NO_ENTRY) || (desc.pPS && (pipeline.ps == WarmupList::NO_ENTRY)))
+        {
+            return;
+        }
+        pipeline.rasterizerState = RecordState<ID3D11RasterizerState, D3D11_RASTERIZER_DESC>(
+            EntryType::eRasterizerState, desc.pRasterizerState.get());
+        pipeline.blendState = RecordState<ID3D11BlendState, D3D11_BLEND_DESC>(
+            EntryType::eBlendState, desc.pBlendState.get());
+        pipeline.depthStencilState = RecordState<ID3D11DepthStencilState, D3D11_DEPTH_STENCIL_DESC>(
+            EntryType::eDepthStencilState, desc.pDepthStencilState.get());
+        pipeline.stencilRef = desc.stencilRef;
+        pipeline.topology = static_cast<uint32_t>(desc.topology);
+        g_warmupList.AddPipelineState(pipeline);
+    }
+
+    // Waits for warm-up shaders, reporting and leaving out those that failed
+    template<typename T>
+    std::unordered_map<size_t, std::shared_ptr<T>> GetWarmupShaders(
+        std::unordered_map<size_t, std::future<std::shared_ptr<T>>>& futures)
+    {
+        std::unordered_map<size_t, std::shared_ptr<T>> shaders;
+        for (auto& [index, future] : futures)
+        {
+            try
+            {
+                shaders[index] = future.get();
+            }
+            catch (const winrt::hresult_error& e)
+            {
+                std::cerr << "Warm-up shader failed: " << winrt::to_string(e.message()) << "\n";
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << "Warm-up shader failed: " << e.what() << "\n";
+            }
+        }
+        return shaders;
+    }
+
+    // One vertex element per input parameter, all in slot 0 and tightly packed in
+    // signature order. Semantic names point into the reflection object, which the caller keeps.
+    std::vector<D3D11_INPUT_ELEMENT_DESC> ReflectInputElements(const ShaderBytecode& bytecode,
+        ID3D11ShaderReflection** ppReflect)
+    {
+        com_ptr<ID3D11ShaderReflection> pReflect;
+        check_hresult(D3DReflect(bytecode.pData, bytecode.size, IID_PPV_ARGS(pReflect.put())));
+
+        D3D11_SHADER_DESC shaderDesc{};
+        pReflect->GetDesc(&shaderDesc);
+
+        std::vector<D3D11_INPUT_ELEMENT_DESC> inputElementDesc;
+        for (unsigned int i = 0; i < shaderDesc.InputParameters; i++)
+        {
+            D3D11_SIGNATURE_PARAMETER_DESC paramDesc{};
+            pReflect->GetInputParameterDesc(i, &paramDesc);
+
+            D3D11_INPUT_ELEMENT_DESC elementDesc{};
+            elementDesc.SemanticName = paramDesc.SemanticName;
+            elementDesc.SemanticIndex = paramDesc.SemanticIndex;
+            elementDesc.InputSlot = 0;
+            elementDesc.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+            elementDesc.InstanceDataStepRate = 0;
+            elementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+
+            if (paramDesc.Mask == 1)
+            {
+                switch (paramDesc.ComponentType)
+                {
+                case D3D_REGISTER_COMPONENT_UINT32:
+                    elementDesc.Format = DXGI_FORMAT_R32_UINT;
+                    break;
+                case D3D_REGISTER_COMPONENT_SINT32:
+                    elementDesc.Format = DXGI_FORMAT_R32_SINT;
+                    break;
+                case D3D_REGISTER_COMPONENT_FLOAT32:
+                    elementDesc.Format = DXGI_FORMAT_R32_FLOAT;
+                    break;
+                }
+            }
+            else if (paramDesc.Mask < 4)
+            {
+                switch (paramDesc.ComponentType)
+                {
+                case D3D_REGISTER_COMPONENT_UINT32:
+                    elementDesc.Format = DXGI_FORMAT_R32G32_UINT;
+                    break;
+                case D3D_REGISTER_COMPONENT_SINT32:
+                    elementDesc.Format = DXGI_FORMAT_R32G32_SINT;
+                    break;
+                case D3D_REGISTER_COMPONENT_FLOAT32:
+                    elementDesc.Format = DXGI_FORMAT_R32G32_FLOAT;
+                    break;
+                }
+            }
+            else if (paramDesc.Mask < 8)
+            {
+                switch (paramDesc.ComponentType)
+                {
+                case D3D_REGISTER_COMPONENT_UINT32:
+                    elementDesc.Format = DXGI_FORMAT_R32G32B32_UINT;
+                    break;
+                case D3D_REGISTER_COMPONENT_SINT32:
+                    elementDesc.Format = DXGI_FORMAT_R32G32B32_SINT;
+                    break;
+                case D3D_REGISTER_COMPONENT_FLOAT32:
+                    elementDesc.Format = DXGI_FORMAT_R32G32B32_FLOAT;
+                    break;
+                }
+            }
+            else if (paramDesc.Mask < 16)
+            {
+                switch (paramDesc.ComponentType)
+                {
+                case D3D_REGISTER_COMPONENT_UINT32:
+                    elementDesc.Format = DXGI_FORMAT_R32G32B32A32_UINT;
+                    break;
+                case D3D_REGISTER_COMPONENT_SINT32:
+                    elementDesc.Format = DXGI_FORMAT_R32G32B32A32_SINT;
+                    break;
+                case D3D_REGISTER_COMPONENT_FLOAT32:
+                    elementDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+                    break;
+                }
+            }
+            inputElementDesc.push_back(elementDesc);
+        }
+        *ppReflect = pReflect.detach();
+        return inputElementDesc;
+    }
+
+    // Hash of the vertex format an element list describes
+    uint64_t HashInputElements(const std::vector<D3D11_INPUT_ELEMENT_DESC>& elements)
     {
-        std::string key = CreateKey(desc);
-        com_ptr<ID3D11SamplerState> ret = g_samplerStates[key];
-        if (!ret)
+        uint64_t hash = HASH_SEED;
+        for (const auto& element : elements)
         {
-            check_hresult(pDevice->CreateSamplerState(&desc, ret.put()));
+            hash = HashString(element.SemanticName, hash);
+            hash = HashBytes(&element.SemanticIndex, sizeof(element.SemanticIndex), hash);
+            hash = HashBytes(&element.Format, sizeof(element.Format), hash);
+            hash = HashBytes(&element.InputSlot, sizeof(element.InputSlot), hash);
+            hash = HashBytes(&element.AlignedByteOffset, sizeof(element.AlignedByteOffset), hash);
+            hash = HashBytes(&element.InputSlotClass, sizeof(element.InputSlotClass), hash);
         }
+        return hash;
+    }
+}
+
+namespace dx
+{
+    std::shared_ptr<VertexShader> CreateVertexShader(ID3D11Device* pDevice, const std::string& filename,
+        const std::vector<std::pair<std::string, std::string>>& defines)
+    {
+        return CreateRecordedShader(g_vertexShaders, pDevice, filename, defines, ShaderStage::eVertex);
+    }
+
+    std::shared_ptr<PixelShader> CreatePixelShader(ID3D11Device* pDevice, const std::string& filename,
+        const std::vector<std::pair<std::string, std::string>>& defines)
+    {
+        return CreateRecordedShader(g_pixelShaders, pDevice, filename, defines, ShaderStage::ePixel);
+    }
+
+    std::shared_ptr<ComputeShader> CreateComputeShader(ID3D11Device* pDevice, const std::string& filename,
+        const std::vector<std::pair<std::string, std::string>>& defines)
+    {
+        return CreateRecordedShader(g_computeShaders, pDevice, filename, defines, ShaderStage::eCompute);
+    }
+
+    com_ptr<ID3D11InputLayout> CreateInputLayout(ID3D11Device* pDevice, const ShaderBytecode& bytecode)
+    {
+        com_ptr<ID3DBlob> signature;
+        check_hresult(D3DGetInputSignatureBlob(bytecode.pData, bytecode.size, signature.put()));
+        const uint64_t signatureKey = HashBytes(signature->GetBufferPointer(), signature->GetBufferSize());
+
+        return g_inputSignatures.GetOrCreate(signatureKey, [&]()
+            {
+                com_ptr<ID3D11ShaderReflection> pReflect;
+                const auto elements = ReflectInputElements(bytecode, pReflect.put());
+                const size_t bytes = elements.size() * sizeof(D3D11_INPUT_ELEMENT_DESC);
+
+                // Signatures that differ only in ways the layout does not see share one object
+                auto ret = g_inputLayouts.GetOrCreate(HashInputElements(elements), [&]()
+                    {
+                        com_ptr<ID3D11InputLayout> layout;
+                        check_hresult(pDevice->CreateInputLayout(elements.data(),
+                            static_cast<unsigned int>(elements.size()),
+                            bytecode.pData, bytecode.size, layout.put()));
+                        return decltype(g_inputLayouts)::Created{ layout, bytes };
+                    });
+                return decltype(g_inputSignatures)::Created{ ret, signature->GetBufferSize() };
+            });
+    }
+
+    com_ptr<ID3D11SamplerState> CreateSamplerState(ID3D11Device* pDevice,
+        const D3D11_SAMPLER_DESC& desc)
+    {
+        auto ret = GetOrCreateState(g_samplerStates, pDevice, desc, &ID3D11Device::CreateSamplerState);
+        g_warmupList.AddState(WarmupList::EntryType::eSamplerState, desc);
         return ret;
     }
 
     com_ptr<ID3D11RasterizerState> CreateRasterizerState(ID3D11Device* pDevice,
         const D3D11_RASTERIZER_DESC& desc)
     {
-        std::string key = CreateKey(desc);
-        com_ptr<ID3D11RasterizerState> ret = g_rasterizerStates[key];
-        if (!ret)
-        {
-            check_hresult(pDevice->CreateRasterizerState(&desc, ret.put()));
-        }
+        auto ret = GetOrCreateState(g_rasterizerStates, pDevice, desc, &ID3D11Device::CreateRasterizerState);
+        g_warmupList.AddState(WarmupList::EntryType::eRasterizerState, desc);
         return ret;
     }
 
     com_ptr<ID3D11DepthStencilState> CreateDepthStencilState(ID3D11Device* pDevice,
         const D3D11_DEPTH_STENCIL_DESC& desc)
     {
-        std::string key = CreateKey(desc);
-        com_ptr<ID3D11DepthStencilState> ret = g_depthStencilStates[key];
-        if (!ret)
-        {
-            check_hresult(pDevice->CreateDepthStencilState(&desc, ret.put()));
-        }
+        auto ret = GetOrCreateState(g_depthStencilStates, pDevice, desc, &ID3D11Device::CreateDepthStencilState);
+        g_warmupList.AddState(WarmupList::EntryType::eDepthStencilState, desc);
         return ret;
     }
 
     com_ptr<ID3D11BlendState> CreateBlendState(ID3D11Device* pDevice,
         const D3D11_BLEND_DESC& desc)
     {
-        std::string key = CreateKey(desc);
-        com_ptr<ID3D11BlendState> ret = g_blendStates[key];
-        if (!ret)
-        {
-            check_hresult(pDevice->CreateBlendState(&desc, ret.put()));
-        }
+        auto ret = GetOrCreateState(g_blendStates, pDevice, desc, &ID3D11Device::CreateBlendState);
+        g_warmupList.AddState(WarmupList::EntryType::eBlendState, desc);
         return ret;
     }
 
     com_ptr<ID3D11ShaderResourceView> CreateTexture(ID3D11Device* pDevice,
-        const std::string& filename)
+        const std::string& filename, uint32_t skipMips, uint32_t maxDimension)
     {
-        com_ptr<ID3D11ShaderResourceView> ret = g_textures[filename];
-        if (!ret)
+        std::string key = filename;
+        if (skipMips > 0 || maxDimension > 0)
         {
-            DirectX::CreateDDSTextureFromFile(pDevice, StringToWstring(filename).c_str(), nullptr, ret.put());
+            key += "|" + std::to_string(skipMips) + "|" + std::to_string(maxDimension);
         }
+        return g_textures.GetOrCreate(key, [&]()
+            {
+                // Loading from the mapped file lets the device read the pixels without a heap copy.
+                // Files that cannot be mapped leave the view null, like a failed load.
+                com_ptr<ID3D11ShaderResourceView> ret;
+                try
+                {
+                    MappedFile file(filename);
+                    ret = CreateTextureFromDDSMemory(pDevice, file.GetData(), file.GetSize(), skipMips, maxDimension);
+                }
+                catch (const winrt::hresult_error&)
+                {
+                }
+                catch (const std::exception&)
+                {
+                }
+                return decltype(g_textures)::Created{ ret, ret ? GetTextureSize(ret.get()) : 0 };
+            });
+    }
+
+    std::shared_ptr<const PipelineState> CreatePipelineState(const PipelineStateDesc& desc)
+    {
+        auto ret = GetOrCreatePipelineState(desc);
+        RecordPipelineState(desc);
         return ret;
     }
 
+    TaskPool& GetShaderCompilePool()
+    {
+        static TaskPool pool;
+        return pool;
+    }
+
+    size_t WarmUp(ID3D11Device* pDevice, const std::filesystem::path& path)
+    {
+        WarmupList list;
+        if (!list.Load(path))
+        {
+            return 0;
+        }
+        const auto entries = list.GetEntries();
+
+        // Holds a reference so jobs still running after an early return have a valid device
+        com_ptr<ID3D11Device> device;
+        device.copy_from(pDevice);
+
+        // Shaders compile on the pool. Each job owns a copy of its entry, so nothing it uses
+        // belongs to this frame.
+        std::unordered_map<size_t, std::future<std::shared_ptr<VertexShader>>> vertexShaderJobs;
+        std::unordered_map<size_t, std::future<std::shared_ptr<PixelShader>>> pixelShaderJobs;
+        std::unordered_map<size_t, std::future<std::shared_ptr<ComputeShader>>> computeShaderJobs;
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            const auto& entry = entries[i];
+            if (entry.type != WarmupList::EntryType::eShader)
+            {
+                continue;
+            }
+            switch (entry.stage)
+            {
+            case ShaderStage::eVertex:
+                vertexShaderJobs[i] = GetShaderCompilePool().Submit([device, entry]()
+                    {
+                        return GetOrCreateShader(g_vertexShaders, device.get(), entry.path, entry.defines,
+                            ShaderStage::eVertex);
+                    });
+                break;
+            case ShaderStage::ePixel:
+                pixelShaderJobs[i] = GetShaderCompilePool().Submit([device, entry]()
+                    {
+                        return GetOrCreateShader(g_pixelShaders, device.get(), entry.path, entry.defines,
+                            ShaderStage::ePixel);
+                    });
+                break;
+            case ShaderStage::eCompute:
+                computeShaderJobs[i] = GetShaderCompilePool().Submit([device, entry]()
+                    {
+                        return GetOrCreateShader(g_computeShaders, device.get(), entry.path, entry.defines,
+                            ShaderStage::eCompute);
+                    });
+                break;
+            }
+        }
+
+        // States are cheap, so they are created here meanwhile
+        size_t created = 0;
+        for (const auto& entry : entries)
+        {
+            try
+            {
+                switch (entry.type)
+                {
+                case WarmupList::EntryType::eSamplerState:
+                    GetOrCreateState(g_samplerStates, pDevice, entry, &ID3D11Device::CreateSamplerState);
+                    created++;
+                    break;
+                case WarmupList::EntryType::eRasterizerState:
+                    GetOrCreateState(g_rasterizerStates, pDevice, entry, &ID3D11Device::CreateRasterizerState);
+                    created++;
+                    break;
+                case WarmupList::EntryType::eDepthStencilState:
+                    GetOrCreateState(g_depthStencilStates, pDevice, entry, &ID3D11Device::CreateDepthStencilState);
+                    created++;
+                    break;
+                case WarmupList::EntryType::eBlendState:
+                    GetOrCreateState(g_blendStates, pDevice, entry, &ID3D11Device::CreateBlendState);
+                    created++;
+                    break;
+                default:
+                    break;
+                }
+            }
+            catch (const winrt::hresult_error& e)
+            {
+                std::cerr << "Warm-up state failed: " << winrt::to_string(e.message()) << "\n";
+            }
+        }
+
+        // A shader that no longer compiles is reported and then created, or not, on first use
+        const auto vertexShaders = GetWarmupShaders(vertexShaderJobs);
+        const auto pixelShaders = GetWarmupShaders(pixelShaderJobs);
+        const auto computeShaders = GetWarmupShaders(computeShaderJobs);
+        created += vertexShaders.size() + pixelShaders.size() + computeShaders.size();
+
+        // Pipeline states come last, as they are made of the entries above. Any made of a
+        // shader that failed are left out.
+        for (const auto& entry : entries)
+        {
+            if (entry.type != WarmupList::EntryType::ePipelineState)
+            {
+                continue;
+            }
+            const auto& pipeline = entry.pipeline;
+            auto vs = vertexShaders.find(pipeline.vs);
+            auto ps = pixelShaders.find(pipeline.ps);
+            if ((vs == vertexShaders.end()) || ((pipeline.ps != WarmupList::NO_ENTRY) && (ps == pixelShaders.end())))
+            {
+                continue;
+            }
+
+            try
+            {
+                PipelineStateDesc desc;
+                desc.pVS = vs->second;
+                if (ps != pixelShaders.end())
+                {
+                    desc.pPS = ps->second;
+                }
+                if (pipeline.rasterizerState != WarmupList::NO_ENTRY)
+                {
+                    desc.pRasterizerState = GetOrCreateState(g_rasterizerStates, pDevice,
+                        entries[pipeline.rasterizerState], &ID3D11Device::CreateRasterizerState);
+                }
+                if (pipeline.blendState != WarmupList::NO_ENTRY)
+                {
+                    desc.pBlendState = GetOrCreateState(g_blendStates, pDevice,
+                        entries[pipeline.blendState], &ID3D11Device::CreateBlendState);
+                }
+                if (pipeline.depthStencilState != WarmupList::NO_ENTRY)
+                {
+                    desc.pDepthStencilState = GetOrCreateState(g_depthStencilStates, pDevice,
+                        entries[pipeline.depthStencilState], &ID3D11Device::CreateDepthStencilState);
+                }
+                desc.stencilRef = pipeline.stencilRef;
+                desc.topology = static_cast<D3D11_PRIMITIVE_TOPOLOGY>(pipeline.topology);
+                GetOrCreatePipelineState(desc);
+                created++;
+            }
+            catch (const winrt::hresult_error& e)
+            {
+                std::cerr << "Warm-up pipeline state failed: " << winrt::to_string(e.message()) << "\n";
+            }
+        }
+        return created;
+    }
+
+    void SaveWarmupList(const std::filesystem::path& path)
+    {
+        g_warmupList.Save(path);
+    }
+
+    void ReloadShaders(ID3D11Device* pDevice, const std::vector<std::string>& changedFiles)
+    {
+        // Holds a reference so jobs still running at shutdown have a valid device
+        com_ptr<ID3D11Device> device;
+        device.copy_from(pDevice);
+
+        // Cached source hashes are trusted until dropped here, before anything is recompiled
+        ForgetShaderSourceHashes(changedFiles);
+
+        auto affects = [&](const std::vector<std::string>& dependencies)
+        {
+            return std::any_of(changedFiles.begin(), changedFiles.end(),
+                [&](const std::string& changed) { return DependsOn(dependencies, changed); });
+        };
+
+        std::vector<std::function<void()>> retryHandlers;
+        {
+            std::lock_guard lock(g_liveShadersMutex);
+            for (size_t i = 0; i < g_liveShaders.size(); i++)
+            {
+                auto& live = g_liveShaders[i];
+                if (affects(GetShaderDependencies(live.key)))
+                {
+                    // A newer change supersedes any reload of this shader still in flight
+                    const uint32_t generation = ++live.generation;
+                    GetShaderCompilePool().Submit([device, i, generation]()
+                        {
+                            RecompileLiveShader(device.get(), i, generation);
+                        });
+                }
+            }
+
+            // Failed shaders are dropped here, and added again if the retry fails too
+            auto firstRetried = std::remove_if(g_failedShaders.begin(), g_failedShaders.end(), affects);
+            if (firstRetried != g_failedShaders.end())
+            {
+                g_failedShaders.erase(firstRetried, g_failedShaders.end());
+                retryHandlers = g_retryHandlers;
+            }
+        }
+
+        // Handlers request shaders again, which takes the lock
+        for (const auto& handler : retryHandlers)
+        {
+            handler();
+        }
+    }
+
+    void AddShaderRetryHandler(std::function<void()> handler)
+    {
+        std::lock_guard lock(g_liveShadersMutex);
+        g_retryHandlers.push_back(std::move(handler));
+    }
+
+    size_t ApplyShaderReloads()
+    {
+        std::lock_guard lock(g_liveShadersMutex);
+        size_t applied = 0;
+        for (auto& reload : g_pendingReloads)
+        {
+            auto& live = g_liveShaders[reload.index];
+            if (reload.generation == live.generation)
+            {
+                reload.swap(live.key);
+                live.key = reload.key;
+                applied++;
+            }
+        }
+        g_pendingReloads.clear();
+        return applied;
+    }
+
+    std::vector<ResourceCacheStats> GetResourceCacheStats()
+    {
+        return {
+            g_samplerStates.GetStats(),
+            g_blendStates.GetStats(),
+            g_rasterizerStates.GetStats(),
+            g_depthStencilStates.GetStats(),
+            g_vertexShaders.GetStats(),
+            g_pixelShaders.GetStats(),
+            g_computeShaders.GetStats(),
+            g_inputSignatures.GetStats(),
+            g_inputLayouts.GetStats(),
+            g_textures.GetStats(),
+            g_pipelineStates.GetStats()
+        };
+    }
+
     void D3DCache::CreateTexture2D(ID3D11Device* pDevice, const std::string& name,
         const D3D11_TEXTURE2D_DESC& desc)
     {
@@ -1,16 +1,24 @@
 #pragma once
 
 #include "Shader.h"
+#include "PipelineState.h"
+#include "TaskPool.h"
+#include "ResourceCache.h"
 
 namespace dx
 {
-	// Cached resource loading methods
+	// Cached resource loading methods. Every object is created once and shared by all callers.
+	// Shaders are shared by compiled bytecode, so permutations whose defines do not affect a
+	// stage return the same object. Safe to call from any thread.
 	std::shared_ptr<VertexShader> CreateVertexShader(ID3D11Device* pDevice, const std::string& filename,
-		const std::vector<std::pair<std::string, std::string>>& defines = {}, uint64_t optionsKey = 0);
+		const std::vector<std::pair<std::string, std::string>>& defines = {});
 	std::shared_ptr<PixelShader> CreatePixelShader(ID3D11Device* pDevice, const std::string& filename,
-		const std::vector<std::pair<std::string, std::string>>& defines = {}, uint64_t optionsKey = 0);
+		const std::vector<std::pair<std::string, std::string>>& defines = {});
 	std::shared_ptr<ComputeShader> CreateComputeShader(ID3D11Device* pDevice, const std::string& filename,
-		const std::vector<std::pair<std::string, std::string>>& defines = {}, uint64_t optionsKey = 0);
+		const std::vector<std::pair<std::string, std::string>>& defines = {});
+	// Shared by all vertex shaders with the same vertex format, so that switching between them
+	// does not change the input layout
+	winrt::com_ptr<ID3D11InputLayout> CreateInputLayout(ID3D11Device* pDevice, const ShaderBytecode& bytecode);
 	winrt::com_ptr<ID3D11SamplerState> CreateSamplerState(ID3D11Device* pDevice,
 		const D3D11_SAMPLER_DESC& desc);
 	winrt::com_ptr<ID3D11RasterizerState> CreateRasterizerState(ID3D11Device* pDevice,
@@ -19,8 +27,37 @@ namespace dx
 		const D3D11_DEPTH_STENCIL_DESC& desc);
 	winrt::com_ptr<ID3D11BlendState> CreateBlendState(ID3D11Device* pDevice,
 		const D3D11_BLEND_DESC& desc);
+	// Loads a DDS texture without its top skipMips mips and any mip larger than maxDimension
+	// across, where zero means no limit. Each combination of limits is cached separately.
 	winrt::com_ptr<ID3D11ShaderResourceView> CreateTexture(ID3D11Device* pDevice,
-		const std::string& filename);
+		const std::string& filename, uint32_t skipMips = 0, uint32_t maxDimension = 0);
+	// Interned by the identity of the shaders and states, which are themselves interned above
+	std::shared_ptr<const PipelineState> CreatePipelineState(const PipelineStateDesc& desc);
+
+	// Worker threads for background shader compilation
+	TaskPool& GetShaderCompilePool();
+
+	// Shaders, states and pipeline states requested through the functions above are recorded
+	// for the session once they have been created. WarmUp creates everything in a list saved by
+	// a previous session, compiling shaders in parallel, and returns the number of entries
+	// created. It records nothing itself, and reports and skips entries that fail.
+	size_t WarmUp(ID3D11Device* pDevice, const std::filesystem::path& path);
+	void SaveWarmupList(const std::filesystem::path& path);
+
+	// Development support for editing shaders while running. ReloadShaders recompiles every
+	// shader built from one of the given files, or from a file under one of the given
+	// directories, on the compile pool. A shader that fails to compile keeps its previous code.
+	// ApplyShaderReloads swaps the recompiled code into the existing shader objects, so every
+	// pipeline state and effect picks it up, and returns the number swapped. It must be called on
+	// the render thread, after which any PipelineStateTracker must be invalidated.
+	void ReloadShaders(ID3D11Device* pDevice, const std::vector<std::string>& changedFiles);
+	size_t ApplyShaderReloads();
+	// Called by ReloadShaders when a changed file is one that a failed shader read, so that
+	// whoever requested it can try again
+	void AddShaderRetryHandler(std::function<void()> handler);
+
+	// Hit, miss and memory counters for each of the caches behind the functions above
+	std::vector<ResourceCacheStats> GetResourceCacheStats();
 
 	class D3DCache
 	{
@@ -19,7 +19,7 @@ namespace dx
         m_pLinearComp = CreateSamplerState(pDevice, LinearCompDesc());
     }
 
-    constexpr D3D11_SAMPLER_DESC CommonSamplerStates::LinearWrapDesc()
+    D3D11_SAMPLER_DESC CommonSamplerStates::LinearWrapDesc()
     {
         D3D11_SAMPLER_DESC desc{};
         desc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
@@ -30,7 +30,7 @@ namespace dx
         return desc;
     }
 
-    constexpr D3D11_SAMPLER_DESC CommonSamplerStates::LinearClampDesc()
+    D3D11_SAMPLER_DESC CommonSamplerStates::LinearClampDesc()
     {
         D3D11_SAMPLER_DESC desc{};
         desc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
@@ -41,7 +41,7 @@ namespace dx
         return desc;
     }
 
-    constexpr D3D11_SAMPLER_DESC CommonSamplerStates::AnisotropicWrapDesc()
+    D3D11_SAMPLER_DESC CommonSamplerStates::AnisotropicWrapDesc()
     {
         D3D11_SAMPLER_DESC desc{};
         desc.Filter = D3D11_FILTER_ANISOTROPIC;
@@ -53,7 +53,7 @@ namespace dx
         return desc;
     }
 
-    constexpr D3D11_SAMPLER_DESC CommonSamplerStates::AnisotropicClampDesc()
+    D3D11_SAMPLER_DESC CommonSamplerStates::AnisotropicClampDesc()
     {
         D3D11_SAMPLER_DESC desc{};
         desc.Filter = D3D11_FILTER_ANISOTROPIC;
@@ -65,7 +65,7 @@ namespace dx
         return desc;
     }
 
-    constexpr D3D11_SAMPLER_DESC CommonSamplerStates::PointWrapDesc()
+    D3D11_SAMPLER_DESC CommonSamplerStates::PointWrapDesc()
     {
         D3D11_SAMPLER_DESC desc{};
         desc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
@@ -76,7 +76,7 @@ namespace dx
         return desc;
     }
 
-    constexpr D3D11_SAMPLER_DESC CommonSamplerStates::PointClampDesc()
+    D3D11_SAMPLER_DESC CommonSamplerStates::PointClampDesc()
     {
         D3D11_SAMPLER_DESC desc{};
         desc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
@@ -87,7 +87,7 @@ namespace dx
         return desc;
     }
 
-    constexpr D3D11_SAMPLER_DESC CommonSamplerStates::PointCompDesc()
+    D3D11_SAMPLER_DESC CommonSamplerStates::PointCompDesc()
     {
         D3D11_SAMPLER_DESC desc{};
         desc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_MIP_POINT;
@@ -99,7 +99,7 @@ namespace dx
         return desc;
     }
 
-    constexpr D3D11_SAMPLER_DESC CommonSamplerStates::LinearCompDesc()
+    D3D11_SAMPLER_DESC CommonSamplerStates::LinearCompDesc()
     {
         D3D11_SAMPLER_DESC desc{};
         desc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR;
@@ -119,7 +119,7 @@ namespace dx
         m_pWireframe = CreateRasterizerState(pDevice, WireframeDesc());
     }
 
-    constexpr D3D11_RASTERIZER_DESC CommonRasterizerStates::CullNoneDesc()
+    D3D11_RASTERIZER_DESC CommonRasterizerStates::CullNoneDesc()
     {
         D3D11_RASTERIZER_DESC desc{};
         desc.FillMode = D3D11_FILL_SOLID;
@@ -128,7 +128,7 @@ namespace dx
         return desc;
     }
 
-    constexpr D3D11_RASTERIZER_DESC CommonRasterizerStates::CullFrontDesc()
+    D3D11_RASTERIZER_DESC CommonRasterizerStates::CullFrontDesc()
     {
         D3D11_RASTERIZER_DESC desc{};
         desc.FillMode = D3D11_FILL_SOLID;
@@ -137,7 +137,7 @@ namespace dx
         return desc;
     }
 
-    constexpr D3D11_RASTERIZER_DESC CommonRasterizerStates::CullBackDesc()
+    D3D11_RASTERIZER_DESC CommonRasterizerStates::CullBackDesc()
     {
         D3D11_RASTERIZER_DESC desc{};
         desc.FillMode = D3D11_FILL_SOLID;
@@ -146,7 +146,7 @@ namespace dx
         return desc;
     }
 
-    constexpr D3D11_RASTERIZER_DESC CommonRasterizerStates::WireframeDesc()
+    D3D11_RASTERIZER_DESC CommonRasterizerStates::WireframeDesc()
     {
         D3D11_RASTERIZER_DESC desc{};
         desc.FillMode = D3D11_FILL_WIREFRAME;
@@ -163,7 +163,7 @@ namespace dx
         m_pDepthEnabledWrite = CreateDepthStencilState(pDevice, DepthEnabledWriteDesc());
     }
 
-    constexpr D3D11_DEPTH_STENCIL_DESC CommonDepthStencilStates::DepthDisabledDesc()
+    D3D11_DEPTH_STENCIL_DESC CommonDepthStencilStates::DepthDisabledDesc()
     {
         D3D11_DEPTH_STENCIL_DESC desc{};
         desc.DepthEnable = false;
@@ -174,7 +174,7 @@ namespace dx
         return desc;
     }
 
-    constexpr D3D11_DEPTH_STENCIL_DESC CommonDepthStencilStates::DepthEnabledDesc()
+    D3D11_DEPTH_STENCIL_DESC CommonDepthStencilStates::DepthEnabledDesc()
     {
         D3D11_DEPTH_STENCIL_DESC desc{};
         desc.DepthEnable = true;
@@ -186,7 +186,7 @@ namespace dx
         return desc;
     }
 
-    constexpr D3D11_DEPTH_STENCIL_DESC CommonDepthStencilStates::DepthEnabledWriteDesc()
+    D3D11_DEPTH_STENCIL_DESC CommonDepthStencilStates::DepthEnabledWriteDesc()
     {
         D3D11_DEPTH_STENCIL_DESC desc{};
         desc.DepthEnable = true;
@@ -207,7 +207,7 @@ namespace dx
         m_pColorWriteDisabled = CreateBlendState(pDevice, ColorWriteDisabledDesc());
     }
 
-    constexpr D3D11_BLEND_DESC CommonBlendStates::DisabledDesc()
+    D3D11_BLEND_DESC CommonBlendStates::DisabledDesc()
     {
         D3D11_BLEND_DESC desc{};
         for (auto& rtDesc : desc.RenderTarget)
@@ -218,7 +218,7 @@ namespace dx
         return desc;
     }
 
-    constexpr D3D11_BLEND_DESC CommonBlendStates::AlphaDesc()
+    D3D11_BLEND_DESC CommonBlendStates::AlphaDesc()
     {
         D3D11_BLEND_DESC desc{};
         for (auto& rtDesc : desc.RenderTarget)
@@ -234,7 +234,7 @@ namespace dx
         return desc;
     }
 
-    constexpr D3D11_BLEND_DESC CommonBlendStates::PremultipliedAlphaDesc()
+    D3D11_BLEND_DESC CommonBlendStates::PremultipliedAlphaDesc()
     {
         D3D11_BLEND_DESC desc{};
         for (auto& rtDesc : desc.RenderTarget)
@@ -250,7 +250,7 @@ namespace dx
         return desc;
     }
 
-    constexpr D3D11_BLEND_DESC CommonBlendStates::AdditiveDesc()
+    D3D11_BLEND_DESC CommonBlendStates::AdditiveDesc()
     {
         D3D11_BLEND_DESC desc{};
         for (auto& rtDesc : desc.RenderTarget)
@@ -266,7 +266,7 @@ namespace dx
         return desc;
     }
 
-    constexpr D3D11_BLEND_DESC CommonBlendStates::ColorWriteDisabledDesc()
+    D3D11_BLEND_DESC CommonBlendStates::ColorWriteDisabledDesc()
     {
         D3D11_BLEND_DESC desc{};
         for (auto& rtDesc : desc.RenderTarget)
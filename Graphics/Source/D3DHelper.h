@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Buffers.h"
+#include "Cascades.h"
+#include "PipelineState.h"
 
 namespace dx
 {
@@ -11,9 +13,9 @@ namespace dx
 		DirectX::XMFLOAT3 eye;					// Camera eye position
 		DirectX::XMFLOAT4X4 viewProj;			// Premultiplied view-projection matrix
 		DirectX::XMFLOAT4X4 view;				// View matrix
-		DirectX::XMFLOAT4X4 lightViewProj[3];	// For cascaded shadow mapping
-		float cascadeSplits[3];					// View space depth splits for shadow cascades
-		float pad;
+		DirectX::XMFLOAT4X4 lightViewProj[SHADOW_CASCADE_COUNT];	// For cascaded shadow mapping
+		float cascadeSplits[4];					// View space depth splits for shadow cascades
+		uint32_t cascadeRemap[4];				// Shadow pass instance to cascade, for time slicing
 	};
 #pragma pack()
 
@@ -38,14 +40,14 @@ namespace dx
 		ID3D11SamplerState* PointComp() const { return m_pPointComp.get(); }
 		ID3D11SamplerState* LinearComp() const { return m_pLinearComp.get(); }
 
-		static constexpr D3D11_SAMPLER_DESC LinearWrapDesc();
-		static constexpr D3D11_SAMPLER_DESC LinearClampDesc();
-		static constexpr D3D11_SAMPLER_DESC AnisotropicWrapDesc();
-		static constexpr D3D11_SAMPLER_DESC AnisotropicClampDesc();
-		static constexpr D3D11_SAMPLER_DESC PointWrapDesc();
-		static constexpr D3D11_SAMPLER_DESC PointClampDesc();
-		static constexpr D3D11_SAMPLER_DESC PointCompDesc();
-		static constexpr D3D11_SAMPLER_DESC LinearCompDesc();
+		static D3D11_SAMPLER_DESC LinearWrapDesc();
+		static D3D11_SAMPLER_DESC LinearClampDesc();
+		static D3D11_SAMPLER_DESC AnisotropicWrapDesc();
+		static D3D11_SAMPLER_DESC AnisotropicClampDesc();
+		static D3D11_SAMPLER_DESC PointWrapDesc();
+		static D3D11_SAMPLER_DESC PointClampDesc();
+		static D3D11_SAMPLER_DESC PointCompDesc();
+		static D3D11_SAMPLER_DESC LinearCompDesc();
 
 	private:
 		winrt::com_ptr<ID3D11SamplerState> m_pLinearWrap;
@@ -68,10 +70,10 @@ namespace dx
 		ID3D11RasterizerState* CullBack() const { return m_pCullBack.get(); }
 		ID3D11RasterizerState* Wireframe() const { return m_pWireframe.get(); }
 
-		static constexpr D3D11_RASTERIZER_DESC CullNoneDesc();
-		static constexpr D3D11_RASTERIZER_DESC CullFrontDesc();
-		static constexpr D3D11_RASTERIZER_DESC CullBackDesc();
-		static constexpr D3D11_RASTERIZER_DESC WireframeDesc();
+		static D3D11_RASTERIZER_DESC CullNoneDesc();
+		static D3D11_RASTERIZER_DESC CullFrontDesc();
+		static D3D11_RASTERIZER_DESC CullBackDesc();
+		static D3D11_RASTERIZER_DESC WireframeDesc();
 
 	private:
 		winrt::com_ptr<ID3D11RasterizerState> m_pCullNone;
@@ -91,11 +93,11 @@ namespace dx
 		ID3D11BlendState* Additive() const { return m_pAdditive.get(); }
 		ID3D11BlendState* ColorWriteDisabled() const { return m_pColorWriteDisabled.get(); }
 
-		static constexpr D3D11_BLEND_DESC DisabledDesc();
-		static constexpr D3D11_BLEND_DESC AlphaDesc();
-		static constexpr D3D11_BLEND_DESC PremultipliedAlphaDesc();
-		static constexpr D3D11_BLEND_DESC AdditiveDesc();
-		static constexpr D3D11_BLEND_DESC ColorWriteDisabledDesc();
+		static D3D11_BLEND_DESC DisabledDesc();
+		static D3D11_BLEND_DESC AlphaDesc();
+		static D3D11_BLEND_DESC PremultipliedAlphaDesc();
+		static D3D11_BLEND_DESC AdditiveDesc();
+		static D3D11_BLEND_DESC ColorWriteDisabledDesc();
 
 	private:
 		winrt::com_ptr<ID3D11BlendState> m_pDisabled;
@@ -114,9 +116,9 @@ namespace dx
 		ID3D11DepthStencilState* DepthEnabled() const { return m_pDepthEnabled.get(); }
 		ID3D11DepthStencilState* DepthEnabledWrite() const { return m_pDepthEnabledWrite.get(); }
 
-		static constexpr D3D11_DEPTH_STENCIL_DESC DepthDisabledDesc();
-		static constexpr D3D11_DEPTH_STENCIL_DESC DepthEnabledDesc();
-		static constexpr D3D11_DEPTH_STENCIL_DESC DepthEnabledWriteDesc();
+		static D3D11_DEPTH_STENCIL_DESC DepthDisabledDesc();
+		static D3D11_DEPTH_STENCIL_DESC DepthEnabledDesc();
+		static D3D11_DEPTH_STENCIL_DESC DepthEnabledWriteDesc();
 
 	private:
 		winrt::com_ptr<ID3D11DepthStencilState> m_pDepthDisabled;
@@ -137,6 +139,9 @@ namespace dx
 		const CommonBlendStates& BlendStates() const { return m_blendStates; }
 		const CommonDepthStencilStates& DepthStencilStates() const { return m_depthStencilStates; }
 
+		// Pipeline state currently applied to the immediate context
+		PipelineStateTracker& StateTracker() { return m_stateTracker; }
+
 		// Common constant buffers and samplers can be bound once at startup as an optimization.
 		// They are defined for all shaders in Common.hlsli. Still allow them to be accessed 
 		// individually in case they need to be bound to another as well slot for some reason.
@@ -148,5 +153,6 @@ namespace dx
 		CommonRasterizerStates m_rasterizerStates;
 		CommonBlendStates m_blendStates;
 		CommonDepthStencilStates m_depthStencilStates;
+		PipelineStateTracker m_stateTracker;
 	};
 }
\ No newline at end of file
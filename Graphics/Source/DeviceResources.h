@@ -45,6 +45,11 @@ namespace dx
 			return m_viewport;
 		}
 
+		const DXGI_ADAPTER_DESC& GetAdapterDesc() const
+		{
+			return m_adapterDesc;
+		}
+
 		void Present();
 
 	private:
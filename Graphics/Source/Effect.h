@@ -1,6 +1,7 @@
 #pragma once
 
 #include "D3DHelper.h"
+#include "PipelineState.h"
 
 namespace dx
 {
@@ -8,6 +9,18 @@ namespace dx
 	{
 		virtual ~Effect() = default;
 
+		// Shaders and fixed function state, applied through a PipelineStateTracker. Only null
+		// when the effect is not ready.
+		virtual const PipelineState* GetPipelineState() const = 0;
+
+		// Binds the effect's resources and constants
 		virtual void Bind(ID3D11DeviceContext* pContext) const = 0;
+
+		// False while the effect's shaders are still compiling, in which case draws using it
+		// should be skipped
+		virtual bool IsReady() const
+		{
+			return true;
+		}
 	};
 }
\ No newline at end of file
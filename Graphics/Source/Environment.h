@@ -0,0 +1,17 @@
+#pragma once
+
+namespace dx
+{
+	// Image based lighting baked offline with "Converter --ibl". Materials fall back to a
+	// constant ambient term if the files are missing.
+	constexpr const char* ENVIRONMENT_SPECULAR_PATH = "Assets/Environment/specular.dds";
+	constexpr const char* ENVIRONMENT_IRRADIANCE_PATH = "Assets/Environment/irradiance.dds";
+	constexpr const char* ENVIRONMENT_BRDF_PATH = "Assets/Environment/brdf.dds";
+
+	inline bool HasBakedEnvironment()
+	{
+		return std::filesystem::exists(ENVIRONMENT_SPECULAR_PATH) &&
+			std::filesystem::exists(ENVIRONMENT_IRRADIANCE_PATH) &&
+			std::filesystem::exists(ENVIRONMENT_BRDF_PATH);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "stdafx.h"
+
+#include "FileWatcher.h"
+
+#include "Util.h"
+
+namespace dx
+{
+	FileWatcher::FileWatcher(const std::filesystem::path& directory, Callback callback) :
+		m_directory(directory.lexically_normal()),
+		m_callback(std::move(callback))
+	{
+		m_directoryHandle.attach(CreateFileW(m_directory.c_str(), FILE_LIST_DIRECTORY,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+			FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr));
+		if (!m_directoryHandle)
+		{
+			winrt::throw_last_error();
+		}
+
+		m_stopEvent.attach(CreateEventW(nullptr, TRUE, FALSE, nullptr));
+		if (!m_stopEvent)
+		{
+			winrt::throw_last_error();
+		}
+
+		m_thread = std::thread(&FileWatcher::Run, this);
+	}
+
+	FileWatcher::~FileWatcher()
+	{
+		SetEvent(m_stopEvent.get());
+		m_thread.join();
+	}
+
+	void FileWatcher::Run()
+	{
+		winrt::handle changeEvent(CreateEventW(nullptr, TRUE, FALSE, nullptr));
+		if (!changeEvent)
+		{
+			std::cerr << "File watcher failed to start for " << m_directory << "\n";
+			return;
+		}
+
+		// Notifications are a chain of DWORD aligned FILE_NOTIFY_INFORMATION records
+		std::vector<DWORD> buffer(16 * 1024 / sizeof(DWORD));
+		OVERLAPPED overlapped{};
+		overlapped.hEvent = changeEvent.get();
+		bool reading = false;
+		std::set<std::string> changed;
+
+		while (true)
+		{
+			if (!reading)
+			{
+				ResetEvent(changeEvent.get());
+				if (!ReadDirectoryChangesW(m_directoryHandle.get(), buffer.data(),
+					static_cast<DWORD>(buffer.size() * sizeof(DWORD)), TRUE,
+					FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE, nullptr, &overlapped, nullptr))
+				{
+					std::cerr << "File watcher stopped watching " << m_directory << "\n";
+					return;
+				}
+				reading = true;
+			}
+
+			// Report once nothing has changed for a while
+			const HANDLE handles[] = { m_stopEvent.get(), changeEvent.get() };
+			DWORD result = WaitForMultipleObjects(2, handles, FALSE, changed.empty() ? INFINITE : QUIET_PERIOD_MS);
+			if (result == WAIT_OBJECT_0 + 1)
+			{
+				reading = false;
+				DWORD bytes = 0;
+				if (!GetOverlappedResult(m_directoryHandle.get(), &overlapped, &bytes, FALSE))
+				{
+					continue;
+				}
+				if (bytes == 0)
+				{
+					// The buffer overflowed and the individual changes are lost
+					changed.insert(m_directory.generic_string());
+					continue;
+				}
+
+				const auto* pBytes = reinterpret_cast<const uint8_t*>(buffer.data());
+				while (true)
+				{
+					const auto* pInfo = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(pBytes);
+					std::wstring name(pInfo->FileName, pInfo->FileNameLength / sizeof(WCHAR));
+					changed.insert(WstringToString((m_directory / name).lexically_normal().generic_wstring()));
+					if (pInfo->NextEntryOffset == 0)
+					{
+						break;
+					}
+					pBytes += pInfo->NextEntryOffset;
+				}
+			}
+			else if (result == WAIT_TIMEOUT)
+			{
+				try
+				{
+					m_callback(std::vector<std::string>(changed.begin(), changed.end()));
+				}
+				catch (const std::exception& e)
+				{
+					std::cerr << "File watcher callback failed: " << e.what() << "\n";
+				}
+				changed.clear();
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		// Wait for the outstanding read to be cancelled, since it writes to the buffer
+		if (reading)
+		{
+			DWORD bytes = 0;
+			CancelIoEx(m_directoryHandle.get(), &overlapped);
+			GetOverlappedResult(m_directoryHandle.get(), &overlapped, &bytes, TRUE);
+		}
+	}
+}
\ No newline at end of file
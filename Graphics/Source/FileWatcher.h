@@ -0,0 +1,33 @@
+#pragma once
+
+namespace dx
+{
+	// Watches a directory tree on a background thread and reports changed files in batches.
+	// Editors often write a file several times when saving, so changes are collected until the
+	// directory has been quiet for a moment. Paths are relative to the working directory, in
+	// the same normalized form as shader manifests. If changes were lost because too many
+	// happened at once, the directory itself is reported.
+	class FileWatcher
+	{
+	public:
+		// Called on the watcher thread
+		using Callback = std::function<void(const std::vector<std::string>& paths)>;
+
+		FileWatcher(const std::filesystem::path& directory, Callback callback);
+		~FileWatcher();
+
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+
+	private:
+		static constexpr DWORD QUIET_PERIOD_MS = 100;
+
+		std::filesystem::path m_directory;
+		Callback m_callback;
+		winrt::file_handle m_directoryHandle;
+		winrt::handle m_stopEvent;
+		std::thread m_thread;
+
+		void Run();
+	};
+}
\ No newline at end of file
@@ -0,0 +1,214 @@
+#pragma once
+
+namespace dx
+{
+	// Open addressing hash map with linear probing over a single power of two sized array.
+	// Lookups touch contiguous memory and do no allocation, which suits small, hot tables such
+	// as state object caches. Erasing shifts later entries of the probe sequence back instead of
+	// leaving tombstones. Any insertion or erase invalidates iterators.
+	template<typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>>
+	class FlatHashMap
+	{
+	public:
+		using value_type = std::pair<Key, Value>;
+
+		template<typename Slots, typename Element>
+		class Iterator
+		{
+		public:
+			Iterator(Slots* pSlots, size_t index) :
+				m_pSlots(pSlots),
+				m_index(index)
+			{
+				SkipEmpty();
+			}
+
+			Element& operator*() const
+			{
+				return *(*m_pSlots)[m_index];
+			}
+
+			Element* operator->() const
+			{
+				return &*(*m_pSlots)[m_index];
+			}
+
+			Iterator& operator++()
+			{
+				m_index++;
+				SkipEmpty();
+				return *this;
+			}
+
+			bool operator==(const Iterator& rhs) const
+			{
+				return m_index == rhs.m_index;
+			}
+
+			bool operator!=(const Iterator& rhs) const
+			{
+				return m_index != rhs.m_index;
+			}
+
+		private:
+			friend class FlatHashMap;
+
+			Slots* m_pSlots;
+			size_t m_index;
+
+			void SkipEmpty()
+			{
+				while (m_index < m_pSlots->size() && !(*m_pSlots)[m_index])
+				{
+					m_index++;
+				}
+			}
+		};
+
+		using iterator = Iterator<std::vector<std::optional<value_type>>, value_type>;
+		using const_iterator = Iterator<const std::vector<std::optional<value_type>>, const value_type>;
+
+		FlatHashMap() :
+			m_size(0)
+		{
+		}
+
+		iterator begin() { return iterator(&m_slots, 0); }
+		iterator end() { return iterator(&m_slots, m_slots.size()); }
+		const_iterator begin() const { return const_iterator(&m_slots, 0); }
+		const_iterator end() const { return const_iterator(&m_slots, m_slots.size()); }
+
+		size_t size() const
+		{
+			return m_size;
+		}
+
+		bool empty() const
+		{
+			return m_size == 0;
+		}
+
+		iterator find(const Key& key)
+		{
+			return iterator(&m_slots, FindIndex(key));
+		}
+
+		const_iterator find(const Key& key) const
+		{
+			return const_iterator(&m_slots, FindIndex(key));
+		}
+
+		template<typename... Args>
+		std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args)
+		{
+			size_t index = FindIndex(key);
+			if (index != m_slots.size())
+			{
+				return { iterator(&m_slots, index), false };
+			}
+
+			// Keep the load factor at or below one half so probe sequences stay short
+			if ((m_size + 1) * 2 > m_slots.size())
+			{
+				Rehash(std::max<size_t>(16, m_slots.size() * 2));
+			}
+
+			index = GetHomeSlot(key, m_slots.size() - 1);
+			while (m_slots[index])
+			{
+				index = (index + 1) & (m_slots.size() - 1);
+			}
+			m_slots[index].emplace(std::piecewise_construct, std::forward_as_tuple(key),
+				std::forward_as_tuple(std::forward<Args>(args)...));
+			m_size++;
+			return { iterator(&m_slots, index), true };
+		}
+
+		void erase(iterator it)
+		{
+			const size_t mask = m_slots.size() - 1;
+			size_t hole = it.m_index;
+			m_slots[hole].reset();
+			m_size--;
+
+			// Move back any following entry whose home slot is at or before the hole, so every
+			// entry stays reachable from its home slot without passing an empty slot
+			for (size_t index = (hole + 1) & mask; m_slots[index]; index = (index + 1) & mask)
+			{
+				size_t home = GetHomeSlot(m_slots[index]->first, mask);
+				if (((index - home) & mask) >= ((index - hole) & mask))
+				{
+					m_slots[hole] = std::move(m_slots[index]);
+					m_slots[index].reset();
+					hole = index;
+				}
+			}
+		}
+
+		size_t erase(const Key& key)
+		{
+			auto it = find(key);
+			if (it == end())
+			{
+				return 0;
+			}
+			erase(it);
+			return 1;
+		}
+
+		void clear()
+		{
+			m_slots.clear();
+			m_size = 0;
+		}
+
+	private:
+		std::vector<std::optional<value_type>> m_slots;
+		size_t m_size;
+
+		// Fibonacci hashing spreads the hash over the table, since its low bits alone may be
+		// poorly distributed, eg. when the same hash already picked a ResourceCache shard
+		static size_t GetHomeSlot(const Key& key, size_t mask)
+		{
+			uint64_t hash = static_cast<uint64_t>(Hash{}(key)) * 11400714819323198485ull;
+			return static_cast<size_t>(hash >> 32) & mask;
+		}
+
+		// Returns the slot holding key, or the slot count if it is not present
+		size_t FindIndex(const Key& key) const
+		{
+			if (m_slots.empty())
+			{
+				return 0;
+			}
+
+			const size_t mask = m_slots.size() - 1;
+			for (size_t index = GetHomeSlot(key, mask); m_slots[index]; index = (index + 1) & mask)
+			{
+				if (Equal{}(m_slots[index]->first, key))
+				{
+					return index;
+				}
+			}
+			return m_slots.size();
+		}
+
+		void Rehash(size_t capacity)
+		{
+			std::vector<std::optional<value_type>> slots(capacity);
+			std::swap(slots, m_slots);
+			for (auto& slot : slots)
+			{
+				if (slot)
+				{
+					size_t index = GetHomeSlot(slot->first, capacity - 1);
+					while (m_slots[index])
+					{
+						index = (index + 1) & (capacity - 1);
+					}
+					m_slots[index] = std::move(slot);
+				}
+			}
+		}
+	};
+}
\ No newline at end of file
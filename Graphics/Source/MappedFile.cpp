@@ -0,0 +1,75 @@
+#include "stdafx.h"
+
+#include "MappedFile.h"
+
+using winrt::check_bool;
+
+namespace dx
+{
+	MappedFile::MappedFile(const std::filesystem::path& path) :
+		m_pData(nullptr),
+		m_size(0)
+	{
+		winrt::file_handle file(CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+		if (!file)
+		{
+			winrt::throw_last_error();
+		}
+
+		LARGE_INTEGER size{};
+		check_bool(GetFileSizeEx(file.get(), &size));
+		if (size.QuadPart == 0 || static_cast<uint64_t>(size.QuadPart) > SIZE_MAX)
+		{
+			throw std::runtime_error("Cannot map " + path.string());
+		}
+
+		// The view keeps the file open after both handles are closed
+		winrt::handle mapping(CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+		if (!mapping)
+		{
+			winrt::throw_last_error();
+		}
+		m_pData = static_cast<const uint8_t*>(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0));
+		if (!m_pData)
+		{
+			winrt::throw_last_error();
+		}
+		m_size = static_cast<size_t>(size.QuadPart);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		UnmapViewOfFile(m_pData);
+	}
+
+	MappedFileCache::MappedFileCache(size_t capacity) :
+		m_capacity(capacity)
+	{
+	}
+
+	std::shared_ptr<const MappedFile> MappedFileCache::Open(const std::filesystem::path& path)
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			auto it = std::find_if(m_files.begin(), m_files.end(),
+				[&](const auto& file) { return file.first == path; });
+			if (it != m_files.end())
+			{
+				m_files.splice(m_files.begin(), m_files, it);
+				return it->second;
+			}
+		}
+
+		// Map outside the lock. Two threads opening the same file may both map it, which is harmless.
+		auto pFile = std::make_shared<const MappedFile>(path);
+
+		std::lock_guard lock(m_mutex);
+		m_files.emplace_front(path, pFile);
+		if (m_files.size() > m_capacity)
+		{
+			m_files.pop_back();
+		}
+		return pFile;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+namespace dx
+{
+	// A whole file mapped read-only into memory. Pages are read from disk as they are touched,
+	// so the pixels of a texture can be handed to the device without copying them first.
+	class MappedFile
+	{
+	public:
+		explicit MappedFile(const std::filesystem::path& path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const uint8_t* GetData() const { return m_pData; }
+		size_t GetSize() const { return m_size; }
+
+	private:
+		const uint8_t* m_pData;
+		size_t m_size;
+	};
+
+	// Keeps the most recently opened files mapped, so that reading a file again, eg. to stream
+	// more mips of a texture, does not map it again. Files stay mapped while anyone holds them,
+	// even after the cache has let go. Safe to call from any thread.
+	class MappedFileCache
+	{
+	public:
+		explicit MappedFileCache(size_t capacity = 16);
+
+		// Throws if the file cannot be opened or mapped
+		std::shared_ptr<const MappedFile> Open(const std::filesystem::path& path);
+
+	private:
+		size_t m_capacity;
+		std::mutex m_mutex;
+		std::list<std::pair<std::filesystem::path, std::shared_ptr<const MappedFile>>> m_files;	// Most recent first
+	};
+}
\ No newline at end of file
@@ -4,6 +4,10 @@
 #include "D3DCache.h"
 #include "D3DHelper.h"
 #include "Shader.h"
+#include "ShaderCache.h"
+#include "Cascades.h"
+#include "PermutationCache.h"
+#include "TextureStreamer.h"
 
 namespace dx
 {
@@ -21,26 +25,42 @@ namespace dx
 				bool useRoughnessMap : 1;
 				bool useMetalnessMap : 1;
 				bool useNormalMap : 1;
+				bool useMomentShadows : 1;
+				bool useEnvironmentMaps : 1;
 			};
 
 			Bits bits;
 			uint32_t key;
 
+			// One bit per field, so new options are enumerated without further changes
+			static constexpr uint32_t BIT_COUNT = static_cast<uint32_t>(CountFields<Bits>());
+			static_assert(BIT_COUNT < 32 && sizeof(Bits) <= sizeof(uint32_t), "Options must fit in the key");
+
 			Options() : key(0) { }
 		};
 
 		// Configurable resources
 		struct Resources
+		{
+			// Textures, streamed in as they are needed
+			std::shared_ptr<StreamingTexture> color;
+			std::shared_ptr<StreamingTexture> orm;
+			std::shared_ptr<StreamingTexture> normal;
+		};
+
+		// Resources shared by every PBREffect in a pass, bound once with BindPass
+		struct PassResources
 		{
 			// Global list of lights
 			winrt::com_ptr<ID3D11ShaderResourceView> lights;
 
-			// Textures
-			winrt::com_ptr<ID3D11ShaderResourceView> color;
-			winrt::com_ptr<ID3D11ShaderResourceView> orm;
-			winrt::com_ptr<ID3D11ShaderResourceView> normal;
-
+			// Shadow cascade depths, or their moments with useMomentShadows
 			winrt::com_ptr<ID3D11ShaderResourceView> cascades;
+
+			// Baked image based lighting, used with useEnvironmentMaps
+			winrt::com_ptr<ID3D11ShaderResourceView> specularEnvironment;
+			winrt::com_ptr<ID3D11ShaderResourceView> irradianceSH;
+			winrt::com_ptr<ID3D11ShaderResourceView> brdfLUT;
 		};
 
 		// Per-material constants
@@ -62,54 +82,224 @@ namespace dx
 			return m_constants.data;
 		}
 
+		// Shaders are compiled in the background. Until they are ready the effect renders with the
+		// closest compiled permutation, or not at all if there is none.
 		PBREffect(ID3D11Device* pDevice, Options options) : 
 			m_options(options),
 			m_constants(pDevice),
 			m_cbDirty(true)
 		{
-			auto defines = GetDefines(options);
-			m_pVS = CreateVertexShader(pDevice, "Source/Shaders/PBR.vs.hlsl", defines, options.key);
-			m_pPS = CreatePixelShader(pDevice, "Source/Shaders/PBR.ps.hlsl", defines, options.key);
+			m_pProgram = GetPermutationCache(pDevice).Request(options.key);
 		}
 
-		void Bind(ID3D11DeviceContext* pContext) const override
+		// Option combinations the scene loader can produce. Maps require texcoords, tangents are
+		// only present on normal mapped meshes and the shadow technique is fixed at compile time.
+		static std::vector<Options> EnumerateOptions()
 		{
-			if (m_cbDirty)
+			std::vector<Options> ret;
+			for (uint32_t key = 0; key < (1u << Options::BIT_COUNT); key++)
 			{
-				m_constants.Update(pContext);
-				m_cbDirty = false;
+				Options options;
+				options.key = key;
+				const auto& bits = options.bits;
+
+				bool useMaps = bits.useColorMap || bits.useOcclusionMap || bits.useRoughnessMap ||
+					bits.useMetalnessMap || bits.useNormalMap;
+				if ((useMaps && !bits.hasTexcoords) || (bits.hasTangents != bits.useNormalMap) ||
+					(bits.useMomentShadows != SHADOW_USE_MOMENTS))
+				{
+					continue;
+				}
+				ret.push_back(options);
 			}
-			
-			m_pVS->Bind(pContext);
-			m_pPS->Bind(pContext);
-			
-			BindShaderResourcesPS(pContext, 0, resources.lights.get());
-			m_constants.BindPS(pContext, 2);
+			return ret;
+		}
 
-			if (m_options.bits.useColorMap)
+		static std::vector<ShaderPermutation> GetPermutations()
+		{
+			std::vector<ShaderPermutation> ret;
+			for (auto options : EnumerateOptions())
 			{
-				BindShaderResourcesPS(pContext, 1, resources.color.get());
+				auto defines = GetDefines(options);
+				ret.push_back({ "Source/Shaders/PBR.vs.hlsl", ShaderStage::eVertex, defines });
+				ret.push_back({ "Source/Shaders/PBR.ps.hlsl", ShaderStage::ePixel, defines });
 			}
-			if (m_options.bits.useOcclusionMap || m_options.bits.useRoughnessMap || m_options.bits.useMetalnessMap)
+			return ret;
+		}
+
+		bool IsReady() const override
+		{
+			return m_pProgram->Get() != nullptr;
+		}
+
+		// False while drawing with a fallback permutation
+		bool HasFinalShaders() const
+		{
+			return m_pProgram->IsFinal();
+		}
+
+		// The program may be swapped by a worker thread at any time. Fallbacks read a subset of
+		// the final permutation's slots, so binding with a newer layout than the state applied
+		// only binds resources that go unread.
+		const PipelineState* GetPipelineState() const override
+		{
+			auto pProgram = m_pProgram->Get();
+			return pProgram ? pProgram->pState.get() : nullptr;
+		}
+
+		// Binds the shared resources for every PBREffect drawn until the next call
+		static void BindPass(ID3D11DeviceContext* pContext, const PassResources& resources)
+		{
+			BindShaderResourcesPS(pContext, LIGHTS_SLOT, resources.lights.get());
+			BindShaderResourcesPS(pContext, CASCADES_SLOT, resources.cascades.get(),
+				resources.specularEnvironment.get(), resources.irradianceSH.get(), resources.brdfLUT.get());
+		}
+
+		// Asks for the material's textures to be streamed in at this many texels across
+		void RequestTextureSize(uint32_t size)
+		{
+			for (auto* pTexture : { resources.color.get(), resources.orm.get(), resources.normal.get() })
 			{
-				BindShaderResourcesPS(pContext, 2, resources.orm.get());
+				if (pTexture)
+				{
+					pTexture->RequestSize(size);
+				}
 			}
-			if (m_options.bits.useNormalMap)
+		}
+
+		// Stamps the material's textures as drawn this frame, so they are evicted last
+		void MarkDrawn()
+		{
+			for (auto* pTexture : { resources.color.get(), resources.orm.get(), resources.normal.get() })
 			{
-				BindShaderResourcesPS(pContext, 3, resources.normal.get());
+				if (pTexture)
+				{
+					pTexture->MarkDrawn();
+				}
 			}
-			BindShaderResourcesPS(pContext, 4, resources.cascades.get());
+		}
+
+		// Binds the material in as few range calls as the pixel shader's slots allow
+		void Bind(ID3D11DeviceContext* pContext) const override
+		{
+			auto pProgram = m_pProgram->Get();
+			if (!pProgram)
+			{
+				return;
+			}
+
+			if (m_cbDirty)
+			{
+				m_constants.Update(pContext);
+				m_cbDirty = false;
+			}
+
+			// Shader reloads may change the slots the pixel shader reads
+			const auto& pPS = pProgram->pState->GetDesc().pPS;
+			if (!pProgram->bindingsVersion || *pProgram->bindingsVersion != pPS->GetVersion())
+			{
+				pProgram->bindings = BindingLayout(pPS->GetBindings(), GetSharedBindings());
+				pProgram->bindingsVersion = pPS->GetVersion();
+			}
+
+			std::array<ID3D11ShaderResourceView*, SLOT_COUNT> views{};
+			views[COLOR_SLOT] = resources.color ? resources.color->GetView() : nullptr;
+			views[ORM_SLOT] = resources.orm ? resources.orm->GetView() : nullptr;
+			views[NORMAL_SLOT] = resources.normal ? resources.normal->GetView() : nullptr;
+			std::array<ID3D11Buffer*, MATERIAL_CB_SLOT + 1> buffers{};
+			buffers[MATERIAL_CB_SLOT] = m_constants.GetBuffer();
+			pProgram->bindings.BindPS(pContext, views.data(), views.size(), buffers.data(), buffers.size());
 		}
 		
 	private:
+		// Register slots from PBR.ps.hlsl
+		static constexpr unsigned int LIGHTS_SLOT = 0;
+		static constexpr unsigned int COLOR_SLOT = 1;
+		static constexpr unsigned int ORM_SLOT = 2;
+		static constexpr unsigned int NORMAL_SLOT = 3;
+		static constexpr unsigned int CASCADES_SLOT = 4;		// Followed by the three environment maps
+		static constexpr unsigned int SLOT_COUNT = 8;
+		static constexpr unsigned int MATERIAL_CB_SLOT = 2;
+
+		// A compiled permutation and how to bind resources for it. The layout is derived from the
+		// pixel shader on the render thread when first bound, and again after the shader reloads.
+		struct Program
+		{
+			std::shared_ptr<const PipelineState> pState;
+			mutable BindingLayout bindings;
+			mutable std::optional<uint32_t> bindingsVersion;
+		};
+
 		Options m_options;
 		ConstantBuffer<Constants> m_constants;
 		mutable bool m_cbDirty;
 
 		// Resources that cannot be configured by the user
 
-		std::shared_ptr<VertexShader> m_pVS;
-		std::shared_ptr<PixelShader> m_pPS;
+		std::shared_ptr<PermutationHandle<Program>> m_pProgram;
+
+		// Fallbacks must share the vertex layout and the shadow technique with the requested
+		// permutation. The remaining options only add features.
+		static uint32_t GetRequiredMask()
+		{
+			Options required;
+			required.bits.hasTexcoords = true;
+			required.bits.hasTangents = true;
+			required.bits.useMomentShadows = true;
+			return required.key;
+		}
+
+		// Slots bound by BindPass, and the constant buffers and samplers D3DHelper binds for the
+		// whole frame. Everything else is bound per draw.
+		static ShaderBindings GetSharedBindings()
+		{
+			ShaderBindings shared;
+			shared.shaderResources.set(LIGHTS_SLOT);
+			for (unsigned int slot = CASCADES_SLOT; slot < SLOT_COUNT; slot++)
+			{
+				shared.shaderResources.set(slot);
+			}
+			shared.constantBuffers.set();
+			shared.constantBuffers.reset(MATERIAL_CB_SLOT);
+			shared.samplers.set();
+			return shared;
+		}
+
+		static PermutationCache<Program>& GetPermutationCache(ID3D11Device* pDevice)
+		{
+			static PermutationCache<Program> cache(GetShaderCompilePool(), CreateCompiler(pDevice),
+				GetRequiredMask());
+			static std::once_flag retryRegistered;
+			std::call_once(retryRegistered, []()
+				{
+					AddShaderRetryHandler([]() { cache.RetryFailed(); });
+				});
+			return cache;
+		}
+
+		static PermutationCache<Program>::CompileFunc CreateCompiler(ID3D11Device* pDevice)
+		{
+			// Holds a reference so jobs still running at shutdown have a valid device
+			winrt::com_ptr<ID3D11Device> device;
+			device.copy_from(pDevice);
+			return [device](uint32_t key)
+			{
+				Options options;
+				options.key = key;
+				auto defines = GetDefines(options);
+
+				PipelineStateDesc desc;
+				desc.pVS = CreateVertexShader(device.get(), "Source/Shaders/PBR.vs.hlsl", defines);
+				desc.pPS = CreatePixelShader(device.get(), "Source/Shaders/PBR.ps.hlsl", defines);
+				desc.pRasterizerState = CreateRasterizerState(device.get(), CommonRasterizerStates::CullBackDesc());
+				desc.pDepthStencilState = CreateDepthStencilState(device.get(),
+					CommonDepthStencilStates::DepthEnabledWriteDesc());
+
+				auto pProgram = std::make_shared<Program>();
+				pProgram->pState = CreatePipelineState(desc);
+				return std::shared_ptr<const Program>(std::move(pProgram));
+			};
+		}
 
 		static std::vector<std::pair<std::string, std::string>> GetDefines(Options options)
 		{
@@ -142,6 +332,14 @@ namespace dx
 			{
 				defines.push_back({ "USE_NORMAL_MAP", "1" });
 			}
+			if (options.bits.useMomentShadows)
+			{
+				defines.push_back({ "USE_MOMENT_SHADOWS", "1" });
+			}
+			if (options.bits.useEnvironmentMaps)
+			{
+				defines.push_back({ "USE_IBL", "1" });
+			}
 			return defines;
 		}
 	};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dx
+{
+	// Runs fn(i) for i in [0, count) on all hardware threads. The first exception thrown by fn
+	// stops the remaining iterations and is rethrown once every thread has finished.
+	template<typename F>
+	void ParallelFor(size_t count, F&& fn)
+	{
+		std::atomic<size_t> next = 0;
+		std::exception_ptr error;
+		std::mutex errorMutex;
+		unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+		std::vector<std::thread> threads;
+		for (unsigned int t = 0; t < threadCount; t++)
+		{
+			threads.emplace_back([&]()
+				{
+					for (size_t i = next++; i < count; i = next++)
+					{
+						try
+						{
+							fn(i);
+						}
+						catch (...)
+						{
+							std::lock_guard lock(errorMutex);
+							if (!error)
+							{
+								error = std::current_exception();
+							}
+							next = count;
+						}
+					}
+				});
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+}
\ No newline at end of file
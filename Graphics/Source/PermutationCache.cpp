@@ -0,0 +1,31 @@
+#include "stdafx.h"
+
+#include "PermutationCache.h"
+
+namespace dx
+{
+	bool SelectFallback(uint32_t key, uint32_t requiredMask, const std::vector<uint32_t>& ready,
+		uint32_t* pFallback)
+	{
+		bool found = false;
+		size_t bestShared = 0;
+		for (uint32_t candidate : ready)
+		{
+			bool compatible = ((candidate & requiredMask) == (key & requiredMask)) &&
+				((candidate & ~key) == 0);
+			if (!compatible)
+			{
+				continue;
+			}
+
+			size_t shared = std::bitset<32>(candidate & key).count();
+			if (!found || shared > bestShared)
+			{
+				found = true;
+				bestShared = shared;
+				*pFallback = candidate;
+			}
+		}
+		return found;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "TaskPool.h"
+
+namespace dx
+{
+	// Picks a stand-in for a permutation that has not finished compiling. A candidate must match
+	// the requested key on every bit of requiredMask, and may only enable optional features the
+	// request also enables, so it never reads a resource the effect does not bind. The candidate
+	// sharing the most features wins. Returns false if no ready permutation qualifies.
+	bool SelectFallback(uint32_t key, uint32_t requiredMask, const std::vector<uint32_t>& ready,
+		uint32_t* pFallback);
+
+	// The permutation an effect renders with. Starts out empty or holding a fallback, and is
+	// swapped for the requested permutation once it has compiled.
+	template<typename T>
+	class PermutationHandle
+	{
+	public:
+		std::shared_ptr<const T> Get() const
+		{
+			return std::atomic_load(&m_pCurrent);
+		}
+
+		// True once the requested permutation, rather than a fallback, is in place
+		bool IsFinal() const
+		{
+			return m_final;
+		}
+
+		void Set(std::shared_ptr<const T> pCurrent, bool final)
+		{
+			std::atomic_store(&m_pCurrent, std::move(pCurrent));
+			m_final = final;
+		}
+
+	private:
+		std::shared_ptr<const T> m_pCurrent;
+		std::atomic<bool> m_final = false;
+	};
+
+	// Compiles permutations of an effect on a task pool. Each key is compiled at most once, and
+	// every handle requested for it is updated when it completes. A key that fails stays
+	// registered with its handles until RetryFailed compiles it again. The compile function is
+	// the only part that touches the device, so any backend can be substituted.
+	template<typename T>
+	class PermutationCache
+	{
+	public:
+		using CompileFunc = std::function<std::shared_ptr<const T>(uint32_t key)>;
+		using Future = std::shared_future<std::shared_ptr<const T>>;
+
+		PermutationCache(TaskPool& pool, CompileFunc compile, uint32_t requiredMask) :
+			m_pool(pool),
+			m_compile(std::move(compile)),
+			m_requiredMask(requiredMask)
+		{
+		}
+
+		// Jobs refer to the cache, so they must finish first
+		~PermutationCache()
+		{
+			Wait();
+		}
+
+		PermutationCache(const PermutationCache&) = delete;
+		PermutationCache& operator=(const PermutationCache&) = delete;
+
+		std::shared_ptr<PermutationHandle<T>> Request(uint32_t key)
+		{
+			auto pHandle = std::make_shared<PermutationHandle<T>>();
+
+			std::lock_guard lock(m_mutex);
+			if (auto it = m_ready.find(key); it != m_ready.end())
+			{
+				pHandle->Set(it->second, true);
+				return pHandle;
+			}
+
+			SetFallback(key, *pHandle);
+			auto [it, inserted] = m_pending.try_emplace(key);
+			it->second.handles.push_back(pHandle);
+			if (inserted)
+			{
+				it->second.future = m_pool.Submit([this, key]() { return Compile(key); }).share();
+			}
+			return pHandle;
+		}
+
+		// The result of compiling a key, or an invalid future if it was never requested
+		Future GetFuture(uint32_t key) const
+		{
+			std::lock_guard lock(m_mutex);
+			if (auto it = m_pending.find(key); it != m_pending.end())
+			{
+				return it->second.future;
+			}
+			if (auto it = m_ready.find(key); it != m_ready.end())
+			{
+				std::promise<std::shared_ptr<const T>> ready;
+				ready.set_value(it->second);
+				return ready.get_future().share();
+			}
+			return {};
+		}
+
+		// Compiles every failed permutation again, eg. after a source file changed, and returns
+		// how many were resubmitted. Their handles keep any fallback meanwhile.
+		size_t RetryFailed()
+		{
+			std::lock_guard lock(m_mutex);
+			size_t retried = 0;
+			for (auto& [key, pending] : m_pending)
+			{
+				if (pending.failed)
+				{
+					pending.failed = false;
+					pending.future = m_pool.Submit([this, retryKey = key]() { return Compile(retryKey); }).share();
+					retried++;
+				}
+			}
+			return retried;
+		}
+
+		// Blocks until every requested permutation has finished compiling
+		void Wait() const
+		{
+			std::vector<Future> futures;
+			{
+				std::lock_guard lock(m_mutex);
+				for (const auto& [key, pending] : m_pending)
+				{
+					futures.push_back(pending.future);
+				}
+			}
+			for (const auto& future : futures)
+			{
+				future.wait();
+			}
+		}
+
+	private:
+		struct Pending
+		{
+			Future future;
+			std::vector<std::shared_ptr<PermutationHandle<T>>> handles;
+			bool failed = false;
+		};
+
+		TaskPool& m_pool;
+		CompileFunc m_compile;
+		uint32_t m_requiredMask;
+
+		mutable std::mutex m_mutex;
+		std::unordered_map<uint32_t, std::shared_ptr<const T>> m_ready;
+		std::vector<uint32_t> m_readyKeys;
+		std::unordered_map<uint32_t, Pending> m_pending;
+
+		// Runs on a worker thread
+		std::shared_ptr<const T> Compile(uint32_t key)
+		{
+			std::shared_ptr<const T> pResult;
+			try
+			{
+				pResult = m_compile(key);
+			}
+			catch (const std::exception& e)
+			{
+				// Handles keep their fallback until a retry succeeds
+				std::cerr << "Failed to compile permutation " << key << ": " << e.what() << "\n";
+				std::lock_guard lock(m_mutex);
+				m_pending[key].failed = true;
+				throw;
+			}
+
+			std::lock_guard lock(m_mutex);
+			m_ready[key] = pResult;
+			m_readyKeys.push_back(key);
+			for (auto& pHandle : m_pending[key].handles)
+			{
+				pHandle->Set(pResult, true);
+			}
+			m_pending.erase(key);
+
+			// The new permutation may be a better stand-in for those still compiling
+			for (auto& [pendingKey, pending] : m_pending)
+			{
+				for (auto& pHandle : pending.handles)
+				{
+					SetFallback(pendingKey, *pHandle);
+				}
+			}
+			return pResult;
+		}
+
+		void SetFallback(uint32_t key, PermutationHandle<T>& handle) const
+		{
+			uint32_t fallback = 0;
+			if (SelectFallback(key, m_requiredMask, m_readyKeys, &fallback))
+			{
+				handle.Set(m_ready.at(fallback), false);
+			}
+		}
+	};
+}
\ No newline at end of file
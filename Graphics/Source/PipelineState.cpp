@@ -0,0 +1,70 @@
+#include "stdafx.h"
+
+#include "PipelineState.h"
+
+namespace dx
+{
+	PipelineStateTracker::PipelineStateTracker()
+	{
+		Invalidate();
+	}
+
+	void PipelineStateTracker::Apply(ID3D11DeviceContext* pContext, const PipelineState& state)
+	{
+		const auto& desc = state.GetDesc();
+		auto* pVS = desc.pVS ? desc.pVS->Get() : nullptr;
+		auto* pInputLayout = desc.pVS ? desc.pVS->GetInputLayout() : nullptr;
+		auto* pPS = desc.pPS ? desc.pPS->Get() : nullptr;
+
+		if (!m_valid || pVS != m_pVS)
+		{
+			pContext->VSSetShader(pVS, nullptr, 0);
+			m_pVS = pVS;
+		}
+		if (!m_valid || pInputLayout != m_pInputLayout)
+		{
+			pContext->IASetInputLayout(pInputLayout);
+			m_pInputLayout = pInputLayout;
+		}
+		if (!m_valid || pPS != m_pPS)
+		{
+			pContext->PSSetShader(pPS, nullptr, 0);
+			m_pPS = pPS;
+		}
+		if (!m_valid || desc.pRasterizerState.get() != m_pRasterizerState)
+		{
+			pContext->RSSetState(desc.pRasterizerState.get());
+			m_pRasterizerState = desc.pRasterizerState.get();
+		}
+		if (!m_valid || desc.pBlendState.get() != m_pBlendState)
+		{
+			pContext->OMSetBlendState(desc.pBlendState.get(), nullptr, 0xffffffff);
+			m_pBlendState = desc.pBlendState.get();
+		}
+		if (!m_valid || desc.pDepthStencilState.get() != m_pDepthStencilState || desc.stencilRef != m_stencilRef)
+		{
+			pContext->OMSetDepthStencilState(desc.pDepthStencilState.get(), desc.stencilRef);
+			m_pDepthStencilState = desc.pDepthStencilState.get();
+			m_stencilRef = desc.stencilRef;
+		}
+		if (!m_valid || desc.topology != m_topology)
+		{
+			pContext->IASetPrimitiveTopology(desc.topology);
+			m_topology = desc.topology;
+		}
+		m_valid = true;
+	}
+
+	void PipelineStateTracker::Invalidate()
+	{
+		m_valid = false;
+		m_pVS = nullptr;
+		m_pInputLayout = nullptr;
+		m_pPS = nullptr;
+		m_pRasterizerState = nullptr;
+		m_pBlendState = nullptr;
+		m_pDepthStencilState = nullptr;
+		m_stencilRef = 0;
+		m_topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Shader.h"
+
+namespace dx
+{
+	// Shaders and fixed function state for a draw. Everything except resources and constants.
+	struct PipelineStateDesc
+	{
+		std::shared_ptr<VertexShader> pVS;
+		std::shared_ptr<PixelShader> pPS;						// Null for depth only rendering
+		winrt::com_ptr<ID3D11RasterizerState> pRasterizerState;
+		winrt::com_ptr<ID3D11BlendState> pBlendState;			// Null for the default blend state
+		winrt::com_ptr<ID3D11DepthStencilState> pDepthStencilState;
+		unsigned int stencilRef = 0;
+		D3D11_PRIMITIVE_TOPOLOGY topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	};
+
+	// Immutable pipeline state, interned by CreatePipelineState so that equal descriptions share
+	// one object. Draws can be sorted by id to group identical state together.
+	class PipelineState
+	{
+	public:
+		PipelineState(const PipelineStateDesc& desc, uint32_t id) :
+			m_desc(desc),
+			m_id(id)
+		{
+		}
+
+		const PipelineStateDesc& GetDesc() const { return m_desc; }
+		uint32_t GetId() const { return m_id; }
+
+	private:
+		PipelineStateDesc m_desc;
+		uint32_t m_id;
+	};
+
+	// Remembers what was last applied to a context and only issues the calls whose state
+	// differs. Code that sets any of this state directly must call Invalidate afterwards.
+	class PipelineStateTracker
+	{
+	public:
+		PipelineStateTracker();
+
+		void Apply(ID3D11DeviceContext* pContext, const PipelineState& state);
+		void Invalidate();
+
+	private:
+		bool m_valid;
+		ID3D11VertexShader* m_pVS;
+		ID3D11InputLayout* m_pInputLayout;
+		ID3D11PixelShader* m_pPS;
+		ID3D11RasterizerState* m_pRasterizerState;
+		ID3D11BlendState* m_pBlendState;
+		ID3D11DepthStencilState* m_pDepthStencilState;
+		unsigned int m_stencilRef;
+		D3D11_PRIMITIVE_TOPOLOGY m_topology;
+	};
+}
\ No newline at end of file
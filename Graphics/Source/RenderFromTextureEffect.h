@@ -3,6 +3,7 @@
 #include "Effect.h"
 #include "D3DCache.h"
 #include "D3DHelper.h"
+#include "ShaderCache.h"
 
 namespace dx
 {
@@ -18,19 +19,33 @@ namespace dx
 
 		RenderFromTextureEffect(ID3D11Device* pDevice)
 		{
-			m_pVS = CreateVertexShader(pDevice, "Source/Shaders/FullScreenTriangle.vs.hlsl");
-			m_pPS = CreatePixelShader(pDevice, "Source/Shaders/RenderFromTexture.ps.hlsl");
+			PipelineStateDesc desc;
+			desc.pVS = CreateVertexShader(pDevice, "Source/Shaders/FullScreenTriangle.vs.hlsl");
+			desc.pPS = CreatePixelShader(pDevice, "Source/Shaders/RenderFromTexture.ps.hlsl");
+			desc.pRasterizerState = CreateRasterizerState(pDevice, CommonRasterizerStates::CullNoneDesc());
+			desc.pDepthStencilState = CreateDepthStencilState(pDevice, CommonDepthStencilStates::DepthDisabledDesc());
+			m_pPipelineState = CreatePipelineState(desc);
+		}
+
+		static std::vector<ShaderPermutation> GetPermutations()
+		{
+			return {
+				{ "Source/Shaders/FullScreenTriangle.vs.hlsl", ShaderStage::eVertex, {} },
+				{ "Source/Shaders/RenderFromTexture.ps.hlsl", ShaderStage::ePixel, {} }
+			};
+		}
+
+		const PipelineState* GetPipelineState() const override
+		{
+			return m_pPipelineState.get();
 		}
 
 		void Bind(ID3D11DeviceContext* pContext) const override
 		{
-			m_pVS->Bind(pContext);
-			m_pPS->Bind(pContext);
 			BindShaderResourcesPS(pContext, 0, resources.inputTexture.get());
 		}
 
 	private:
-		std::shared_ptr<VertexShader> m_pVS;
-		std::shared_ptr<PixelShader> m_pPS;
+		std::shared_ptr<const PipelineState> m_pPipelineState;
 	};
 }
@@ -4,15 +4,25 @@
 #include "Components.h"
 #include "PBREffect.h"
 #include "ShadowMapEffect.h"
+#include "Cascades.h"
+#include "Environment.h"
+
+using winrt::check_hresult;
 
 namespace
 {
-	constexpr unsigned int SHADOW_MAP_SIZE = 2048;
+	// Blend between logarithmic (1) and uniform (0) cascade splits
+	constexpr float CASCADE_SPLIT_LAMBDA = 0.7f;
+	// Fraction the reduced depth range is padded by to cover camera motion during readback
+	constexpr float SDSM_DEPTH_MARGIN = 0.05f;
+	// Fraction fitted cascades are padded by on each side when time sliced, so a cascade that is
+	// skipped for a few frames still covers its slice while the camera moves
+	constexpr float CASCADE_GUARD_BAND = 0.1f;
 }
 
 namespace dx
 {
-	OpaquePass::OpaquePass(const DeviceResources& resources, D3DCache& cache)
+	OpaquePass::OpaquePass(const DeviceResources& resources, D3DCache& cache, bool useEnvironmentMaps)
 	{
 		auto* pDevice = resources.GetDevice();
 		auto [width, height] = resources.GetSize();
@@ -53,6 +63,13 @@ namespace dx
 		srvDesc.Texture2D.MostDetailedMip = 0;
 		srvDesc.Texture2D.MipLevels = UINT_MAX;
 		cache.AddShaderResourceView(pDevice, "DepthBuffer", "DepthBuffer", srvDesc);
+
+		if (useEnvironmentMaps)
+		{
+			m_passResources.specularEnvironment = CreateTexture(pDevice, ENVIRONMENT_SPECULAR_PATH);
+			m_passResources.irradianceSH = CreateTexture(pDevice, ENVIRONMENT_IRRADIANCE_PATH);
+			m_passResources.brdfLUT = CreateTexture(pDevice, ENVIRONMENT_BRDF_PATH);
+		}
 	}
 
 	void OpaquePass::ResolveResources(D3DCache& cache)
@@ -61,8 +78,10 @@ namespace dx
 		assert(m_pFrameBuffer);
 		m_pDepthBuffer = cache.GetDepthStencilView("DepthBuffer");
 		assert(m_pDepthBuffer);
-		m_pCascades = cache.GetShaderResourceView("ShadowCascades");
-		assert(m_pCascades);
+		m_passResources.cascades = cache.GetShaderResourceView(SHADOW_USE_MOMENTS ? "ShadowMoments" : "ShadowCascades");
+		assert(m_passResources.cascades);
+		m_passResources.lights = cache.GetShaderResourceView("LightsBuffer");
+		assert(m_passResources.lights);
 	}
 	
 	void OpaquePass::Draw(const DeviceResources& resources, entt::registry& registry,
@@ -90,19 +109,37 @@ namespace dx
 		pContext->ClearRenderTargetView(m_pFrameBuffer.get(), color.data());
 		pContext->ClearDepthStencilView(m_pDepthBuffer.get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
 
-		pContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 		pContext->RSSetViewports(1, &resources.GetViewport());
-		pContext->RSSetState(helper.RasterizerStates().CullBack());
-		pContext->OMSetDepthStencilState(helper.DepthStencilStates().DepthEnabledWrite(), 0);
-		
-		auto view = registry.view<PBREffect, Geometry>();
+		PBREffect::BindPass(pContext, m_passResources);
+
+		// Sort visible objects by pipeline state so objects sharing one only set it once. Only
+		// drawn materials are marked, so textures out of view age for eviction.
+		const auto frustum = camera.GetFrustum();
+		auto view = registry.view<PBREffect, Geometry, MeshBounds>();
+		m_drawOrder.clear();
 		for (auto obj : view)
+		{
+			if (!frustum.Intersects(view.get<MeshBounds>(obj).sphere))
+			{
+				continue;
+			}
+			const auto* pState = view.get<PBREffect>(obj).GetPipelineState();
+			if (pState)
+			{
+				m_drawOrder.emplace_back(pState->GetId(), obj);
+			}
+		}
+		std::sort(m_drawOrder.begin(), m_drawOrder.end(),
+			[](const auto& a, const auto& b) { return a.first < b.first; });
+
+		for (auto [id, obj] : m_drawOrder)
 		{
 			auto& effect = view.get<PBREffect>(obj);
 			auto& geometry = view.get<Geometry>(obj);
 			geometry.Bind(pContext);
-			effect.resources.cascades = m_pCascades;
+			helper.StateTracker().Apply(pContext, *effect.GetPipelineState());
 			effect.Bind(pContext);
+			effect.MarkDrawn();
 			pContext->DrawIndexed(geometry.indices.GetIndexCount(), 0, 0);
 		}
 
@@ -163,14 +200,23 @@ namespace dx
 		
 		pContext->IASetVertexBuffers(0, 0, nullptr, nullptr, nullptr);
 		pContext->IASetIndexBuffer(nullptr, DXGI_FORMAT_UNKNOWN, 0);
-		pContext->OMSetDepthStencilState(helper.DepthStencilStates().DepthDisabled(), 0);
+		helper.StateTracker().Apply(pContext, *m_effect.GetPipelineState());
 		m_effect.Bind(pContext);
 		pContext->Draw(3, 0);
 
 		BindRenderTargets(pContext, nullptr);
 	}
 
-	ShadowPass::ShadowPass(const DeviceResources& resources, D3DCache& cache)
+	ShadowPass::ShadowPass(const DeviceResources& resources, D3DCache& cache,
+		Partitioning partitioning, Scheduling scheduling) :
+		m_partitioning(partitioning),
+		m_scheduling(scheduling),
+		m_cascadeViewProj(),
+		m_cascadeValid(),
+		m_cascadeLightDir(0.0f, 0.0f, 0.0f),
+		m_frameIndex(0),
+		m_minDepth(0.0f),
+		m_maxDepth(0.0f)
 	{
 		auto* pDevice = resources.GetDevice();
 
@@ -178,7 +224,7 @@ namespace dx
 		texDesc.Format = DXGI_FORMAT_R32_TYPELESS;
 		texDesc.Width = SHADOW_MAP_SIZE;
 		texDesc.Height = SHADOW_MAP_SIZE;
-		texDesc.ArraySize = 3;
+		texDesc.ArraySize = SHADOW_CASCADE_COUNT;
 		texDesc.MipLevels = 1;
 		texDesc.SampleDesc.Count = 1;
 		texDesc.SampleDesc.Quality = 0;
@@ -188,29 +234,230 @@ namespace dx
 		D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc{};
 		dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
 		dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
-		dsvDesc.Texture2DArray.ArraySize = 3;
+		dsvDesc.Texture2DArray.ArraySize = SHADOW_CASCADE_COUNT;
 		dsvDesc.Texture2DArray.FirstArraySlice = 0;
 		dsvDesc.Texture2DArray.MipSlice = 0;
 		cache.AddDepthStencilView(pDevice, "ShadowCascades", "ShadowCascades", dsvDesc);
 
+		// Single slice views, so cascades that are not refreshed keep their contents
+		dsvDesc.Texture2DArray.ArraySize = 1;
+		for (unsigned int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+		{
+			dsvDesc.Texture2DArray.FirstArraySlice = i;
+			cache.AddDepthStencilView(pDevice, "ShadowCascades", "ShadowCascade" + std::to_string(i), dsvDesc);
+		}
+
 		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc{};
 		srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
 		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
-		srvDesc.Texture2DArray.ArraySize = 3;
+		srvDesc.Texture2DArray.ArraySize = SHADOW_CASCADE_COUNT;
 		srvDesc.Texture2DArray.FirstArraySlice = 0;
 		srvDesc.Texture2DArray.MipLevels = 1;
 		srvDesc.Texture2DArray.MostDetailedMip = 0;
 		cache.AddShaderResourceView(pDevice, "ShadowCascades", "ShadowCascades", srvDesc);
 
-		auto rsDesc = CommonRasterizerStates::CullNoneDesc();
-		rsDesc.DepthClipEnable = false;
-		m_pRasterizerState = CreateRasterizerState(pDevice, rsDesc);
+		if constexpr (SHADOW_USE_MOMENTS)
+		{
+			// Full mip chain so the moments can be filtered in hardware. Two 32-bit moments per
+			// texel, since the warped depth overflows 16-bit floats: about 134 MB with the
+			// default three 2048x2048 cascades, plus 100 MB for the single mip blur target.
+			D3D11_TEXTURE2D_DESC momentsDesc = texDesc;
+			momentsDesc.Format = DXGI_FORMAT_R32G32_FLOAT;
+			momentsDesc.MipLevels = 0;
+			momentsDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_RENDER_TARGET;
+			momentsDesc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+			cache.CreateTexture2D(pDevice, "ShadowMoments", momentsDesc);
+			cache.AddShaderResourceView(pDevice, "ShadowMoments", "ShadowMoments");
+			cache.AddUnorderedAccessView(pDevice, "ShadowMoments", "ShadowMoments");
+
+			// Single slice views with every mip, so only refreshed cascades rebuild their mips
+			D3D11_SHADER_RESOURCE_VIEW_DESC momentsSrvDesc{};
+			momentsSrvDesc.Format = momentsDesc.Format;
+			momentsSrvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+			momentsSrvDesc.Texture2DArray.ArraySize = 1;
+			momentsSrvDesc.Texture2DArray.MipLevels = UINT(-1);
+			momentsSrvDesc.Texture2DArray.MostDetailedMip = 0;
+			for (unsigned int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+			{
+				momentsSrvDesc.Texture2DArray.FirstArraySlice = i;
+				cache.AddShaderResourceView(pDevice, "ShadowMoments", "ShadowMoments" + std::to_string(i), momentsSrvDesc);
+			}
+
+			// Intermediate result of the separable blur
+			momentsDesc.MipLevels = 1;
+			momentsDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+			momentsDesc.MiscFlags = 0;
+			cache.CreateTexture2D(pDevice, "ShadowMomentsTemp", momentsDesc);
+			cache.AddShaderResourceView(pDevice, "ShadowMomentsTemp", "ShadowMomentsTemp");
+			cache.AddUnorderedAccessView(pDevice, "ShadowMomentsTemp", "ShadowMomentsTemp");
+
+			m_pConvertMomentsCS = CreateComputeShader(pDevice, "Source/Shaders/EVSMBlur.hlsl",
+				{ { "CONVERT_DEPTH", "1" } });
+			m_pBlurMomentsCS = CreateComputeShader(pDevice, "Source/Shaders/EVSMBlur.hlsl");
+		}
+
+		if (m_partitioning == Partitioning::eSampleDistribution)
+		{
+			m_pDepthMinMaxCS = CreateComputeShader(pDevice, "Source/Shaders/DepthMinMax.hlsl");
+
+			// Two uints: min depth and inverted max depth
+			D3D11_BUFFER_DESC bufDesc{};
+			bufDesc.ByteWidth = 2 * sizeof(uint32_t);
+			bufDesc.Usage = D3D11_USAGE_DEFAULT;
+			bufDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+			bufDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+			check_hresult(pDevice->CreateBuffer(&bufDesc, nullptr, m_pMinMaxBuffer.put()));
+
+			D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc{};
+			uavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+			uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+			uavDesc.Buffer.FirstElement = 0;
+			uavDesc.Buffer.NumElements = 2;
+			uavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+			check_hresult(pDevice->CreateUnorderedAccessView(m_pMinMaxBuffer.get(), &uavDesc, m_pMinMaxUAV.put()));
+
+			D3D11_BUFFER_DESC stagingDesc{};
+			stagingDesc.ByteWidth = 2 * sizeof(uint32_t);
+			stagingDesc.Usage = D3D11_USAGE_STAGING;
+			stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+			for (auto& pReadback : m_minMaxReadback)
+			{
+				check_hresult(pDevice->CreateBuffer(&stagingDesc, nullptr, pReadback.put()));
+			}
+		}
 	}
 
 	void ShadowPass::ResolveResources(D3DCache& cache)
 	{
 		m_cascades = cache.GetDepthStencilView("ShadowCascades");
 		assert(m_cascades);
+		for (unsigned int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+		{
+			m_cascadeSlices[i] = cache.GetDepthStencilView("ShadowCascade" + std::to_string(i));
+			assert(m_cascadeSlices[i]);
+		}
+		if constexpr (SHADOW_USE_MOMENTS)
+		{
+			m_pCascadesSRV = cache.GetShaderResourceView("ShadowCascades");
+			m_pMomentsTempSRV = cache.GetShaderResourceView("ShadowMomentsTemp");
+			m_pMomentsTempUAV = cache.GetUnorderedAccessView("ShadowMomentsTemp");
+			m_pMomentsUAV = cache.GetUnorderedAccessView("ShadowMoments");
+			assert(m_pCascadesSRV && m_pMomentsTempSRV && m_pMomentsTempUAV && m_pMomentsUAV);
+			for (unsigned int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+			{
+				m_momentSlices[i] = cache.GetShaderResourceView("ShadowMoments" + std::to_string(i));
+				assert(m_momentSlices[i]);
+			}
+		}
+		if (m_partitioning == Partitioning::eSampleDistribution)
+		{
+			m_pDepthBuffer = cache.GetShaderResourceView("DepthBuffer");
+			assert(m_pDepthBuffer);
+		}
+	}
+
+	// Reduces the depth buffer to a min/max depth on the GPU and reads back an older result.
+	// The shadow pass runs before the opaque pass, so the depth buffer still holds the
+	// previous frame and the partitions lag the camera by a few frames.
+	void ShadowPass::ReduceDepth(ID3D11DeviceContext* pContext, const FlyCamera& camera)
+	{
+		// The oldest copy in the ring is read back first, without waiting for the GPU
+		if (m_frameIndex >= READBACK_LATENCY)
+		{
+			auto* pReadback = m_minMaxReadback[m_frameIndex % READBACK_LATENCY].get();
+			D3D11_MAPPED_SUBRESOURCE mapped{};
+			HRESULT hr = pContext->Map(pReadback, 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+			if (SUCCEEDED(hr))
+			{
+				std::array<uint32_t, 2> bits{};
+				memcpy(bits.data(), mapped.pData, sizeof(bits));
+				pContext->Unmap(pReadback, 0);
+
+				// Nothing was drawn if the buffer still holds the clear value
+				if (bits[0] != UINT_MAX && bits[1] != UINT_MAX)
+				{
+					float minDepth;
+					float maxDepth;
+					bits[1] = ~bits[1];
+					memcpy(&minDepth, &bits[0], sizeof(float));
+					memcpy(&maxDepth, &bits[1], sizeof(float));
+
+					auto [zmin, zmax] = camera.GetClipPlanes();
+					m_minDepth = LinearizeDepth(minDepth, zmin, zmax);
+					m_maxDepth = LinearizeDepth(maxDepth, zmin, zmax);
+				}
+			}
+			else if (hr != DXGI_ERROR_WAS_STILL_DRAWING)
+			{
+				check_hresult(hr);
+			}
+		}
+
+		constexpr std::array<unsigned int, 4> clearValue = { UINT_MAX, UINT_MAX, UINT_MAX, UINT_MAX };
+		pContext->ClearUnorderedAccessViewUint(m_pMinMaxUAV.get(), clearValue.data());
+
+		D3D11_TEXTURE2D_DESC depthDesc{};
+		{
+			winrt::com_ptr<ID3D11Resource> pResource;
+			m_pDepthBuffer->GetResource(pResource.put());
+			pResource.as<ID3D11Texture2D>()->GetDesc(&depthDesc);
+		}
+
+		// Each group covers 16x16 pixels
+		m_pDepthMinMaxCS->Bind(pContext);
+		BindShaderResourcesCS(pContext, 0, m_pDepthBuffer.get());
+		BindUnorderedAccessViewsCS(pContext, 0, m_pMinMaxUAV.get());
+		pContext->Dispatch((depthDesc.Width + 15) / 16, (depthDesc.Height + 15) / 16, 1);
+		BindShaderResourcesCS(pContext, 0, static_cast<ID3D11ShaderResourceView*>(nullptr));
+		BindUnorderedAccessViewsCS(pContext, 0, static_cast<ID3D11UnorderedAccessView*>(nullptr));
+
+		pContext->CopyResource(m_minMaxReadback[m_frameIndex % READBACK_LATENCY].get(), m_pMinMaxBuffer.get());
+	}
+
+	// Converts the refreshed cascades to blurred EVSM moments and rebuilds their mip chains.
+	// The shaders read the cascades to process from the remap table in the per frame
+	// constants, and pCascades holds the same cascades for the mips.
+	void ShadowPass::FilterMoments(ID3D11DeviceContext* pContext, const uint32_t* pCascades,
+		unsigned int cascadeCount)
+	{
+		constexpr unsigned int groups = (SHADOW_MAP_SIZE + 7) / 8;
+
+		// Horizontal pass, depth to moments
+		m_pConvertMomentsCS->Bind(pContext);
+		BindShaderResourcesCS(pContext, 0, m_pCascadesSRV.get());
+		BindUnorderedAccessViewsCS(pContext, 0, m_pMomentsTempUAV.get());
+		pContext->Dispatch(groups, groups, cascadeCount);
+		BindUnorderedAccessViewsCS(pContext, 0, static_cast<ID3D11UnorderedAccessView*>(nullptr));
+
+		// Vertical pass into the top mip
+		m_pBlurMomentsCS->Bind(pContext);
+		BindShaderResourcesCS(pContext, 0, m_pMomentsTempSRV.get());
+		BindUnorderedAccessViewsCS(pContext, 0, m_pMomentsUAV.get());
+		pContext->Dispatch(groups, groups, cascadeCount);
+		BindShaderResourcesCS(pContext, 0, static_cast<ID3D11ShaderResourceView*>(nullptr));
+		BindUnorderedAccessViewsCS(pContext, 0, static_cast<ID3D11UnorderedAccessView*>(nullptr));
+
+		// Cascades that were not refreshed keep their mips
+		for (unsigned int i = 0; i < cascadeCount; i++)
+		{
+			pContext->GenerateMips(m_momentSlices[pCascades[i]].get());
+		}
+	}
+
+	void ShadowPass::LogSchedule(const std::filesystem::path& path)
+	{
+		m_scheduleLog.open(path);
+		if (!m_scheduleLog)
+		{
+			throw std::runtime_error("Could not open shadow schedule log: " + path.string());
+		}
+
+		m_scheduleLog << "frame";
+		for (unsigned int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+		{
+			m_scheduleLog << ",cascade" << i;
+		}
+		m_scheduleLog << ",rendered\n";
 	}
 
 	// Shadow map method adapted from Vulkan CSM Sample: 
@@ -230,35 +477,58 @@ namespace dx
 			1.0f				// Max Depth
 		};
 
-		// Set up pipeline state for directional shadow map rendering
 		auto* pContext = resources.GetContext();
-		pContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		pContext->RSSetState(m_pRasterizerState.get());
-		pContext->RSSetViewports(1, &shadowViewport);
-		pContext->OMSetDepthStencilState(helper.DepthStencilStates().DepthEnabledWrite(), 0);
 
 		// Set up depth bounds
 		auto [zmin, zmax] = camera.GetClipPlanes();
 		float range = zmax - zmin;
-		float ratio = zmax / zmin;
 
-		std::array<float, 3> cascadeSplits{};
-		for (int i = 0; i < 3; i++)
+		std::array<float, SHADOW_CASCADE_COUNT + 1> boundaries{};
+		if (m_partitioning == Partitioning::eSampleDistribution)
 		{
-			float p = (i + 1) / 3.0f;
-			float log = zmin * pow(ratio, p);
-			float uniform = zmin + range * p;
-			float d = 0.7f * (log - uniform) + uniform;
-			cascadeSplits[i] = (d - zmin) / range;
+			ReduceDepth(pContext, camera);
+			boundaries = FitCascadeBoundaries<SHADOW_CASCADE_COUNT>(m_minDepth, m_maxDepth, zmin, zmax,
+				CASCADE_SPLIT_LAMBDA, SDSM_DEPTH_MARGIN);
+		}
+		else
+		{
+			boundaries = ComputeCascadeBoundaries<SHADOW_CASCADE_COUNT>(zmin, zmax, CASCADE_SPLIT_LAMBDA);
+		}
+
+		// Only one directional light casts shadows for now
+		const Light* pShadowLight = nullptr;
+		auto lightsView = registry.view<Light>();
+		for (auto light : lightsView)
+		{
+			const auto& l = lightsView.get<Light>(light);
+			if (l.castsShadows && l.type == Light::Type::eDirectional)
+			{
+				pShadowLight = &l;
+				break;
+			}
 		}
 
+		// Every cached cascade is stale once the light moves
+		auto lightDir = pShadowLight ? XMVector3Normalize(XMLoadFloat3(&pShadowLight->data.direction)) : XMVectorZero();
+		if (!XMVector3Equal(lightDir, XMLoadFloat3(&m_cascadeLightDir)))
+		{
+			XMStoreFloat3(&m_cascadeLightDir, lightDir);
+			m_cascadeValid.fill(false);
+		}
+
+		// Decision per cascade for the schedule log
+		enum class Update { eSkipped, eScheduled, eForced };
+		std::array<Update, SHADOW_CASCADE_COUNT> updates{};
+		unsigned int renderCount = 0;
+
 		// Calculate projection matrices
 		auto viewProj = camera.GetViewProjectionMatrix();
 		auto viewProjInv = XMMatrixInverse(nullptr, viewProj);
-		float lastSplitDist = zmin;
-		for (int i = 0; i < 3; i++)
+		for (unsigned int i = 0; i < SHADOW_CASCADE_COUNT; i++)
 		{
-			float splitDist = cascadeSplits[i];
+			// Slice distances as a fraction of the clip range
+			float lastSplitDist = (boundaries[i] - zmin) / range;
+			float splitDist = (boundaries[i + 1] - zmin) / range;
 
 			// Transform camera frustum into world space
 			std::array<XMVECTOR, 8> frustumCorners = {
@@ -284,6 +554,30 @@ namespace dx
 				frustumCorners[j] = XMVectorAdd(frustumCorners[j], XMVectorScale(dist, lastSplitDist));
 			}
 
+			// Store split distance for this cascade in the constant buffer
+			helper.cbPerFrame.data.cascadeSplits[i] = boundaries[i + 1];
+
+			// A cascade that is not due keeps its old map as long as that still covers the slice.
+			// Static geometry is assumed; moving casters would also need to force an update.
+			if (!pShadowLight)
+			{
+				continue;
+			}
+
+			if (m_scheduling == Scheduling::eEveryFrame || !m_cascadeValid[i] ||
+				IsCascadeScheduled(m_frameIndex, i))
+			{
+				updates[i] = Update::eScheduled;
+			}
+			else if (!CascadeCoversSlice(frustumCorners, XMLoadFloat4x4(&m_cascadeViewProj[i])))
+			{
+				updates[i] = Update::eForced;
+			}
+			else
+			{
+				continue;
+			}
+
 			// Calculate frustum center
 			auto frustumCenter = XMVectorZero();
 			for (int j = 0; j < 8; j++)
@@ -300,35 +594,69 @@ namespace dx
 				radius = std::max(radius, dist);
 			}
 
-			// Store split distance for this cascade in the constant buffer
-			helper.cbPerFrame.data.cascadeSplits[i] = zmin + splitDist * range;
+			auto up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
 
-			// The calculations above can be shared for all lights, but right now we're just doing one.
-			auto lightsView = registry.view<Light>();
-			for (auto light : lightsView)
+			// The bounding sphere keeps the projection size constant as the camera rotates,
+			// but wastes resolution that the tightly fitted partitions are meant to recover.
+			// Fitted cascades use a light view fixed at the origin so their texel grid stays put.
+			XMMATRIX lightView;
+			XMMATRIX lightProj;
+			if (m_partitioning == Partitioning::eSampleDistribution)
 			{
-				const auto& l = lightsView.get<Light>(light);
-				if (l.castsShadows && l.type == Light::Type::eDirectional)
-				{
-					auto lightDir = XMVector3Normalize(XMLoadFloat3(&l.data.direction));
-					auto eye = XMVectorSubtract(frustumCenter, XMVectorScale(lightDir, radius));
-					auto up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
-					auto lightView = XMMatrixLookAtRH(eye, frustumCenter, up);
-					auto lightProj = XMMatrixOrthographicOffCenterRH(-radius, radius,
-						-radius, radius, 0.0f, 2.0f * radius);
-					auto lightViewProj = XMMatrixMultiplyTranspose(lightView, lightProj);
-
-					XMStoreFloat4x4(&helper.cbPerFrame.data.lightViewProj[i], lightViewProj);
-				}
+				const float guardBand = (m_scheduling == Scheduling::eTimeSliced) ? CASCADE_GUARD_BAND : 0.0f;
+				lightView = XMMatrixLookToRH(XMVectorZero(), lightDir, up);
+				lightProj = FitLightProjection(frustumCorners, lightView, SHADOW_MAP_SIZE, guardBand);
+			}
+			else
+			{
+				auto eye = XMVectorSubtract(frustumCenter, XMVectorScale(lightDir, radius));
+				lightView = XMMatrixLookAtRH(eye, frustumCenter, up);
+				lightProj = XMMatrixOrthographicOffCenterRH(-radius, radius,
+					-radius, radius, 0.0f, 2.0f * radius);
 			}
-			lastSplitDist = splitDist;
+			XMStoreFloat4x4(&m_cascadeViewProj[i], XMMatrixMultiply(lightView, lightProj));
+			m_cascadeValid[i] = true;
+
+			helper.cbPerFrame.data.cascadeRemap[renderCount++] = i;
+		}
+
+		for (unsigned int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+		{
+			XMStoreFloat4x4(&helper.cbPerFrame.data.lightViewProj[i],
+				XMMatrixTranspose(XMLoadFloat4x4(&m_cascadeViewProj[i])));
 		}
 		helper.cbPerFrame.Update(pContext);
 
-		// Do a depth-only pass
+		if (m_scheduleLog)
+		{
+			constexpr const char* names[] = { "skipped", "scheduled", "forced" };
+			m_scheduleLog << m_frameIndex;
+			for (auto update : updates)
+			{
+				m_scheduleLog << ',' << names[static_cast<int>(update)];
+			}
+			m_scheduleLog << ',' << renderCount << '\n';
+		}
+		m_frameIndex++;
+
+		// Clear the cascades being refreshed, or all of them if there is no shadow light
+		for (unsigned int i = 0; i < SHADOW_CASCADE_COUNT; i++)
+		{
+			if (!pShadowLight || updates[i] != Update::eSkipped)
+			{
+				pContext->ClearDepthStencilView(m_cascadeSlices[i].get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+			}
+		}
+		if (renderCount == 0)
+		{
+			return;
+		}
+
+		pContext->RSSetViewports(1, &shadowViewport);
+
+		// Do a depth-only pass, with one instance per refreshed cascade
 		ID3D11DepthStencilView* cascades = m_cascades.get();
 		BindRenderTargets(pContext, cascades);
-		pContext->ClearDepthStencilView(cascades, D3D11_CLEAR_DEPTH, 1.0f, 0);
 
 		auto objView = registry.view<ShadowMapEffect, Geometry>();
 		for (auto obj : objView)
@@ -336,11 +664,17 @@ namespace dx
 			const auto& effect = objView.get<ShadowMapEffect>(obj);
 			const auto& geometry = objView.get<Geometry>(obj);
 			geometry.Bind(pContext);
+			helper.StateTracker().Apply(pContext, *effect.GetPipelineState());
 			effect.Bind(pContext);
-			pContext->DrawIndexedInstanced(geometry.indices.GetIndexCount(), 3, 0, 0, 0);
+			pContext->DrawIndexedInstanced(geometry.indices.GetIndexCount(), renderCount, 0, 0, 0);
 		}
 
 		// Unbind render target and depth stencil so we don't run into invalid state later
 		BindRenderTargets(pContext, nullptr);
+
+		if constexpr (SHADOW_USE_MOMENTS)
+		{
+			FilterMoments(pContext, helper.cbPerFrame.data.cascadeRemap, renderCount);
+		}
 	}
-}
+}
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include "Camera.h"
 #include "Components.h"
 #include "RenderFromTextureEffect.h"
+#include "PBREffect.h"
 
 namespace dx
 {
@@ -21,7 +22,8 @@ namespace dx
 	class OpaquePass : public RenderPass
 	{
 	public:
-		OpaquePass(const DeviceResources& resources, D3DCache& cache);
+		// useEnvironmentMaps loads the baked image based lighting, see Environment.h
+		OpaquePass(const DeviceResources& resources, D3DCache& cache, bool useEnvironmentMaps);
 
 		void ResolveResources(D3DCache& cache) override;
 		void Draw(const DeviceResources& resources, entt::registry& registry,
@@ -30,7 +32,12 @@ namespace dx
 	private:
 		winrt::com_ptr<ID3D11RenderTargetView> m_pFrameBuffer;
 		winrt::com_ptr<ID3D11DepthStencilView> m_pDepthBuffer;
-		winrt::com_ptr<ID3D11ShaderResourceView> m_pCascades;
+
+		// Lights, shadows and baked image based lighting, which is null if not present
+		PBREffect::PassResources m_passResources;
+
+		// Objects to draw this frame with their pipeline state id, reused between frames
+		std::vector<std::pair<uint32_t, entt::entity>> m_drawOrder;
 	};
 
 	class LightsPass : public RenderPass
@@ -62,14 +69,78 @@ namespace dx
 	class ShadowPass : public RenderPass
 	{
 	public:
-		ShadowPass(const DeviceResources& resources, D3DCache& factory);
+		// How the view frustum is divided between the shadow cascades
+		enum class Partitioning
+		{
+			eFixed,					// Fixed log/uniform blend between the camera clip planes
+			eSampleDistribution		// Fit to the visible depth range from a depth buffer reduction
+		};
+
+		// How often each cascade is rendered
+		enum class Scheduling
+		{
+			eEveryFrame,			// All cascades are rendered every frame
+			eTimeSliced				// Cascade i is rendered every 2^i frames, or sooner if the camera outruns it
+		};
+
+		ShadowPass(const DeviceResources& resources, D3DCache& factory,
+			Partitioning partitioning = Partitioning::eFixed, Scheduling scheduling = Scheduling::eEveryFrame);
 
 		void ResolveResources(D3DCache& factory) override;
 		void Draw(const DeviceResources& resources, entt::registry& registry,
 			D3DHelper& helper, const FlyCamera& camera) override;
 
+		// Writes the per frame cascade update decisions to a CSV file, for verifying replays
+		void LogSchedule(const std::filesystem::path& path);
+
+		// Compute shaders used by any configuration of the pass
+		static std::vector<ShaderPermutation> GetPermutations()
+		{
+			return {
+				{ "Source/Shaders/DepthMinMax.hlsl", ShaderStage::eCompute, {} },
+				{ "Source/Shaders/EVSMBlur.hlsl", ShaderStage::eCompute, { { "CONVERT_DEPTH", "1" } } },
+				{ "Source/Shaders/EVSMBlur.hlsl", ShaderStage::eCompute, {} }
+			};
+		}
+
 	private:
 		winrt::com_ptr<ID3D11DepthStencilView> m_cascades;
-		winrt::com_ptr<ID3D11RasterizerState> m_pRasterizerState;
+		std::array<winrt::com_ptr<ID3D11DepthStencilView>, SHADOW_CASCADE_COUNT> m_cascadeSlices;
+
+		Partitioning m_partitioning;
+		Scheduling m_scheduling;
+
+		// Matrices each cascade was last rendered with, untransposed
+		std::array<DirectX::XMFLOAT4X4, SHADOW_CASCADE_COUNT> m_cascadeViewProj;
+		std::array<bool, SHADOW_CASCADE_COUNT> m_cascadeValid;
+		DirectX::XMFLOAT3 m_cascadeLightDir;
+		std::ofstream m_scheduleLog;
+
+		// Depth buffer reduction for sample distribution shadow maps. The result is copied
+		// into a ring of staging buffers so it can be read back without stalling.
+		static constexpr unsigned int READBACK_LATENCY = 3;
+
+		std::shared_ptr<ComputeShader> m_pDepthMinMaxCS;
+		winrt::com_ptr<ID3D11ShaderResourceView> m_pDepthBuffer;
+		winrt::com_ptr<ID3D11Buffer> m_pMinMaxBuffer;
+		winrt::com_ptr<ID3D11UnorderedAccessView> m_pMinMaxUAV;
+		std::array<winrt::com_ptr<ID3D11Buffer>, READBACK_LATENCY> m_minMaxReadback;
+		uint64_t m_frameIndex;
+
+		// Most recent min/max view depth read back from the GPU
+		float m_minDepth;
+		float m_maxDepth;
+
+		// Exponential variance shadow maps, filtered from the cascades when SHADOW_USE_MOMENTS is set
+		std::shared_ptr<ComputeShader> m_pConvertMomentsCS;
+		std::shared_ptr<ComputeShader> m_pBlurMomentsCS;
+		winrt::com_ptr<ID3D11ShaderResourceView> m_pCascadesSRV;
+		winrt::com_ptr<ID3D11ShaderResourceView> m_pMomentsTempSRV;
+		winrt::com_ptr<ID3D11UnorderedAccessView> m_pMomentsTempUAV;
+		winrt::com_ptr<ID3D11UnorderedAccessView> m_pMomentsUAV;
+		std::array<winrt::com_ptr<ID3D11ShaderResourceView>, SHADOW_CASCADE_COUNT> m_momentSlices;
+
+		void ReduceDepth(ID3D11DeviceContext* pContext, const FlyCamera& camera);
+		void FilterMoments(ID3D11DeviceContext* pContext, const uint32_t* pCascades, unsigned int cascadeCount);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,163 @@
+#pragma once
+
+namespace dx
+{
+	// Counters for one resource cache
+	struct ResourceCacheStats
+	{
+		std::string name;
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t insertions;
+		uint64_t evictions;
+		size_t entryCount;
+		size_t bytes;
+	};
+
+	// Thread safe map from a key to a shared resource, split into independently locked shards so
+	// concurrent loaders rarely contend. Values are created outside the lock. If two threads miss
+	// on the same key at once both create a value, the first insertion wins and the other thread
+	// discards its own and returns the winner, so callers always agree on one object.
+	//
+	// Each shard holds a Map<Key, Created, Hash, Equal>, eg. std::unordered_map or FlatHashMap.
+	template<typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>,
+		template<typename...> typename Map = std::unordered_map>
+	class ResourceCache
+	{
+	public:
+		// A newly created value and an estimate of the memory it holds
+		struct Created
+		{
+			Value value;
+			size_t bytes;
+		};
+
+		explicit ResourceCache(std::string name) :
+			m_name(std::move(name)),
+			m_hits(0),
+			m_misses(0),
+			m_insertions(0),
+			m_evictions(0),
+			m_bytes(0)
+		{
+		}
+
+		ResourceCache(const ResourceCache&) = delete;
+		ResourceCache& operator=(const ResourceCache&) = delete;
+
+		// Returns the cached value for key, or calls create() and caches its result. Empty
+		// values are returned but not cached, so a failed load is retried next time.
+		template<typename F>
+		Value GetOrCreate(const Key& key, F&& create)
+		{
+			auto& shard = GetShard(key);
+			{
+				std::lock_guard lock(shard.mutex);
+				if (auto it = shard.entries.find(key); it != shard.entries.end())
+				{
+					m_hits++;
+					return it->second.value;
+				}
+			}
+			m_misses++;
+
+			Created created = create();
+			if (!created.value)
+			{
+				return created.value;
+			}
+
+			std::lock_guard lock(shard.mutex);
+			auto [it, inserted] = shard.entries.try_emplace(key, std::move(created));
+			if (inserted)
+			{
+				m_insertions++;
+				m_bytes += it->second.bytes;
+			}
+			return it->second.value;
+		}
+
+		// Looks up a value without creating it
+		bool Find(const Key& key, Value* pValue) const
+		{
+			auto& shard = GetShard(key);
+			std::lock_guard lock(shard.mutex);
+			auto it = shard.entries.find(key);
+			if (it == shard.entries.end())
+			{
+				return false;
+			}
+			*pValue = it->second.value;
+			return true;
+		}
+
+		// Drops the cache's reference. Objects still in use elsewhere stay alive.
+		bool Evict(const Key& key)
+		{
+			auto& shard = GetShard(key);
+			std::lock_guard lock(shard.mutex);
+			auto it = shard.entries.find(key);
+			if (it == shard.entries.end())
+			{
+				return false;
+			}
+			m_bytes -= it->second.bytes;
+			m_evictions++;
+			shard.entries.erase(it);
+			return true;
+		}
+
+		void Clear()
+		{
+			for (auto& shard : m_shards)
+			{
+				std::lock_guard lock(shard.mutex);
+				for (const auto& [key, entry] : shard.entries)
+				{
+					m_bytes -= entry.bytes;
+					m_evictions++;
+				}
+				shard.entries.clear();
+			}
+		}
+
+		ResourceCacheStats GetStats() const
+		{
+			size_t entryCount = 0;
+			for (auto& shard : m_shards)
+			{
+				std::lock_guard lock(shard.mutex);
+				entryCount += shard.entries.size();
+			}
+			return { m_name, m_hits, m_misses, m_insertions, m_evictions, entryCount, m_bytes };
+		}
+
+	private:
+		static constexpr size_t SHARD_COUNT = 16;
+
+		struct Shard
+		{
+			mutable std::mutex mutex;
+			Map<Key, Created, Hash, Equal> entries;
+		};
+
+		std::string m_name;
+		std::array<Shard, SHARD_COUNT> m_shards;
+
+		std::atomic<uint64_t> m_hits;
+		std::atomic<uint64_t> m_misses;
+		std::atomic<uint64_t> m_insertions;
+		std::atomic<uint64_t> m_evictions;
+		std::atomic<size_t> m_bytes;
+
+		Shard& GetShard(const Key& key)
+		{
+			return m_shards[Hash{}(key) % SHARD_COUNT];
+		}
+
+		const Shard& GetShard(const Key& key) const
+		{
+			return m_shards[Hash{}(key) % SHARD_COUNT];
+		}
+	};
+}
\ No newline at end of file
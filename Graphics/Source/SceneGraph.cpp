@@ -8,6 +8,52 @@
 #include "PBREffect.h"
 #include "ShadowMapEffect.h"
 
+namespace
+{
+	// Bounding sphere of the vertex positions, and the average texture coordinate density over
+	// the surface if the vertices have texture coordinates
+	template<typename Vertex>
+	dx::MeshBounds ComputeMeshBounds(const std::vector<Vertex>& vertices, const std::vector<dx::importer::Index>& indices)
+	{
+		using namespace DirectX;
+
+		dx::MeshBounds bounds{};
+		if (vertices.empty())
+		{
+			return bounds;
+		}
+		BoundingSphere::CreateFromPoints(bounds.sphere, vertices.size(), &vertices[0].position, sizeof(Vertex));
+
+		if constexpr (!std::is_same_v<Vertex, dx::VertexP3N3>)
+		{
+			float worldArea = 0.0f;
+			float texcoordArea = 0.0f;
+			for (size_t i = 0; i + 2 < indices.size(); i += 3)
+			{
+				const auto& v0 = vertices[indices[i]];
+				const auto& v1 = vertices[indices[i + 1]];
+				const auto& v2 = vertices[indices[i + 2]];
+
+				XMVECTOR p0 = XMLoadFloat3(&v0.position);
+				XMVECTOR cross = XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&v1.position), p0),
+					XMVectorSubtract(XMLoadFloat3(&v2.position), p0));
+				worldArea += 0.5f * XMVectorGetX(XMVector3Length(cross));
+
+				float du1 = v1.uv.x - v0.uv.x;
+				float dv1 = v1.uv.y - v0.uv.y;
+				float du2 = v2.uv.x - v0.uv.x;
+				float dv2 = v2.uv.y - v0.uv.y;
+				texcoordArea += 0.5f * std::abs(du1 * dv2 - du2 * dv1);
+			}
+			if (worldArea > 0.0f)
+			{
+				bounds.texcoordDensity = std::sqrt(texcoordArea / worldArea);
+			}
+		}
+		return bounds;
+	}
+}
+
 namespace dx
 {
 	SceneGraph::SceneGraph(std::shared_ptr<entt::registry> pRegistry)
@@ -113,7 +159,8 @@ namespace dx
 	}
 
 	// Convenience function to load a PBR model
-	void SceneGraph::LoadModel(ID3D11Device* pDevice, D3DCache& cache, const std::string& path, 
+	void SceneGraph::LoadModel(ID3D11Device* pDevice, TextureStreamer& textures, const std::string& path, 
+		bool useEnvironmentMaps,
 		const DirectX::XMFLOAT3& localTranslation, const DirectX::XMFLOAT4& localRotation, 
 		const DirectX::XMFLOAT3& localScale, entt::entity parent)
 	{
@@ -132,6 +179,16 @@ namespace dx
 			ar(model);
 		}
 
+		// Textures are loaded together once every mesh has asked for its own
+		struct TextureRequest
+		{
+			entt::entity entity;
+			std::shared_ptr<StreamingTexture> PBREffect::Resources::* pSlot;
+		};
+		std::vector<TextureRequest> textureRequests;
+		std::vector<std::string> texturePaths;
+		const std::filesystem::path dir = std::filesystem::path(path).parent_path();
+
 		for (const auto& mesh : model.meshes)
 		{
 			// Chose correct shader options based on material info
@@ -171,27 +228,28 @@ namespace dx
 			{
 				pbrOptions.bits.useNormalMap = true;
 			}
+			pbrOptions.bits.useMomentShadows = SHADOW_USE_MOMENTS;
+			pbrOptions.bits.useEnvironmentMaps = useEnvironmentMaps;
 			PBREffect pbrEffect(pDevice, pbrOptions);
 			ShadowMapEffect shadowEffect(pDevice, shadowOptions);
 
-			// Create resources for the effect
-			pbrEffect.resources.lights = cache.GetShaderResourceView("LightsBuffer");
-			// Load textures from disk
-			std::filesystem::path dir = std::filesystem::path(path).parent_path();
+			auto entity = m_pRegistry->create();
+
+			// Queue textures to load from disk
 			if (pbrOptions.bits.useColorMap)
 			{
-				auto texturePath = dir / *mesh.material.baseColor;
-				pbrEffect.resources.color = CreateTexture(pDevice, texturePath.string());
+				textureRequests.push_back({ entity, &PBREffect::Resources::color });
+				texturePaths.push_back((dir / *mesh.material.baseColor).string());
 			}
 			if (pbrOptions.bits.useOcclusionMap || pbrOptions.bits.useRoughnessMap || pbrOptions.bits.useMetalnessMap)
 			{
-				auto texturePath = dir / *mesh.material.occlusionRoughnessMetalness;
-				pbrEffect.resources.orm = CreateTexture(pDevice, texturePath.string());
+				textureRequests.push_back({ entity, &PBREffect::Resources::orm });
+				texturePaths.push_back((dir / *mesh.material.occlusionRoughnessMetalness).string());
 			}
 			if (pbrOptions.bits.useNormalMap)
 			{
-				auto texturePath = dir / *mesh.material.normal;
-				pbrEffect.resources.normal = CreateTexture(pDevice, texturePath.string());
+				textureRequests.push_back({ entity, &PBREffect::Resources::normal });
+				texturePaths.push_back((dir / *mesh.material.normal).string());
 			}
 
 			// Set constants
@@ -200,7 +258,6 @@ namespace dx
 			cbuffer.roughnessFactor = mesh.material.roughnessFactor;
 			cbuffer.baseColorFactor = mesh.material.baseColorFactor;
 
-			auto entity = m_pRegistry->create();
 			m_pRegistry->emplace<PBREffect>(entity, std::move(pbrEffect));
 			m_pRegistry->emplace<ShadowMapEffect>(entity, std::move(shadowEffect));
 			
@@ -209,24 +266,45 @@ namespace dx
 			{
 			case VertexType::eP3N3:
 			{
-				Geometry geometry{ VertexBuffer(pDevice, std::get<std::vector<VertexP3N3>>(mesh.vertices)), std::move(indices) };
+				const auto& vertices = std::get<std::vector<VertexP3N3>>(mesh.vertices);
+				Geometry geometry{ VertexBuffer(pDevice, vertices), std::move(indices) };
 				m_pRegistry->emplace<Geometry>(entity, std::move(geometry));
+				m_pRegistry->emplace<MeshBounds>(entity, ComputeMeshBounds(vertices, mesh.indices));
 				break;
 			}
 			case VertexType::eP3N3U2:
 			{
-				Geometry geometry{ VertexBuffer(pDevice, std::get<std::vector<VertexP3N3U2>>(mesh.vertices)), std::move(indices) };
+				const auto& vertices = std::get<std::vector<VertexP3N3U2>>(mesh.vertices);
+				Geometry geometry{ VertexBuffer(pDevice, vertices), std::move(indices) };
 				m_pRegistry->emplace<Geometry>(entity, std::move(geometry));
+				m_pRegistry->emplace<MeshBounds>(entity, ComputeMeshBounds(vertices, mesh.indices));
 				break;
 			}
 			case VertexType::eP3N3U2T3:
 			{
-				Geometry geometry{ VertexBuffer(pDevice, std::get<std::vector<VertexP3N3U2T3>>(mesh.vertices)), std::move(indices) };
+				const auto& vertices = std::get<std::vector<VertexP3N3U2T3>>(mesh.vertices);
+				Geometry geometry{ VertexBuffer(pDevice, vertices), std::move(indices) };
 				m_pRegistry->emplace<Geometry>(entity, std::move(geometry));
+				m_pRegistry->emplace<MeshBounds>(entity, ComputeMeshBounds(vertices, mesh.indices));
 				break;
 			}
 			}
 			AddNode(entity, localTranslation, localRotation, localScale, parent);
 		}
+
+		const auto loadStart = std::chrono::steady_clock::now();
+		const uint64_t bytesBefore = textures.GetBytesRead();
+		auto loaded = textures.LoadBatch(texturePaths);
+		for (size_t i = 0; i < loaded.size(); i++)
+		{
+			const auto& request = textureRequests[i];
+			m_pRegistry->get<PBREffect>(request.entity).resources.*request.pSlot = std::move(loaded[i]);
+		}
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+		const double mebibytes = static_cast<double>(textures.GetBytesRead() - bytesBefore) / (1024.0 * 1024.0);
+		std::cout << "Textures: loaded " << texturePaths.size() << " references of " << path << ", "
+			<< mebibytes << " MiB in " << seconds * 1000.0 << " ms ("
+			<< (seconds > 0.0 ? mebibytes / seconds : 0.0) << " MiB/s)\n";
 	}
 }
\ No newline at end of file
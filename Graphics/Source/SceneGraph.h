@@ -1,6 +1,7 @@
 #pragma once
 
 #include "D3DCache.h"
+#include "TextureStreamer.h"
 
 namespace dx
 {
@@ -67,7 +68,10 @@ namespace dx
 		void SetTransform(Transform* t, const DirectX::XMFLOAT3& localTranslation,
 			const DirectX::XMFLOAT4& localRotation, const DirectX::XMFLOAT3& localScale);
 
-		void LoadModel(ID3D11Device* pDevice, D3DCache& cache, const std::string& path,
+		// useEnvironmentMaps selects image based lighting for every material, and must match
+		// the OpaquePass that draws them
+		void LoadModel(ID3D11Device* pDevice, TextureStreamer& textures, const std::string& path,
+			bool useEnvironmentMaps,
 			const DirectX::XMFLOAT3& localTranslation = { 0.0f, 0.0f, 0.0f },
 			const DirectX::XMFLOAT4& localRotation = { 0.0f, 0.0f, 0.0f, 1.0f },
 			const DirectX::XMFLOAT3& localScale = { 1.0f, 1.0f, 1.0f },
@@ -1,12 +1,14 @@
 #pragma once
 
+#include "ShaderCache.h"
+#include "BindingLayout.h"
+
 namespace dx
 {
 	class VertexShader
 	{
 	public:
-		VertexShader(ID3D11Device* pDevice, const std::string& filename,
-			uint64_t optionsKey, const std::vector<std::pair<std::string, std::string>>& defines);
+		VertexShader(ID3D11Device* pDevice, const ShaderBytecode& bytecode);
 
 		void Bind(ID3D11DeviceContext* pContext) const
 		{
@@ -14,37 +16,63 @@ namespace dx
 			pContext->VSSetShader(m_pShader.get(), nullptr, 0);
 		}
 
+		ID3D11VertexShader* Get() const { return m_pShader.get(); }
+		ID3D11InputLayout* GetInputLayout() const { return m_pLayout.get(); }
+
+		// Resource slots the shader reads
+		const ShaderBindings& GetBindings() const { return m_bindings; }
+
+		// Takes over a recompiled shader, keeping this object so that pipeline states referring
+		// to it use the new code. Render thread only.
+		void Reload(VertexShader&& other);
+
 	private:
 		winrt::com_ptr<ID3D11InputLayout> m_pLayout;
 		winrt::com_ptr<ID3D11VertexShader> m_pShader;
+		ShaderBindings m_bindings;
 	};
 
 	class PixelShader
 	{
 	public:
-		PixelShader(ID3D11Device* pDevice, const std::string& filename,
-			uint64_t optionsKey, const std::vector<std::pair<std::string, std::string>>& defines);
+		PixelShader(ID3D11Device* pDevice, const ShaderBytecode& bytecode);
 
 		void Bind(ID3D11DeviceContext* pContext) const
 		{
 			pContext->PSSetShader(m_pShader.get(), nullptr, 0);
 		}
 
+		ID3D11PixelShader* Get() const { return m_pShader.get(); }
+
+		// Resource slots the shader reads
+		const ShaderBindings& GetBindings() const { return m_bindings; }
+
+		// Incremented by Reload, so that anything derived from the bindings can be refreshed
+		uint32_t GetVersion() const { return m_version; }
+
+		// Takes over a recompiled shader, keeping this object so that pipeline states referring
+		// to it use the new code. Render thread only.
+		void Reload(PixelShader&& other);
+
 	private:
 		winrt::com_ptr<ID3D11PixelShader> m_pShader;
+		ShaderBindings m_bindings;
+		uint32_t m_version;
 	};
 
 	class ComputeShader
 	{
 	public:
-		ComputeShader(ID3D11Device* pDevice, const std::string& filename,
-			uint64_t optionsKey, const std::vector<std::pair<std::string, std::string>>& defines);
+		ComputeShader(ID3D11Device* pDevice, const ShaderBytecode& bytecode);
 
 		void Bind(ID3D11DeviceContext* pContext) const
 		{
 			pContext->CSSetShader(m_pShader.get(), nullptr, 0);
 		}
 
+		// Takes over a recompiled shader. Render thread only.
+		void Reload(ComputeShader&& other);
+
 	private:
 		winrt::com_ptr<ID3D11ComputeShader> m_pShader;
 	};
@@ -0,0 +1,338 @@
+#include "stdafx.h"
+
+#include "ShaderArchive.h"
+
+using winrt::check_bool;
+
+namespace
+{
+	constexpr uint32_t ARCHIVE_MAGIC = 0x43535844;	// "DXSC"
+	constexpr uint32_t ARCHIVE_VERSION = 1;
+	constexpr uint64_t PAYLOAD_ALIGNMENT = 16;
+
+	// The file and its mapping grow to at least double their size, in multiples of this
+	constexpr uint64_t GROWTH_GRANULARITY = 4 * 1024 * 1024;
+
+	// Archives are compacted on open once dead space exceeds this share of the live payloads
+	constexpr uint64_t COMPACT_DEAD_PERCENT = 25;
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t indexOffset;
+		uint64_t entryCount;
+		uint64_t reserved;
+	};
+
+	uint64_t Align(uint64_t offset)
+	{
+		return (offset + PAYLOAD_ALIGNMENT - 1) & ~(PAYLOAD_ALIGNMENT - 1);
+	}
+
+	void WriteAt(HANDLE file, uint64_t offset, const void* pData, size_t size)
+	{
+		OVERLAPPED overlapped{};
+		overlapped.Offset = static_cast<DWORD>(offset);
+		overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+		DWORD written = 0;
+		check_bool(WriteFile(file, pData, static_cast<DWORD>(size), &written, &overlapped));
+		if (written != size)
+		{
+			throw std::runtime_error("Incomplete write to shader archive");
+		}
+	}
+
+	void SetFileSize(HANDLE file, uint64_t size)
+	{
+		FILE_END_OF_FILE_INFO eof{};
+		eof.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+		check_bool(SetFileInformationByHandle(file, FileEndOfFileInfo, &eof, sizeof(eof)));
+	}
+}
+
+namespace dx
+{
+	ShaderArchive::ShaderArchive(const std::filesystem::path& path) :
+		m_path(path),
+		m_dataEnd(0),
+		m_capacity(0),
+		m_dirty(false)
+	{
+		OpenFile();
+		if (!MapAndValidate())
+		{
+			std::cout << "Creating new shader archive " << path << std::endl;
+			Reset();
+		}
+		else
+		{
+			const uint64_t live = GetLiveBytes();
+			const uint64_t dead = m_dataEnd - sizeof(Header) - m_index.size() * sizeof(Entry) - live;
+			if (dead * 100 > live * COMPACT_DEAD_PERCENT)
+			{
+				Compact();
+			}
+		}
+	}
+
+	ShaderArchive::~ShaderArchive()
+	{
+		try
+		{
+			Commit();
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "Failed to commit shader archive: " << e.what() << "\n";
+		}
+		UnmapViews();
+	}
+
+	void ShaderArchive::OpenFile()
+	{
+		m_file.attach(CreateFileW(m_path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+			OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+		if (!m_file)
+		{
+			winrt::throw_last_error();
+		}
+	}
+
+	// Maps the whole file and loads the committed index. Returns false if the file is empty or damaged.
+	bool ShaderArchive::MapAndValidate()
+	{
+		LARGE_INTEGER size{};
+		check_bool(GetFileSizeEx(m_file.get(), &size));
+		const uint64_t fileSize = size.QuadPart;
+		if (fileSize < sizeof(Header))
+		{
+			return false;
+		}
+
+		winrt::handle mapping(CreateFileMappingW(m_file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+		if (!mapping)
+		{
+			winrt::throw_last_error();
+		}
+		const auto* pBase = static_cast<const uint8_t*>(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0));
+		if (!pBase)
+		{
+			winrt::throw_last_error();
+		}
+
+		Header header{};
+		memcpy(&header, pBase, sizeof(Header));
+		// Compared without adding or multiplying header values, which wrap on a damaged file
+		bool valid = (header.magic == ARCHIVE_MAGIC) && (header.version == ARCHIVE_VERSION) &&
+			(header.indexOffset >= sizeof(Header)) && (header.indexOffset <= fileSize) &&
+			(header.entryCount <= (fileSize - header.indexOffset) / sizeof(Entry));
+		if (!valid)
+		{
+			UnmapViewOfFile(pBase);
+			return false;
+		}
+
+		std::vector<Entry> index(header.entryCount);
+		memcpy(index.data(), pBase + header.indexOffset, header.entryCount * sizeof(Entry));
+		for (const auto& entry : index)
+		{
+			if (entry.offset < sizeof(Header) || entry.offset > header.indexOffset ||
+				entry.size > header.indexOffset - entry.offset)
+			{
+				UnmapViewOfFile(pBase);
+				return false;
+			}
+		}
+
+		m_index = std::move(index);
+		m_views.push_back(pBase);
+		m_dataEnd = header.indexOffset + header.entryCount * sizeof(Entry);
+		m_capacity = fileSize;
+		return true;
+	}
+
+	// Truncates the file to an empty archive. Only used while opening, before any pointers into
+	// the views have been handed out.
+	void ShaderArchive::Reset()
+	{
+		UnmapViews();
+		SetFileSize(m_file.get(), 0);
+
+		Header header{ ARCHIVE_MAGIC, ARCHIVE_VERSION, sizeof(Header), 0, 0 };
+		WriteAt(m_file.get(), 0, &header, sizeof(header));
+		check_bool(FlushFileBuffers(m_file.get()));
+
+		m_index.clear();
+		m_dataEnd = sizeof(Header);
+		m_capacity = 0;
+	}
+
+	// Rewrites the archive with only the live payloads. The copy is written to a temporary file
+	// that replaces the original once complete, so a crash while compacting loses nothing.
+	// Only used while opening, before any pointers into the views have been handed out.
+	void ShaderArchive::Compact()
+	{
+		auto tempPath = m_path;
+		tempPath += ".tmp";
+		{
+			winrt::file_handle temp(CreateFileW(tempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+				FILE_ATTRIBUTE_NORMAL, nullptr));
+			if (!temp)
+			{
+				winrt::throw_last_error();
+			}
+
+			auto index = m_index;
+			uint64_t offset = sizeof(Header);
+			for (auto& entry : index)
+			{
+				offset = Align(offset);
+				WriteAt(temp.get(), offset, m_views.back() + entry.offset, static_cast<size_t>(entry.size));
+				entry.offset = offset;
+				offset += entry.size;
+			}
+
+			uint64_t indexOffset = Align(offset);
+			WriteAt(temp.get(), indexOffset, index.data(), index.size() * sizeof(Entry));
+			Header header{ ARCHIVE_MAGIC, ARCHIVE_VERSION, indexOffset, index.size(), 0 };
+			WriteAt(temp.get(), 0, &header, sizeof(header));
+			check_bool(FlushFileBuffers(temp.get()));
+		}
+
+		const uint64_t sizeBefore = m_capacity;
+		UnmapViews();
+		m_file.close();
+		check_bool(MoveFileExW(tempPath.c_str(), m_path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH));
+
+		OpenFile();
+		if (!MapAndValidate())
+		{
+			throw std::runtime_error("Shader archive is damaged after compaction");
+		}
+		std::cout << "Compacted shader archive from " << sizeBefore / 1024 << " KiB to "
+			<< m_dataEnd / 1024 << " KiB" << std::endl;
+	}
+
+	// Grows the file and maps a new view covering it. Earlier views stay mapped for
+	// outstanding pointers, and geometric growth keeps their total size within twice the file.
+	void ShaderArchive::Reserve(uint64_t size)
+	{
+		if (size <= m_capacity)
+		{
+			return;
+		}
+
+		uint64_t capacity = std::max(size, 2 * m_capacity);
+		capacity = (capacity + GROWTH_GRANULARITY - 1) / GROWTH_GRANULARITY * GROWTH_GRANULARITY;
+		SetFileSize(m_file.get(), capacity);
+
+		winrt::handle mapping(CreateFileMappingW(m_file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+		if (!mapping)
+		{
+			winrt::throw_last_error();
+		}
+		const auto* pBase = static_cast<const uint8_t*>(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0));
+		if (!pBase)
+		{
+			winrt::throw_last_error();
+		}
+		m_views.push_back(pBase);
+		m_capacity = capacity;
+	}
+
+	void ShaderArchive::UnmapViews()
+	{
+		for (const auto* pView : m_views)
+		{
+			UnmapViewOfFile(pView);
+		}
+		m_views.clear();
+	}
+
+	uint64_t ShaderArchive::GetLiveBytes() const
+	{
+		uint64_t bytes = 0;
+		for (const auto& entry : m_index)
+		{
+			bytes += entry.size;
+		}
+		return bytes;
+	}
+
+	bool ShaderArchive::Find(uint64_t key, const void** ppData, size_t* pSize) const
+	{
+		std::lock_guard lock(m_mutex);
+
+		auto it = std::lower_bound(m_index.begin(), m_index.end(), key,
+			[](const Entry& e, uint64_t k) { return e.key < k; });
+		if (it == m_index.end() || it->key != key)
+		{
+			return false;
+		}
+
+		// The latest view covers every entry in the index
+		*ppData = m_views.back() + it->offset;
+		*pSize = static_cast<size_t>(it->size);
+		return true;
+	}
+
+	void ShaderArchive::Append(uint64_t key, const void* pData, size_t size)
+	{
+		std::lock_guard lock(m_mutex);
+
+		// Written through the file handle, which the mapped views see immediately
+		uint64_t payloadOffset = Align(m_dataEnd);
+		Reserve(payloadOffset + size);
+		WriteAt(m_file.get(), payloadOffset, pData, size);
+		m_dataEnd = payloadOffset + size;
+
+		auto it = std::lower_bound(m_index.begin(), m_index.end(), key,
+			[](const Entry& e, uint64_t k) { return e.key < k; });
+		if (it != m_index.end() && it->key == key)
+		{
+			*it = { key, payloadOffset, size };
+		}
+		else
+		{
+			m_index.insert(it, { key, payloadOffset, size });
+		}
+		m_dirty = true;
+	}
+
+	void ShaderArchive::Commit()
+	{
+		std::lock_guard lock(m_mutex);
+		if (!m_dirty)
+		{
+			return;
+		}
+
+		uint64_t indexOffset = Align(m_dataEnd);
+		uint64_t indexSize = m_index.size() * sizeof(Entry);
+		Reserve(indexOffset + indexSize);
+		WriteAt(m_file.get(), indexOffset, m_index.data(), static_cast<size_t>(indexSize));
+		check_bool(FlushFileBuffers(m_file.get()));
+
+		// Point the header at the new index
+		Header header{ ARCHIVE_MAGIC, ARCHIVE_VERSION, indexOffset, m_index.size(), 0 };
+		WriteAt(m_file.get(), 0, &header, sizeof(header));
+		check_bool(FlushFileBuffers(m_file.get()));
+
+		m_dataEnd = indexOffset + indexSize;
+		m_dirty = false;
+	}
+
+	size_t ShaderArchive::GetEntryCount() const
+	{
+		std::lock_guard lock(m_mutex);
+		return m_index.size();
+	}
+
+	uint64_t ShaderArchive::GetFileSize() const
+	{
+		std::lock_guard lock(m_mutex);
+		return m_dataEnd;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+
+namespace dx
+{
+	// A single packed file of compiled shaders, memory mapped for reading.
+	//
+	// Layout: Header | payloads, each 16 byte aligned | index of (key, offset, size) sorted by key
+	//
+	// Appends write the payload past the end of the data and only update the index in memory.
+	// Commit writes the whole index after the data, flushes, and only then rewrites the header
+	// to point at it. A crash at any point leaves the header referring to the previous, intact
+	// index, losing only the entries appended since. Commit once per batch of appends; the
+	// destructor commits anything left.
+	//
+	// The file and its mapping grow in large steps, and stale payloads and indices are left
+	// behind as dead space until the archive is compacted when it is next opened.
+	class ShaderArchive
+	{
+	public:
+		explicit ShaderArchive(const std::filesystem::path& path);
+		~ShaderArchive();
+
+		ShaderArchive(const ShaderArchive&) = delete;
+		ShaderArchive& operator=(const ShaderArchive&) = delete;
+
+		// Looks up a payload by key, including entries not committed yet. The returned memory
+		// stays valid for the lifetime of the archive, since views are only unmapped on destruction.
+		bool Find(uint64_t key, const void** ppData, size_t* pSize) const;
+
+		// Stores a payload, replacing any existing entry with the same key
+		void Append(uint64_t key, const void* pData, size_t size);
+
+		// Makes every appended entry durable
+		void Commit();
+
+		size_t GetEntryCount() const;
+
+		// Bytes of the file in use, not counting space reserved for growth
+		uint64_t GetFileSize() const;
+
+	private:
+		struct Entry
+		{
+			uint64_t key;
+			uint64_t offset;
+			uint64_t size;
+		};
+
+		std::filesystem::path m_path;
+		winrt::file_handle m_file;
+		// Each view maps the file from the start, so the last one covers everything
+		std::vector<const uint8_t*> m_views;
+		std::vector<Entry> m_index;
+		uint64_t m_dataEnd;
+		uint64_t m_capacity;
+		bool m_dirty;
+		mutable std::mutex m_mutex;
+
+		void OpenFile();
+		bool MapAndValidate();
+		void Reset();
+		void Compact();
+		void Reserve(uint64_t size);
+		void UnmapViews();
+		uint64_t GetLiveBytes() const;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,412 @@
+#include "stdafx.h"
+
+#include "ShaderCache.h"
+
+#include "ShaderArchive.h"
+#include "Util.h"
+#include "Cascades.h"
+
+using winrt::com_ptr;
+using winrt::hresult;
+
+namespace
+{
+	namespace fs = std::filesystem;
+
+	const fs::path g_cachePath = "ShaderCache";
+
+	// Seeds for keys derived from a shader request or key
+	constexpr uint64_t MANIFEST_SEED = dx::HashString("manifest");
+	constexpr uint64_t REQUEST_SEED = dx::HashString("request");
+
+	// Manifests are stored next to the bytecode under a key derived from the shader key
+	uint64_t GetManifestKey(uint64_t key)
+	{
+		return dx::HashBytes(&key, sizeof(key), MANIFEST_SEED);
+	}
+
+	// Identifies a compilation request without looking at the source. Its archive entry holds
+	// the key of the bytecode the request last produced.
+	uint64_t GetRequestKey(const std::string& path, const std::string& target, unsigned int flags,
+		const std::vector<std::pair<std::string, std::string>>& defines)
+	{
+		uint64_t key = dx::HashString(fs::path(path).lexically_normal().generic_string(), REQUEST_SEED);
+		key = dx::HashString(target, key);
+		key = dx::HashBytes(&flags, sizeof(flags), key);
+		for (const auto& [name, value] : defines)
+		{
+			key = dx::HashString(name + "=" + value + ";", key);
+		}
+		return key;
+	}
+
+	// A request entry holds the key of the bytecode the request last produced, followed by the
+	// manifest of the files it read, so repeating the request only has to check those files
+	bool FindRequest(const dx::ShaderArchive& archive, uint64_t requestKey, uint64_t* pKey,
+		std::string_view* pManifest = nullptr)
+	{
+		const void* pData = nullptr;
+		size_t size = 0;
+		if (!archive.Find(requestKey, &pData, &size) || size < sizeof(uint64_t))
+		{
+			return false;
+		}
+		memcpy(pKey, pData, sizeof(uint64_t));
+		if (pManifest)
+		{
+			*pManifest = std::string_view(static_cast<const char*>(pData) + sizeof(uint64_t), size - sizeof(uint64_t));
+		}
+		return true;
+	}
+
+	// Defines passed to every shader, describing compile-time configuration shared with the C++ side
+	std::vector<std::pair<std::string, std::string>> GetGlobalDefines()
+	{
+		return {
+			{ "NUM_CASCADES", std::to_string(dx::SHADOW_CASCADE_COUNT) },
+			{ "SHADOW_MAP_SIZE", std::to_string(dx::SHADOW_MAP_SIZE) }
+		};
+	}
+
+	// Content hash of each source file, read once per process. Sources only change during a
+	// run while hot reload watches them, which forgets their hashes through
+	// ForgetShaderSourceHashes. A file read while hashes were being forgotten is not
+	// remembered, since it may hold the contents from before the change.
+	std::mutex g_fileHashMutex;
+	std::unordered_map<std::string, uint64_t> g_fileHashes;
+	uint64_t g_fileHashGeneration = 0;
+
+#ifndef DX_SHADERS_PRECOMPILED
+	// Everything below is only used to compile shaders, which precompiled builds never do
+
+	// Points the request at the given bytecode and manifest, unless it already does
+	void RecordRequest(dx::ShaderArchive& archive, uint64_t requestKey, uint64_t key, const std::string& manifest)
+	{
+		std::string entry(sizeof(key), '\0');
+		memcpy(entry.data(), &key, sizeof(key));
+		entry += manifest;
+
+		const void* pData = nullptr;
+		size_t size = 0;
+		if (!archive.Find(requestKey, &pData, &size) || size != entry.size() ||
+			memcmp(pData, entry.data(), size) != 0)
+		{
+			archive.Append(requestKey, entry.data(), entry.size());
+		}
+	}
+
+	std::string ReadTextFile(const fs::path& path)
+	{
+		std::ifstream ifs(path, std::ios::binary);
+		if (!ifs)
+		{
+			throw dx::ShaderCompileError("Failed to open shader source " + path.string(),
+				{ path.lexically_normal().generic_string() });
+		}
+		return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+	}
+
+	std::string KeyToString(uint64_t key)
+	{
+		std::array<char, 17> str{};
+		snprintf(str.data(), str.size(), "%016llx", static_cast<unsigned long long>(key));
+		return str.data();
+	}
+
+	bool GetFileHash(const std::string& path, uint64_t* pHash)
+	{
+		uint64_t generation = 0;
+		{
+			std::lock_guard lock(g_fileHashMutex);
+			auto it = g_fileHashes.find(path);
+			if (it != g_fileHashes.end())
+			{
+				*pHash = it->second;
+				return true;
+			}
+			generation = g_fileHashGeneration;
+		}
+
+		std::ifstream ifs(path, std::ios::binary);
+		if (!ifs)
+		{
+			return false;
+		}
+		*pHash = dx::HashString(std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()));
+
+		std::lock_guard lock(g_fileHashMutex);
+		if (generation == g_fileHashGeneration)
+		{
+			g_fileHashes[path] = *pHash;
+		}
+		return true;
+	}
+
+	// True if every file in a manifest still has the hash it had when compiled. An empty
+	// manifest, as left by archives from before manifests were stored with requests, never is.
+	bool IsManifestCurrent(std::string_view manifest)
+	{
+		bool empty = true;
+		while (!manifest.empty())
+		{
+			auto end = manifest.find('\n');
+			auto line = manifest.substr(0, end);
+			manifest = (end == std::string_view::npos) ? std::string_view() : manifest.substr(end + 1);
+
+			auto separator = line.find(' ');
+			if (separator == std::string_view::npos)
+			{
+				return false;
+			}
+			uint64_t hash = 0;
+			if (!GetFileHash(std::string(line.substr(separator + 1)), &hash) ||
+				KeyToString(hash) != line.substr(0, separator))
+			{
+				return false;
+			}
+			empty = false;
+		}
+		return !empty;
+	}
+
+	// Resolves #include relative to the including file and records every file that was read
+	class IncludeHandler : public ID3DInclude
+	{
+	public:
+		explicit IncludeHandler(const fs::path& source) :
+			m_sourceDir(source.parent_path())
+		{
+		}
+
+		HRESULT __stdcall Open(D3D_INCLUDE_TYPE includeType, LPCSTR pFileName, LPCVOID pParentData,
+			LPCVOID* ppData, UINT* pBytes) override
+		{
+			auto it = m_fileDirs.find(pParentData);
+			fs::path path = ((it != m_fileDirs.end()) ? it->second : m_sourceDir) / pFileName;
+			path = path.lexically_normal();
+
+			std::ifstream ifs(path, std::ios::binary);
+			if (!ifs)
+			{
+				return E_FAIL;
+			}
+			auto pContents = std::make_unique<std::string>(std::istreambuf_iterator<char>(ifs),
+				std::istreambuf_iterator<char>());
+
+			m_dependencies[path.generic_string()] = dx::HashString(*pContents);
+			m_fileDirs[pContents->data()] = path.parent_path();
+			*ppData = pContents->data();
+			*pBytes = static_cast<UINT>(pContents->size());
+			m_files.push_back(std::move(pContents));
+			return S_OK;
+		}
+
+		// File contents are kept alive until the handler is destroyed
+		HRESULT __stdcall Close(LPCVOID pData) override
+		{
+			return S_OK;
+		}
+
+		// Included files and the hash of their contents
+		const std::map<std::string, uint64_t>& GetDependencies() const
+		{
+			return m_dependencies;
+		}
+
+	private:
+		fs::path m_sourceDir;
+		std::vector<std::unique_ptr<std::string>> m_files;
+		std::unordered_map<const void*, fs::path> m_fileDirs;
+		std::map<std::string, uint64_t> m_dependencies;
+	};
+
+	// The source and every include read so far, for reporting a failed compile
+	std::vector<std::string> GetReadFiles(const std::string& source, const IncludeHandler& includes)
+	{
+		std::vector<std::string> files{ fs::path(source).lexically_normal().generic_string() };
+		for (const auto& [path, hash] : includes.GetDependencies())
+		{
+			files.push_back(path);
+		}
+		return files;
+	}
+
+	// The manifest lists the source and every include with the hash it had when compiled,
+	// one "<hash> <path>" pair per line
+	std::string CreateManifest(const std::string& source, uint64_t sourceHash,
+		const std::map<std::string, uint64_t>& dependencies)
+	{
+		std::stringstream ss;
+		ss << KeyToString(sourceHash) << " " << fs::path(source).lexically_normal().generic_string() << "\n";
+		for (const auto& [path, hash] : dependencies)
+		{
+			ss << KeyToString(hash) << " " << path << "\n";
+		}
+		return ss.str();
+	}
+#endif
+}
+
+namespace dx
+{
+	ShaderArchive& GetShaderArchive()
+	{
+		static ShaderArchive archive([]()
+			{
+				fs::create_directories(g_cachePath);
+				return g_cachePath / "shaders.pak";
+			}());
+		return archive;
+	}
+
+	void ForgetShaderSourceHashes(const std::vector<std::string>& changed)
+	{
+		std::lock_guard lock(g_fileHashMutex);
+		g_fileHashGeneration++;
+		for (auto it = g_fileHashes.begin(); it != g_fileHashes.end();)
+		{
+			const auto& path = it->first;
+			const bool affected = std::any_of(changed.begin(), changed.end(), [&](const std::string& c)
+				{
+					return path == c || (path.size() > c.size() && path.compare(0, c.size(), c) == 0 &&
+						path[c.size()] == '/');
+				});
+			it = affected ? g_fileHashes.erase(it) : std::next(it);
+		}
+	}
+
+	std::vector<std::string> GetShaderDependencies(uint64_t key)
+	{
+		const void* pData = nullptr;
+		size_t size = 0;
+		if (!GetShaderArchive().Find(GetManifestKey(key), &pData, &size))
+		{
+			return {};
+		}
+
+		std::vector<std::string> dependencies;
+		std::istringstream manifest(std::string(static_cast<const char*>(pData), size));
+		std::string line;
+		while (std::getline(manifest, line))
+		{
+			if (auto separator = line.find(' '); separator != std::string::npos)
+			{
+				dependencies.push_back(line.substr(separator + 1));
+			}
+		}
+		return dependencies;
+	}
+
+	ShaderBytecode CompileShader(const std::string& path,
+		const std::vector<std::pair<std::string, std::string>>& defines, ShaderStage stage)
+	{
+		unsigned int flags = D3DCOMPILE_ENABLE_STRICTNESS;
+#ifdef _DEBUG
+		flags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+
+		std::string target;
+		switch (stage)
+		{
+		case ShaderStage::eVertex:
+			target = "vs_5_0";
+			break;
+		case ShaderStage::ePixel:
+			target = "ps_5_0";
+			break;
+		case ShaderStage::eCompute:
+			target = "cs_5_0";
+			break;
+		}
+
+		auto allDefines = GetGlobalDefines();
+		allDefines.insert(allDefines.end(), defines.begin(), defines.end());
+
+		auto& archive = GetShaderArchive();
+		ShaderBytecode bytecode{};
+		const uint64_t requestKey = GetRequestKey(path, target, flags, allDefines);
+		uint64_t previousKey = 0;
+		std::string_view previousManifest;
+		const bool requested = FindRequest(archive, requestKey, &previousKey, &previousManifest);
+
+#ifdef DX_SHADERS_PRECOMPILED
+		if (!requested || !archive.Find(previousKey, &bytecode.pData, &bytecode.size))
+		{
+			throw std::runtime_error("Shader permutation was not precompiled: " + path);
+		}
+		bytecode.key = previousKey;
+		return bytecode;
+#else
+		// Repeated requests only compare the content hashes of the files they read last time,
+		// which is much cheaper than preprocessing. Any change falls through to preprocessing
+		// and a fresh lookup.
+		if (requested && IsManifestCurrent(previousManifest) &&
+			archive.Find(previousKey, &bytecode.pData, &bytecode.size))
+		{
+			bytecode.key = previousKey;
+			return bytecode;
+		}
+
+		std::vector<D3D_SHADER_MACRO> macros;
+		for (const auto& d : allDefines)
+		{
+			macros.push_back(D3D_SHADER_MACRO{ d.first.c_str(), d.second.c_str() });
+		}
+		macros.push_back(D3D_SHADER_MACRO{ nullptr, nullptr });
+
+		// Preprocessing pulls in every include, so its output identifies the source exactly
+		const std::string source = ReadTextFile(path);
+		IncludeHandler includes(path);
+		com_ptr<ID3DBlob> preprocessed;
+		com_ptr<ID3DBlob> errorBlob;
+		hresult hr = D3DPreprocess(source.data(), source.size(), path.c_str(), macros.data(), &includes,
+			preprocessed.put(), errorBlob.put());
+		if (errorBlob)
+		{
+			std::cerr << "Shader preprocessing error: " + std::string(static_cast<char*>(errorBlob->GetBufferPointer()));
+		}
+		if (FAILED(hr))
+		{
+			throw ShaderCompileError("Failed to preprocess " + path, GetReadFiles(path, includes));
+		}
+
+		// Defines are already applied to the preprocessed text, so leaving them out of the key
+		// lets permutations that only differ in unused defines share bytecode
+		uint64_t key = HashBytes(preprocessed->GetBufferPointer(), preprocessed->GetBufferSize());
+		key = HashString(target, key);
+		key = HashBytes(&flags, sizeof(flags), key);
+		bytecode.key = key;
+		const auto manifest = CreateManifest(path, HashString(source), includes.GetDependencies());
+
+		if (archive.Find(key, &bytecode.pData, &bytecode.size))
+		{
+			RecordRequest(archive, requestKey, key, manifest);
+			return bytecode;
+		}
+
+		// Compile the preprocessed text, there is no need to resolve the includes again
+		com_ptr<ID3DBlob> shaderBlob;
+		errorBlob = nullptr;
+		std::cout << "Compiling shader " << path << std::endl;
+		hr = D3DCompile(preprocessed->GetBufferPointer(), preprocessed->GetBufferSize(), path.c_str(),
+			nullptr, nullptr, "main", target.c_str(), flags, 0, shaderBlob.put(), errorBlob.put());
+		if (errorBlob)
+		{
+			// Output specific shader compilation errors
+			std::cerr << "Shader compilation warning: " + std::string(static_cast<char*>(errorBlob->GetBufferPointer()));
+		}
+		// Throw if shader compilation failed
+		if (FAILED(hr))
+		{
+			throw ShaderCompileError("Failed to compile " + path, GetReadFiles(path, includes));
+		}
+
+		archive.Append(GetManifestKey(key), manifest.data(), manifest.size());
+		archive.Append(key, shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize());
+		RecordRequest(archive, requestKey, key, manifest);
+
+		archive.Find(key, &bytecode.pData, &bytecode.size);
+		return bytecode;
+#endif
+	}
+}
\ No newline at end of file
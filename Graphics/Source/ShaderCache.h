@@ -0,0 +1,81 @@
+#pragma once
+
+namespace dx
+{
+	class ShaderArchive;
+
+	enum class ShaderStage
+	{
+		eVertex,
+		ePixel,
+		eCompute
+	};
+
+	// Compiled shader bytecode, pointing into the memory mapped cache archive which stays
+	// mapped for the lifetime of the process. Requests that produce identical bytecode share
+	// the same key.
+	struct ShaderBytecode
+	{
+		const void* pData;
+		size_t size;
+		uint64_t key;
+	};
+
+	// One shader source compiled with one set of defines. Effects enumerate the permutations
+	// they can create so the ShaderCompiler tool can build them all ahead of time.
+	struct ShaderPermutation
+	{
+		std::string path;
+		ShaderStage stage;
+		std::vector<std::pair<std::string, std::string>> defines;
+	};
+
+	// Thrown when a shader source cannot be read, preprocessed or compiled. Lists the normalized
+	// paths of the files read before the failure, so it can be retried once one of them changes.
+	class ShaderCompileError : public std::runtime_error
+	{
+	public:
+		ShaderCompileError(const std::string& message, std::vector<std::string> dependencies) :
+			std::runtime_error(message),
+			m_dependencies(std::move(dependencies))
+		{
+		}
+
+		const std::vector<std::string>& GetDependencies() const
+		{
+			return m_dependencies;
+		}
+
+	private:
+		std::vector<std::string> m_dependencies;
+	};
+
+	// Compiles a shader, or finds its bytecode in ShaderCache/shaders.pak if an identical
+	// compilation has been done before. The cache key is a hash of the preprocessed source with
+	// all includes, the target profile and the compiler flags, so editing a header or changing
+	// flags invalidates exactly the affected shaders. Defines only matter through their effect
+	// on the preprocessed source, so permutations differing in defines a stage never reads
+	// share one compiled shader. Each cached shader has a
+	// manifest listing the files it was built from, stored in the archive under a derived key.
+	//
+	// Every request also records an alias from the path, defines, target and flags to the
+	// compiled shader, along with the hashes of the files it read. Repeating a request follows
+	// the alias as long as the contents of those files hash the same, and only preprocesses
+	// when one differs. Each file is hashed once per process, never trusting timestamps.
+	// Release builds define DX_SHADERS_PRECOMPILED, and only follow these aliases and never
+	// read or compile shader sources. Their pre-build step runs the ShaderCompiler tool, built
+	// with the same configuration, to fill the archive first.
+	ShaderBytecode CompileShader(const std::string& path,
+		const std::vector<std::pair<std::string, std::string>>& defines, ShaderStage stage);
+
+	// The archive backing the cache, opened on first use
+	ShaderArchive& GetShaderArchive();
+
+	// Makes the next requests hash the given files, and the files under the given directories,
+	// again. Called by hot reload when sources change on disk.
+	void ForgetShaderSourceHashes(const std::vector<std::string>& changed);
+
+	// Normalized paths of the source and every include a cached shader was built from, read
+	// from its manifest. Empty if the shader is not in the archive.
+	std::vector<std::string> GetShaderDependencies(uint64_t key);
+}
\ No newline at end of file
@@ -1,6 +1,15 @@
 #ifndef COMMON_HLSL
 #define COMMON_HLSL
 
+// Shadow configuration, normally supplied by the application at compile time
+#ifndef NUM_CASCADES
+#define NUM_CASCADES 3
+#endif
+
+#ifndef SHADOW_MAP_SIZE
+#define SHADOW_MAP_SIZE 2048
+#endif
+
 cbuffer PerObject : register(b0)
 {
     float4x4 g_model;
@@ -12,9 +21,9 @@ cbuffer PerFrame : register(b1)
     float3 g_eye;
     float4x4 g_viewProj;
     float4x4 g_view;
-    float4x4 g_lightViewProj[3];
-    float3 cascadeSplits;
-    float pad;
+    float4x4 g_lightViewProj[NUM_CASCADES];
+    float4 cascadeSplits;
+    uint4 g_cascadeRemap;
 };
 
 SamplerState g_linearWrap : register(s0);
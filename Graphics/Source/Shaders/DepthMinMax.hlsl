@@ -6,8 +6,66 @@
 #define NUMTHREADS_1D 8
 #define NUMTHREADS (NUMTHREADS_1D * NUMTHREADS_1D)
 
-[numthreads(1, 1, 1)]
+// Reduces the depth buffer to the minimum and maximum depth of all covered pixels.
+// Each thread gathers a 2x2 quad, so one group covers a 16x16 pixel tile.
+Texture2D<float> depthBuffer : register(t0);
+
+// Element 0 holds the bits of the minimum depth and element 1 the inverted bits of the
+// maximum depth. Depths are positive, so their bit patterns sort in the same order as the
+// values, and both elements can be cleared to 0xFFFFFFFF and reduced with InterlockedMin.
+RWByteAddressBuffer minMaxDepth : register(u0);
+
+groupshared float2 gs_minMax[NUMTHREADS];
+
+[numthreads(NUMTHREADS_1D, NUMTHREADS_1D, 1)]
 void main(uint3 globalID : SV_DispatchThreadID, uint3 localID : SV_GroupThreadID, uint3 groupID : SV_GroupID)
 {
-    
+    uint width;
+    uint height;
+    depthBuffer.GetDimensions(width, height);
+
+    float2 minMax = float2(FLT_MAX, 0.0);
+    uint2 pixel = 2 * globalID.xy;
+    if (pixel.x < width && pixel.y < height)
+    {
+        float2 uv = (pixel + 1.0) / float2(width, height);
+        float4 depths = depthBuffer.GatherRed(g_pointClamp, uv);
+
+        // Ignore background pixels that still hold the clear value
+        [unroll]
+        for (int i = 0; i < 4; i++)
+        {
+            if (depths[i] < 1.0)
+            {
+                minMax.x = min(minMax.x, depths[i]);
+                minMax.y = max(minMax.y, depths[i]);
+            }
+        }
+    }
+
+    uint localIdx = localID.y * NUMTHREADS_1D + localID.x;
+    gs_minMax[localIdx] = minMax;
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for (uint s = NUMTHREADS / 2; s > 0; s >>= 1)
+    {
+        if (localIdx < s)
+        {
+            float2 other = gs_minMax[localIdx + s];
+            gs_minMax[localIdx] = float2(min(gs_minMax[localIdx].x, other.x), max(gs_minMax[localIdx].y, other.y));
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (localIdx == 0)
+    {
+        float2 result = gs_minMax[0];
+        if (result.y > 0.0)
+        {
+            uint ignored;
+            minMaxDepth.InterlockedMin(0, asuint(result.x), ignored);
+            minMaxDepth.InterlockedMin(4, ~asuint(result.y), ignored);
+        }
+    }
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef EVSM_HLSL
+#define EVSM_HLSL
+
+// Exponential variance shadow maps. Depth is warped by an exponential before the moments are
+// stored, which removes most of the light bleeding of plain VSMs. Only the positive warp is
+// kept so the moments fit in two channels. The exponent is the largest that does not overflow
+// the squared moment in 32-bit floats.
+#define EVSM_POSITIVE_EXPONENT 40.0
+#define EVSM_MIN_VARIANCE 0.0001
+#define EVSM_LIGHT_BLEED_REDUCTION 0.3
+
+// Half width of the separable box filter applied to the moments, in texels
+#define EVSM_BLUR_RADIUS 2
+
+// Returns the warped depth for a [0, 1] depth value
+float WarpDepth(float depth)
+{
+    depth = 2.0 * depth - 1.0;
+    return exp(EVSM_POSITIVE_EXPONENT * depth);
+}
+
+// Moments stored in the shadow map: (warped, warped^2)
+float2 ComputeMoments(float depth)
+{
+    float warped = WarpDepth(depth);
+    return float2(warped, warped * warped);
+}
+
+// One-tailed Chebyshev upper bound on the fraction of the filter region that is lit
+float ChebyshevUpperBound(float2 moments, float depth, float minVariance)
+{
+    float variance = max(moments.y - moments.x * moments.x, minVariance);
+    float d = depth - moments.x;
+    float pMax = variance / (variance + d * d);
+    return (depth <= moments.x) ? 1.0 : pMax;
+}
+
+// Cuts off the tail of the Chebyshev bound, trading some softness for less light bleeding
+float ReduceLightBleeding(float pMax, float amount)
+{
+    return saturate((pMax - amount) / (1.0 - amount));
+}
+
+float EVSMVisibility(float2 moments, float depth)
+{
+    float warped = WarpDepth(depth);
+
+    // Scale the minimum variance to the warped depth range
+    float depthScale = EVSM_MIN_VARIANCE * EVSM_POSITIVE_EXPONENT * warped;
+    float pMax = ChebyshevUpperBound(moments, warped, depthScale * depthScale);
+    return ReduceLightBleeding(pMax, EVSM_LIGHT_BLEED_REDUCTION);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include "Common.hlsli"
+#include "EVSM.hlsli"
+
+#define NUMTHREADS_1D 8
+
+// Separable box filter over the shadow cascades. The horizontal pass reads the depth maps
+// and converts them to EVSM moments as it filters, the vertical pass reads its output and
+// writes the top mip of the moment maps. One group z slice is dispatched per refreshed cascade.
+#ifdef CONVERT_DEPTH
+Texture2DArray<float> source : register(t0);
+#else
+Texture2DArray<float2> source : register(t0);
+#endif
+
+RWTexture2DArray<float2> destination : register(u0);
+
+float2 LoadMoments(int3 coord)
+{
+#ifdef CONVERT_DEPTH
+    return ComputeMoments(source.Load(int4(coord, 0)));
+#else
+    return source.Load(int4(coord, 0));
+#endif
+}
+
+[numthreads(NUMTHREADS_1D, NUMTHREADS_1D, 1)]
+void main(uint3 globalID : SV_DispatchThreadID)
+{
+    uint cascade = g_cascadeRemap[globalID.z];
+    if (any(globalID.xy >= SHADOW_MAP_SIZE))
+    {
+        return;
+    }
+
+#ifdef CONVERT_DEPTH
+    int2 direction = int2(1, 0);
+#else
+    int2 direction = int2(0, 1);
+#endif
+
+    float2 sum = float2(0.0, 0.0);
+    [unroll]
+    for (int i = -EVSM_BLUR_RADIUS; i <= EVSM_BLUR_RADIUS; i++)
+    {
+        int2 coord = clamp(int2(globalID.xy) + i * direction, 0, SHADOW_MAP_SIZE - 1);
+        sum += LoadMoments(int3(coord, cascade));
+    }
+    destination[uint3(globalID.xy, cascade)] = sum / (2 * EVSM_BLUR_RADIUS + 1);
+}
\ No newline at end of file
@@ -1,4 +1,7 @@
 #include "Common.hlsli"
+#ifdef USE_MOMENT_SHADOWS
+#include "EVSM.hlsli"
+#endif
 
 /* 
  * TERMS:
@@ -19,7 +22,6 @@
 #define FILTER_SIZE 3
 #define BIAS 0.000
 #define NORMAL_BIAS 0.01
-#define SHADOW_MAP_SIZE 2048
 
 #define FS FILTER_SIZE
 #define FS_2 FILTER_SIZE / 2
@@ -246,7 +248,58 @@ Texture2D<float3> baseColorMap : register(t1);
 Texture2D<float3> ormMap : register(t2);
 Texture2D<float2> normalMap : register(t3);
 
+#ifdef USE_MOMENT_SHADOWS
+Texture2DArray<float2> shadowMoments : register(t4);
+#else
 Texture2DArray<float> shadowMap : register(t4);
+#endif
+
+#ifdef USE_IBL
+// Baked offline by the Converter, see EnvironmentBaker.h
+TextureCube<float3> specularEnvironment : register(t5);
+Texture2D<float4> irradianceSH : register(t6);
+Texture2D<float2> brdfLUT : register(t7);
+
+// Irradiance from the cosine convolved SH9 coefficients, same basis order as the baker
+float3 EvaluateIrradianceSH(float3 n)
+{
+    float basis[9] = {
+        0.282095,
+        0.488603 * n.y,
+        0.488603 * n.z,
+        0.488603 * n.x,
+        1.092548 * n.x * n.y,
+        1.092548 * n.y * n.z,
+        0.315392 * (3.0 * n.z * n.z - 1.0),
+        1.092548 * n.x * n.z,
+        0.546274 * (n.x * n.x - n.y * n.y)
+    };
+
+    float3 irradiance = float3(0.0, 0.0, 0.0);
+    [unroll]
+    for (int i = 0; i < 9; i++)
+    {
+        irradiance += basis[i] * irradianceSH.Load(int3(i, 0, 0)).rgb;
+    }
+    return max(irradiance, 0.0);
+}
+
+// Split-sum approximation of the environment lighting
+float3 EnvironmentLighting(float3 n, float3 v, float3 f_0, float3 diffuse, float linearRoughness)
+{
+    uint width;
+    uint height;
+    uint levels;
+    specularEnvironment.GetDimensions(0, width, height, levels);
+
+    float NdotV = saturate(dot(n, v));
+    float3 r = reflect(-v, n);
+    float3 prefiltered = specularEnvironment.SampleLevel(g_linearClamp, r, linearRoughness * (levels - 1));
+    float2 scaleBias = brdfLUT.SampleLevel(g_linearClamp, float2(NdotV, linearRoughness), 0);
+
+    return diffuse * M_1_PI * EvaluateIrradianceSH(n) + prefiltered * (f_0 * scaleBias.x + scaleBias.y);
+}
+#endif
 
 struct PSInput
 {
@@ -361,13 +414,15 @@ float4 main(PSInput input) : SV_TARGET
     float3 l = normalize(-lights[0].direction);
     float NdL = saturate(dot(n, l));
     
-    // Calculate shadowing using vector comparison of view space position
-    float3 dist = -input.viewPosition.zzz;
-    float3 ref0 = float3(0, cascadeSplits.x, cascadeSplits.y);
-    float3 ref1 = cascadeSplits;
-    bool3 mask0 = dist >= ref0;
-    bool3 mask1 = dist < ref1;
-    int cascadeIdx = dot(mask0 * mask1, int3(0, 1, 2));
+    // Calculate shadowing by comparing view space depth to the splits. Pixels beyond the
+    // last split fall into the last cascade, since fitted splits can lag behind the camera.
+    float dist = -input.viewPosition.z;
+    int cascadeIdx = 0;
+    [unroll]
+    for (int i = 0; i < NUM_CASCADES - 1; i++)
+    {
+        cascadeIdx += (dist >= cascadeSplits[i]);
+    }
     float3 cascadeColor = 0.3 * float3(cascadeIdx == 0, cascadeIdx == 1, cascadeIdx == 2);
     
     // Apply normal offset
@@ -382,10 +437,21 @@ float4 main(PSInput input) : SV_TARGET
     float shadow = 1.0;
     float3 duvd_dx = ddx_fine(shadowPosUV);
     float3 duvd_dy = ddy_fine(shadowPosUV);
+#ifdef USE_MOMENT_SHADOWS
+    // Prefiltered moments only need a single filtered fetch. Gradients come from outside the
+    // branch, which diverges at cascade seams and the edges of the shadowed range.
+    if (shadowPosUV.z > 0.0 && shadowPosUV.z < 1.0)
+    {
+        float2 moments = shadowMoments.SampleGrad(g_anisotropicClamp, float3(shadowPosUV.xy, cascadeIdx),
+            duvd_dx.xy, duvd_dy.xy);
+        shadow = EVSMVisibility(moments, shadowPosUV.z);
+    }
+#else
     if (shadowPosUV.z > 0.0 && shadowPosUV.z < 1.0)
     {
         shadow = ShadowPCF(shadowPosUV, duvd_dx, duvd_dy, cascadeIdx, shadowMap);
     }
+#endif
     
 #ifdef USE_NORMAL_MAP
     float3 t = normalize(input.tangent);
@@ -416,8 +482,12 @@ float4 main(PSInput input) : SV_TARGET
     float3 f_0 = lerp(float3(0.04, 0.04, 0.04), color, metalness);
     float3 diffuse = (1.0 - metalness) * color;
 	
+#ifdef USE_IBL
+    float3 outColor = EnvironmentLighting(n, v, f_0, diffuse, linearRoughness);
+#else
 	// Hack for ambient light
     float3 outColor = 0.4 * color;
+#endif
 	
         //float3 l = normalize(lights[i].position - input.worldPosition);
     float3 f = BRDF(n, v, l, f_0, diffuse, linearRoughness);
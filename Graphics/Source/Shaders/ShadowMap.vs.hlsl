@@ -22,9 +22,12 @@ struct VSOutput
 
 VSOutput main(VSInput input)
 {
+    // Only the cascades being refreshed this frame are instanced
+    uint cascade = g_cascadeRemap[input.instance];
+
     VSOutput output;
-    output.position = mul(mul(float4(input.position, 1.0), g_model), g_lightViewProj[input.instance]);
+    output.position = mul(mul(float4(input.position, 1.0), g_model), g_lightViewProj[cascade]);
     output.position.z = max(output.position.z, 0.0);
-    output.renderTarget = input.instance;
+    output.renderTarget = cascade;
     return output;
 }
\ No newline at end of file
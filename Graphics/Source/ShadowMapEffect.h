@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Effect.h"
+#include "D3DCache.h"
+#include "ShaderCache.h"
 
 namespace dx
 {
@@ -18,27 +20,52 @@ namespace dx
 			Bits bits;
 			uint32_t key;
 
+			static constexpr uint32_t BIT_COUNT = static_cast<uint32_t>(CountFields<Bits>());
+			static_assert(BIT_COUNT < 32 && sizeof(Bits) <= sizeof(uint32_t), "Options must fit in the key");
+
 			Options() : key(0) { }
 		};
 
 		ShadowMapEffect(ID3D11Device* pDevice, Options options) :
 			m_options(options)
 		{
-			auto defines = GetDefines(options);
-			m_pVS = CreateVertexShader(pDevice, "Source/Shaders/ShadowMap.vs.hlsl", defines, options.key);
+			// Depth only. Geometry is not clipped against the near plane, since casters in front
+			// of a cascade's fitted depth range must still be rendered.
+			auto rsDesc = CommonRasterizerStates::CullNoneDesc();
+			rsDesc.DepthClipEnable = false;
+
+			PipelineStateDesc desc;
+			desc.pVS = CreateVertexShader(pDevice, "Source/Shaders/ShadowMap.vs.hlsl", GetDefines(options));
+			desc.pRasterizerState = CreateRasterizerState(pDevice, rsDesc);
+			desc.pDepthStencilState = CreateDepthStencilState(pDevice, CommonDepthStencilStates::DepthEnabledWriteDesc());
+			m_pPipelineState = CreatePipelineState(desc);
+		}
+
+		static std::vector<ShaderPermutation> GetPermutations()
+		{
+			std::vector<ShaderPermutation> ret;
+			for (uint32_t key = 0; key < (1u << Options::BIT_COUNT); key++)
+			{
+				Options options;
+				options.key = key;
+				ret.push_back({ "Source/Shaders/ShadowMap.vs.hlsl", ShaderStage::eVertex, GetDefines(options) });
+			}
+			return ret;
+		}
+
+		const PipelineState* GetPipelineState() const override
+		{
+			return m_pPipelineState.get();
 		}
 
 		void Bind(ID3D11DeviceContext* pContext) const override
 		{
-			m_pVS->Bind(pContext);
-			// Bind a null pixel shader
-			SetPS(pContext, nullptr);
 		}
 
 	private:
 		Options m_options;
 
-		std::shared_ptr<VertexShader> m_pVS;
+		std::shared_ptr<const PipelineState> m_pPipelineState;
 
 		static std::vector<std::pair<std::string, std::string>> GetDefines(Options options)
 		{
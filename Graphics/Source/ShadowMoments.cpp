@@ -0,0 +1,32 @@
+#include "stdafx.h"
+
+#include "ShadowMoments.h"
+
+namespace dx
+{
+	std::vector<DirectX::XMFLOAT2> BoxBlurMoments(const std::vector<DirectX::XMFLOAT2>& moments,
+		unsigned int width, unsigned int height, bool horizontal, int radius)
+	{
+		using namespace DirectX;
+
+		assert(moments.size() == static_cast<size_t>(width) * height);
+
+		std::vector<XMFLOAT2> result(moments.size());
+		float weight = 1.0f / (2 * radius + 1);
+		for (int y = 0; y < static_cast<int>(height); y++)
+		{
+			for (int x = 0; x < static_cast<int>(width); x++)
+			{
+				auto sum = XMVectorZero();
+				for (int i = -radius; i <= radius; i++)
+				{
+					int sx = horizontal ? std::clamp(x + i, 0, static_cast<int>(width) - 1) : x;
+					int sy = horizontal ? y : std::clamp(y + i, 0, static_cast<int>(height) - 1);
+					sum = XMVectorAdd(sum, XMLoadFloat2(&moments[sy * width + sx]));
+				}
+				XMStoreFloat2(&result[y * width + x], XMVectorScale(sum, weight));
+			}
+		}
+		return result;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+// CPU reference for the exponential variance shadow map filtering in Shaders/EVSM.hlsli
+// and Shaders/EVSMBlur.hlsl. The constants and math must be kept in sync with the shaders.
+namespace dx
+{
+	constexpr float EVSM_POSITIVE_EXPONENT = 40.0f;
+	constexpr float EVSM_MIN_VARIANCE = 0.0001f;
+	constexpr float EVSM_LIGHT_BLEED_REDUCTION = 0.3f;
+	constexpr int EVSM_BLUR_RADIUS = 2;
+
+	// Returns the warped depth for a [0, 1] depth value
+	inline float WarpDepth(float depth)
+	{
+		depth = 2.0f * depth - 1.0f;
+		return std::exp(EVSM_POSITIVE_EXPONENT * depth);
+	}
+
+	// Moments stored in the shadow map: (warped, warped^2)
+	inline DirectX::XMFLOAT2 ComputeMoments(float depth)
+	{
+		float warped = WarpDepth(depth);
+		return { warped, warped * warped };
+	}
+
+	// One-tailed Chebyshev upper bound on the fraction of the filter region that is lit
+	inline float ChebyshevUpperBound(float mean, float meanSquared, float depth, float minVariance)
+	{
+		if (depth <= mean)
+		{
+			return 1.0f;
+		}
+		float variance = std::max(meanSquared - mean * mean, minVariance);
+		float d = depth - mean;
+		return variance / (variance + d * d);
+	}
+
+	// Cuts off the tail of the Chebyshev bound, trading some softness for less light bleeding
+	inline float ReduceLightBleeding(float pMax, float amount)
+	{
+		return std::clamp((pMax - amount) / (1.0f - amount), 0.0f, 1.0f);
+	}
+
+	inline float EVSMVisibility(const DirectX::XMFLOAT2& moments, float depth)
+	{
+		float warped = WarpDepth(depth);
+
+		// Scale the minimum variance to the warped depth range
+		float depthScale = EVSM_MIN_VARIANCE * EVSM_POSITIVE_EXPONENT * warped;
+		float pMax = ChebyshevUpperBound(moments.x, moments.y, warped, depthScale * depthScale);
+		return ReduceLightBleeding(pMax, EVSM_LIGHT_BLEED_REDUCTION);
+	}
+
+	// One pass of the separable box filter over a width x height image, clamping at the edges.
+	// horizontal selects the filter direction.
+	std::vector<DirectX::XMFLOAT2> BoxBlurMoments(const std::vector<DirectX::XMFLOAT2>& moments,
+		unsigned int width, unsigned int height, bool horizontal, int radius = EVSM_BLUR_RADIUS);
+}
\ No newline at end of file
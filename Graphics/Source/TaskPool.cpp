@@ -0,0 +1,61 @@
+#include "stdafx.h"
+
+#include "TaskPool.h"
+
+namespace dx
+{
+	TaskPool::TaskPool(unsigned int threadCount) :
+		m_stopping(false)
+	{
+		if (threadCount == 0)
+		{
+			threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+		}
+		for (unsigned int i = 0; i < threadCount; i++)
+		{
+			m_threads.emplace_back(&TaskPool::WorkerLoop, this);
+		}
+	}
+
+	// Finishes all queued jobs before joining the workers
+	TaskPool::~TaskPool()
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_stopping = true;
+		}
+		m_jobAvailable.notify_all();
+		for (auto& thread : m_threads)
+		{
+			thread.join();
+		}
+	}
+
+	void TaskPool::Enqueue(std::function<void()> job)
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_jobs.push(std::move(job));
+		}
+		m_jobAvailable.notify_one();
+	}
+
+	void TaskPool::WorkerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock lock(m_mutex);
+				m_jobAvailable.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+				if (m_jobs.empty())
+				{
+					return;
+				}
+				job = std::move(m_jobs.front());
+				m_jobs.pop();
+			}
+			job();
+		}
+	}
+}
\ No newline at end of file
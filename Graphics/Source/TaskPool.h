@@ -0,0 +1,42 @@
+#pragma once
+
+namespace dx
+{
+	// Fixed set of worker threads running submitted jobs in FIFO order
+	class TaskPool
+	{
+	public:
+		// A thread count of zero uses one thread per hardware thread, less one for the render thread
+		explicit TaskPool(unsigned int threadCount = 0);
+		~TaskPool();
+
+		TaskPool(const TaskPool&) = delete;
+		TaskPool& operator=(const TaskPool&) = delete;
+
+		// Queues fn to run on a worker. Exceptions thrown by fn are stored in the future.
+		template<typename F>
+		auto Submit(F&& fn) -> std::future<std::invoke_result_t<F>>
+		{
+			using Result = std::invoke_result_t<F>;
+			auto pTask = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(fn));
+			auto future = pTask->get_future();
+			Enqueue([pTask]() { (*pTask)(); });
+			return future;
+		}
+
+		size_t GetThreadCount() const
+		{
+			return m_threads.size();
+		}
+
+	private:
+		std::vector<std::thread> m_threads;
+		std::queue<std::function<void()>> m_jobs;
+		std::mutex m_mutex;
+		std::condition_variable m_jobAvailable;
+		bool m_stopping;
+
+		void Enqueue(std::function<void()> job);
+		void WorkerLoop();
+	};
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+namespace dx
+{
+	// A DDS file with its pixel data compressed in chunks, written by the Converter and read
+	// by the TextureStreamer.
+	//
+	// Layout: ContainerHeader | DDS header | ContainerChunk table | compressed chunks
+	//
+	// The DDS header is stored as is. The pixel data is split into chunks of at most
+	// CONTAINER_CHUNK_SIZE bytes that never span two images, so any run of mips can be
+	// decompressed without touching the rest, and the chunks of a run in parallel. Each chunk is
+	// compressed on its own with XPRESS Huffman from the Windows compression API in raw mode.
+	// Chunks that do not shrink are stored uncompressed, with compressedSize equal to size.
+	constexpr uint32_t CONTAINER_MAGIC = 0x5A534444;	// "DDSZ"
+	constexpr uint32_t CONTAINER_VERSION = 1;
+	constexpr uint32_t CONTAINER_CHUNK_SIZE = 256 * 1024;
+
+	struct ContainerHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t ddsHeaderSize;
+		uint32_t chunkCount;
+	};
+
+	struct ContainerChunk
+	{
+		uint64_t dataOffset;		// Where the chunk belongs in the uncompressed DDS file
+		uint64_t fileOffset;		// Where its compressed bytes are in the container
+		uint32_t size;
+		uint32_t compressedSize;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,717 @@
+#include "stdafx.h"
+
+#include "TextureStreamer.h"
+
+#include "Util.h"
+#include "DDSTextureLoader11.h"
+
+using winrt::com_ptr;
+using winrt::check_hresult;
+
+namespace
+{
+	// Magic number, DDS_HEADER and the optional DDS_HEADER_DXT10
+	constexpr size_t DDS_HEADER_SIZE = 4 + 124;
+	constexpr size_t DDS_DX10_HEADER_SIZE = DDS_HEADER_SIZE + 20;
+
+	bool IsContainer(const uint8_t* pData, size_t size)
+	{
+		uint32_t magic = 0;
+		if (size >= sizeof(magic))
+		{
+			memcpy(&magic, pData, sizeof(magic));
+		}
+		return magic == dx::CONTAINER_MAGIC;
+	}
+
+	// Reads the chunk table of a compressed container and returns the size of the DDS header
+	// stored after the container header. Throws if the container is damaged.
+	uint32_t ReadContainer(const uint8_t* pData, size_t size, std::vector<dx::ContainerChunk>* pChunks)
+	{
+		dx::ContainerHeader header{};
+		if (size < sizeof(header))
+		{
+			throw std::runtime_error("Compressed texture is truncated");
+		}
+		memcpy(&header, pData, sizeof(header));
+		const uint64_t tableOffset = sizeof(header) + static_cast<uint64_t>(header.ddsHeaderSize);
+		const uint64_t tableSize = static_cast<uint64_t>(header.chunkCount) * sizeof(dx::ContainerChunk);
+		if (header.version != dx::CONTAINER_VERSION || tableOffset + tableSize > size)
+		{
+			throw std::runtime_error("Compressed texture has an unsupported version or is truncated");
+		}
+
+		pChunks->resize(header.chunkCount);
+		memcpy(pChunks->data(), pData + tableOffset, static_cast<size_t>(tableSize));
+
+		// Chunks must cover the pixel data in order, and lie within the file
+		uint64_t dataOffset = header.ddsHeaderSize;
+		for (const auto& chunk : *pChunks)
+		{
+			if (chunk.dataOffset != dataOffset || chunk.compressedSize > chunk.size ||
+				chunk.fileOffset + chunk.compressedSize > size)
+			{
+				throw std::runtime_error("Compressed texture has a damaged chunk table");
+			}
+			dataOffset += chunk.size;
+		}
+		return header.ddsHeaderSize;
+	}
+
+	// Size of the DDS file a container holds
+	uint64_t GetUncompressedSize(uint32_t ddsHeaderSize, const std::vector<dx::ContainerChunk>& chunks)
+	{
+		return chunks.empty() ? ddsHeaderSize : chunks.back().dataOffset + chunks.back().size;
+	}
+
+	void DecompressChunk(const uint8_t* pSrc, const dx::ContainerChunk& chunk, uint8_t* pDst)
+	{
+		if (chunk.compressedSize == chunk.size)
+		{
+			memcpy(pDst, pSrc, chunk.size);
+			return;
+		}
+
+		DECOMPRESSOR_HANDLE handle = nullptr;
+		winrt::check_bool(CreateDecompressor(COMPRESS_ALGORITHM_XPRESS_HUFF | COMPRESS_RAW, nullptr, &handle));
+		SIZE_T decompressedSize = 0;
+		BOOL result = Decompress(handle, pSrc, chunk.compressedSize, pDst, chunk.size, &decompressedSize);
+		CloseDecompressor(handle);
+		if (!result || decompressedSize != chunk.size)
+		{
+			throw std::runtime_error("Failed to decompress texture chunk");
+		}
+	}
+}
+
+namespace dx
+{
+	bool GetMipLayout(DXGI_FORMAT format, size_t width, size_t height, size_t mipLevels, uint64_t dataOffset,
+		std::vector<MipLayout>* pMips)
+	{
+		pMips->clear();
+		uint64_t offset = dataOffset;
+		for (size_t mip = 0; mip < mipLevels; mip++)
+		{
+			size_t rowPitch = 0;
+			size_t slicePitch = 0;
+			DirectX::ComputePitch(format, std::max<size_t>(1, width >> mip), std::max<size_t>(1, height >> mip),
+				rowPitch, slicePitch);
+			if (slicePitch == 0)
+			{
+				return false;
+			}
+			pMips->push_back({ offset, rowPitch, slicePitch });
+			offset += slicePitch;
+		}
+		return true;
+	}
+
+	bool ParseStreamableLayout(const uint8_t* pHeader, size_t headerSize, uint64_t fileSize,
+		DirectX::TexMetadata* pMetadata, std::vector<MipLayout>* pMips)
+	{
+		DirectX::TexMetadata& metadata = *pMetadata;
+		if (FAILED(DirectX::GetMetadataFromDDSMemory(pHeader, headerSize, DirectX::DDS_FLAGS_NO_LEGACY_EXPANSION,
+			metadata)))
+		{
+			return false;
+		}
+		if (metadata.dimension != DirectX::TEX_DIMENSION_TEXTURE2D || metadata.arraySize != 1 ||
+			metadata.IsCubemap() || metadata.mipLevels < 2)
+		{
+			return false;
+		}
+
+		// The pixel data fills the rest of the file, which tells the header size
+		if (!GetMipLayout(metadata.format, metadata.width, metadata.height, metadata.mipLevels, 0, pMips))
+		{
+			return false;
+		}
+		const uint64_t dataSize = pMips->back().offset + pMips->back().slicePitch;
+		if (fileSize != DDS_HEADER_SIZE + dataSize && fileSize != DDS_DX10_HEADER_SIZE + dataSize)
+		{
+			return false;
+		}
+		return GetMipLayout(metadata.format, metadata.width, metadata.height, metadata.mipLevels,
+			fileSize - dataSize, pMips);
+	}
+
+	bool ParseStreamableFile(const uint8_t* pData, size_t size, DirectX::TexMetadata* pMetadata,
+		std::vector<MipLayout>* pMips, std::vector<ContainerChunk>* pChunks)
+	{
+		pChunks->clear();
+		if (IsContainer(pData, size))
+		{
+			const uint32_t ddsHeaderSize = ReadContainer(pData, size, pChunks);
+			return ParseStreamableLayout(pData + sizeof(ContainerHeader), ddsHeaderSize,
+				GetUncompressedSize(ddsHeaderSize, *pChunks), pMetadata, pMips);
+		}
+		return ParseStreamableLayout(pData, std::min(size, DDS_DX10_HEADER_SIZE), size, pMetadata, pMips);
+	}
+
+	uint32_t GetRequiredMip(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t requestedSize)
+	{
+		uint32_t mip = 0;
+		uint32_t size = std::max(width, height);
+		while (mip + 1 < mipCount && (size >> 1) >= requestedSize)
+		{
+			size >>= 1;
+			mip++;
+		}
+		return mip;
+	}
+
+	uint32_t GetFirstLoadedMip(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t skipMips,
+		uint32_t maxDimension)
+	{
+		uint32_t mip = std::min(skipMips, mipCount > 0 ? mipCount - 1 : 0);
+		if (maxDimension > 0)
+		{
+			while (mip + 1 < mipCount && (std::max(width, height) >> mip) > maxDimension)
+			{
+				mip++;
+			}
+		}
+		return mip;
+	}
+
+	size_t GetLoaderMaxSize(const DirectX::TexMetadata& metadata, uint32_t skipMips, uint32_t maxDimension)
+	{
+		// The loader drops mips with any dimension larger than maxsize, so the limit is the
+		// largest dimension of the first mip kept
+		const uint32_t largest = static_cast<uint32_t>(std::max({ metadata.width, metadata.height, metadata.depth }));
+		const uint32_t firstMip = GetFirstLoadedMip(largest, largest, static_cast<uint32_t>(metadata.mipLevels),
+			skipMips, maxDimension);
+		return (firstMip > 0) ? std::max(1u, largest >> firstMip) : 0;
+	}
+
+	com_ptr<ID3D11ShaderResourceView> CreateTextureFromDDSMemory(ID3D11Device* pDevice, const uint8_t* pData,
+		size_t size, uint32_t skipMips, uint32_t maxDimension)
+	{
+		// Only the header is parsed to find the mips to drop, and files whose header cannot be
+		// parsed here are loaded with every mip
+		size_t maxSize = 0;
+		DirectX::TexMetadata metadata{};
+		if ((skipMips > 0 || maxDimension > 0) &&
+			SUCCEEDED(DirectX::GetMetadataFromDDSMemory(pData, size, DirectX::DDS_FLAGS_NONE, metadata)))
+		{
+			maxSize = GetLoaderMaxSize(metadata, skipMips, maxDimension);
+		}
+
+		com_ptr<ID3D11ShaderResourceView> pView;
+		DirectX::CreateDDSTextureFromMemoryEx(pDevice, pData, size, maxSize, D3D11_USAGE_DEFAULT,
+			D3D11_BIND_SHADER_RESOURCE, 0, 0, false, nullptr, pView.put());
+		return pView;
+	}
+
+	uint32_t GetRequiredTextureSize(DirectX::FXMVECTOR eye, const DirectX::BoundingSphere& bounds,
+		float texcoordDensity, float fov, float viewportHeight)
+	{
+		using namespace DirectX;
+
+		if (texcoordDensity <= 0.0f)
+		{
+			return 0;
+		}
+
+		// Pixels covered by one world unit at the nearest point of the mesh, and the texels
+		// per UV unit that puts one texel on each of them
+		constexpr float MIN_DISTANCE = 0.1f;
+		float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&bounds.Center), eye)));
+		distance = std::max(distance - bounds.Radius, MIN_DISTANCE);
+		float pixelsPerUnit = viewportHeight / (2.0f * distance * std::tan(fov * 0.5f));
+		float texels = std::min(pixelsPerUnit / texcoordDensity, static_cast<float>(D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION));
+		return static_cast<uint32_t>(std::ceil(texels));
+	}
+
+	std::vector<size_t> SelectEvictions(const std::vector<EvictionCandidate>& candidates, uint64_t excessBytes)
+	{
+		std::vector<size_t> order(candidates.size());
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			order[i] = i;
+		}
+		std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+			{
+				if (candidates[a].lastDrawnFrame != candidates[b].lastDrawnFrame)
+				{
+					return candidates[a].lastDrawnFrame < candidates[b].lastDrawnFrame;
+				}
+				return candidates[a].topMipBytes > candidates[b].topMipBytes;
+			});
+
+		std::vector<size_t> ret;
+		uint64_t freed = 0;
+		for (size_t i : order)
+		{
+			if (freed >= excessBytes)
+			{
+				break;
+			}
+			ret.push_back(i);
+			freed += candidates[i].topMipBytes;
+		}
+		return ret;
+	}
+
+	TextureStreamer::TextureStreamer(ID3D11Device* pDevice, TextureReadMode mode) :
+		m_mode(mode),
+		m_loadsInFlight(0),
+		m_pendingBytes(0),
+		m_budget(UINT64_MAX),
+		m_skipMips(0),
+		m_maxDimension(0),
+		m_frame(0),
+		m_evictionCount(0),
+		m_bytesRead(0),
+		m_decompressPool(),
+		m_pool(1)
+	{
+		m_pDevice.copy_from(pDevice);
+	}
+
+	std::shared_ptr<StreamingTexture> TextureStreamer::Load(const std::string& filename)
+	{
+		if (auto it = m_textures.find(filename); it != m_textures.end())
+		{
+			return it->second;
+		}
+
+		auto pTexture = CreateTexture(filename);
+		m_textures.emplace(filename, pTexture);
+		return pTexture;
+	}
+
+	std::vector<std::shared_ptr<StreamingTexture>> TextureStreamer::LoadBatch(const std::vector<std::string>& filenames,
+		unsigned int threadCount)
+	{
+		// Each file not loaded yet is read, parsed and created by one worker, so the device
+		// creates one texture while the other workers are still reading theirs
+		{
+			TaskPool pool(threadCount);
+			std::unordered_map<std::string, std::future<std::shared_ptr<StreamingTexture>>> loads;
+			for (const auto& filename : filenames)
+			{
+				if (m_textures.count(filename) == 0 && loads.count(filename) == 0)
+				{
+					loads.emplace(filename, pool.Submit([this, filename]() { return CreateTexture(filename); }));
+				}
+			}
+			for (auto& entry : loads)
+			{
+				m_textures.emplace(entry.first, entry.second.get());
+			}
+		}
+
+		std::vector<std::shared_ptr<StreamingTexture>> ret;
+		for (const auto& filename : filenames)
+		{
+			ret.push_back(m_textures.at(filename));
+		}
+		return ret;
+	}
+
+	// Loads the mip tail of a new texture. Uses only the device and the file cache, so it may
+	// run on any thread.
+	std::shared_ptr<StreamingTexture> TextureStreamer::CreateTexture(const std::string& filename)
+	{
+		auto pTexture = std::make_shared<StreamingTexture>();
+		pTexture->m_filename = filename;
+		try
+		{
+			if (ReadLayout(pTexture.get()))
+			{
+				pTexture->m_firstMip = GetFirstLoadedMip(pTexture->m_width, pTexture->m_height,
+					static_cast<uint32_t>(pTexture->m_mips.size()), m_skipMips, m_maxDimension);
+				uint32_t tailMip = GetTailMip(*pTexture);
+				pTexture->m_pView = LoadMips(*pTexture, tailMip);
+				pTexture->m_residentMip = tailMip;
+			}
+		}
+		catch (const winrt::hresult_error&)
+		{
+			// Eg. a block compressed mip tail whose size is not a multiple of the block size
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << e.what() << "\n";
+		}
+
+		if (!pTexture->m_pView)
+		{
+			pTexture->m_mips.clear();
+			pTexture->m_residentMip = 0;
+			pTexture->m_firstMip = 0;
+			LoadWhole(pTexture.get());
+			pTexture->m_unstreamedBytes = pTexture->m_pView ? GetTextureSize(pTexture->m_pView.get()) : 0;
+			m_bytesRead += pTexture->m_unstreamedBytes;
+		}
+		return pTexture;
+	}
+
+	void TextureStreamer::Update()
+	{
+		m_frame++;
+
+		std::vector<Reload> finished;
+		{
+			std::lock_guard lock(m_mutex);
+			finished.swap(m_finished);
+		}
+		for (auto& reload : finished)
+		{
+			auto& texture = *reload.pTexture;
+			if (reload.pView)
+			{
+				texture.m_pView = std::move(reload.pView);
+				texture.m_residentMip = reload.mip;
+			}
+			texture.m_loading = false;
+			m_pendingBytes -= reload.deltaBytes;
+			m_loadsInFlight--;
+		}
+
+		// Textures missing the most mips go first
+		uint64_t residentBytes = 0;
+		std::vector<std::pair<uint32_t, std::shared_ptr<StreamingTexture>>> wanted;
+		for (auto& [filename, pTexture] : m_textures)
+		{
+			auto& texture = *pTexture;
+			if (texture.m_drawn)
+			{
+				texture.m_lastDrawnFrame = m_frame;
+				texture.m_drawn = false;
+			}
+			residentBytes += GetTextureBytes(texture);
+
+			if (!texture.m_loading && texture.m_requestedSize > 0 && !texture.m_mips.empty())
+			{
+				uint32_t mip = std::max(texture.m_firstMip, GetRequiredMip(texture.m_width, texture.m_height,
+					static_cast<uint32_t>(texture.m_mips.size()), texture.m_requestedSize));
+				if (mip < texture.m_residentMip)
+				{
+					wanted.emplace_back(texture.m_residentMip - mip, pTexture);
+				}
+			}
+			texture.m_requestedSize = 0;
+		}
+		std::sort(wanted.begin(), wanted.end(),
+			[](const auto& a, const auto& b) { return a.first > b.first; });
+
+		// Resident bytes once the loads in flight have finished
+		auto getExpectedBytes = [&]() { return static_cast<uint64_t>(static_cast<int64_t>(residentBytes) + m_pendingBytes); };
+		if (getExpectedBytes() > m_budget)
+		{
+			Evict(getExpectedBytes() - m_budget);
+		}
+
+		for (const auto& entry : wanted)
+		{
+			if (m_loadsInFlight >= MAX_LOADS_IN_FLIGHT)
+			{
+				break;
+			}
+
+			// Eviction may have just queued a reload of the texture, and upgrades that do not
+			// fit wait for memory to be freed
+			auto pTexture = entry.second;
+			if (pTexture->m_loading)
+			{
+				continue;
+			}
+			uint32_t mip = pTexture->m_residentMip - entry.first;
+			if (getExpectedBytes() + GetMipBytes(*pTexture, mip, pTexture->m_residentMip) > m_budget)
+			{
+				continue;
+			}
+			SubmitReload(pTexture, mip);
+		}
+	}
+
+	uint64_t TextureStreamer::GetResidentBytes() const
+	{
+		uint64_t bytes = 0;
+		for (const auto& entry : m_textures)
+		{
+			bytes += GetTextureBytes(*entry.second);
+		}
+		return bytes;
+	}
+
+	// Drops the top mip of the least recently drawn textures that still have more than their mip tail
+	void TextureStreamer::Evict(uint64_t excessBytes)
+	{
+		std::vector<EvictionCandidate> candidates;
+		std::vector<std::shared_ptr<StreamingTexture>> textures;
+		for (const auto& entry : m_textures)
+		{
+			const auto& texture = *entry.second;
+			if (texture.m_loading || texture.m_mips.empty())
+			{
+				continue;
+			}
+			if (texture.m_residentMip < GetTailMip(texture))
+			{
+				candidates.push_back({ texture.m_lastDrawnFrame, texture.m_mips[texture.m_residentMip].slicePitch });
+				textures.push_back(entry.second);
+			}
+		}
+
+		for (size_t i : SelectEvictions(candidates, excessBytes))
+		{
+			if (m_loadsInFlight >= MAX_LOADS_IN_FLIGHT)
+			{
+				break;
+			}
+			SubmitReload(textures[i], textures[i]->m_residentMip + 1);
+			m_evictionCount++;
+		}
+	}
+
+	// Loads mip and every smaller one on the worker, to replace the texture's view in a later Update
+	void TextureStreamer::SubmitReload(const std::shared_ptr<StreamingTexture>& pTexture, uint32_t mip)
+	{
+		int64_t delta = static_cast<int64_t>(GetMipBytes(*pTexture, mip, static_cast<uint32_t>(pTexture->m_mips.size()))) -
+			static_cast<int64_t>(GetTextureBytes(*pTexture));
+		pTexture->m_loading = true;
+		m_pendingBytes += delta;
+		m_loadsInFlight++;
+		m_pool.Submit([this, pTexture, mip, delta]()
+			{
+				Reload reload{ pTexture, mip, delta, nullptr };
+				try
+				{
+					reload.pView = LoadMips(*pTexture, mip);
+				}
+				catch (const winrt::hresult_error&)
+				{
+					std::cerr << "Failed to create streamed mips of " << pTexture->m_filename << "\n";
+				}
+				catch (const std::exception& e)
+				{
+					std::cerr << e.what() << "\n";
+				}
+
+				std::lock_guard lock(m_mutex);
+				m_finished.push_back(std::move(reload));
+			});
+	}
+
+	// Mip loaded first, and the least detailed an evicted texture falls back to
+	uint32_t TextureStreamer::GetTailMip(const StreamingTexture& texture)
+	{
+		return std::max(texture.m_firstMip, GetRequiredMip(texture.m_width, texture.m_height,
+			static_cast<uint32_t>(texture.m_mips.size()), MIP_TAIL_SIZE));
+	}
+
+	uint64_t TextureStreamer::GetMipBytes(const StreamingTexture& texture, uint32_t firstMip, uint32_t endMip)
+	{
+		uint64_t bytes = 0;
+		for (uint32_t mip = firstMip; mip < endMip; mip++)
+		{
+			bytes += texture.m_mips[mip].slicePitch;
+		}
+		return bytes;
+	}
+
+	uint64_t TextureStreamer::GetTextureBytes(const StreamingTexture& texture)
+	{
+		if (texture.m_mips.empty())
+		{
+			return texture.m_unstreamedBytes;
+		}
+		return GetMipBytes(texture, texture.m_residentMip, static_cast<uint32_t>(texture.m_mips.size()));
+	}
+
+	bool TextureStreamer::ReadLayout(StreamingTexture* pTexture)
+	{
+		DirectX::TexMetadata metadata{};
+		bool streamable = false;
+		bool mapped = (m_mode == TextureReadMode::eMemoryMapped);
+		if (!mapped)
+		{
+			std::ifstream ifs(pTexture->m_filename, std::ios::binary);
+			if (!ifs)
+			{
+				return false;
+			}
+			std::array<uint8_t, DDS_DX10_HEADER_SIZE> header{};
+			ifs.read(reinterpret_cast<char*>(header.data()), header.size());
+			const size_t headerSize = static_cast<size_t>(ifs.gcount());
+			mapped = IsContainer(header.data(), headerSize);
+			if (!mapped)
+			{
+				streamable = ParseStreamableLayout(header.data(), headerSize,
+					std::filesystem::file_size(pTexture->m_filename), &metadata, &pTexture->m_mips);
+			}
+		}
+
+		if (mapped)
+		{
+			// Only the header pages are touched here
+			auto pFile = m_files.Open(pTexture->m_filename);
+			streamable = ParseStreamableFile(pFile->GetData(), pFile->GetSize(), &metadata, &pTexture->m_mips,
+				&pTexture->m_chunks);
+		}
+
+		if (!streamable)
+		{
+			return false;
+		}
+		pTexture->m_format = metadata.format;
+		pTexture->m_width = static_cast<uint32_t>(metadata.width);
+		pTexture->m_height = static_cast<uint32_t>(metadata.height);
+		return true;
+	}
+
+	// Loads every mip at once, for textures that cannot be streamed. Leaves the view null on failure.
+	void TextureStreamer::LoadWhole(StreamingTexture* pTexture)
+	{
+		// The loader points the initial data into the memory it is given, so a mapped file is
+		// never copied
+		std::shared_ptr<const MappedFile> pFile;
+		std::vector<uint8_t> data;
+		try
+		{
+			if (m_mode == TextureReadMode::eMemoryMapped || !pTexture->m_chunks.empty())
+			{
+				pFile = m_files.Open(pTexture->m_filename);
+			}
+			else
+			{
+				std::ifstream ifs(pTexture->m_filename, std::ios::binary);
+				data.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+			}
+
+			// Containers are expanded back into a whole DDS file
+			if (pFile && IsContainer(pFile->GetData(), pFile->GetSize()))
+			{
+				std::vector<ContainerChunk> chunks;
+				const uint32_t ddsHeaderSize = ReadContainer(pFile->GetData(), pFile->GetSize(), &chunks);
+				data.resize(static_cast<size_t>(GetUncompressedSize(ddsHeaderSize, chunks)));
+				memcpy(data.data(), pFile->GetData() + sizeof(ContainerHeader), ddsHeaderSize);
+				DecompressChunks(*pFile, chunks, ddsHeaderSize, data.size(), data.data() + ddsHeaderSize);
+				pFile = nullptr;
+			}
+		}
+		catch (const winrt::hresult_error&)
+		{
+			return;
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << e.what() << "\n";
+			return;
+		}
+
+		const uint8_t* pData = pFile ? pFile->GetData() : data.data();
+		const size_t size = pFile ? pFile->GetSize() : data.size();
+		if (size > 0)
+		{
+			pTexture->m_pView = CreateTextureFromDDSMemory(m_pDevice.get(), pData, size, m_skipMips, m_maxDimension);
+		}
+	}
+
+	// Decompresses the chunks covering [begin, end) of the uncompressed file into pDst, which
+	// receives the byte at begin. Returns the compressed bytes read.
+	uint64_t TextureStreamer::DecompressChunks(const MappedFile& file, const std::vector<ContainerChunk>& chunks,
+		uint64_t begin, uint64_t end, uint8_t* pDst)
+	{
+		std::vector<std::future<void>> jobs;
+		uint64_t compressedBytes = 0;
+		uint64_t coveredBytes = 0;
+		for (const auto& chunk : chunks)
+		{
+			if (chunk.dataOffset >= begin && chunk.dataOffset + chunk.size <= end)
+			{
+				const uint8_t* pSrc = file.GetData() + chunk.fileOffset;
+				uint8_t* pChunkDst = pDst + (chunk.dataOffset - begin);
+				jobs.push_back(m_decompressPool.Submit([pSrc, chunk, pChunkDst]() { DecompressChunk(pSrc, chunk, pChunkDst); }));
+				compressedBytes += chunk.compressedSize;
+				coveredBytes += chunk.size;
+			}
+		}
+
+		// Every job must be done with the buffers before any error is thrown
+		for (auto& job : jobs)
+		{
+			job.wait();
+		}
+		for (auto& job : jobs)
+		{
+			job.get();
+		}
+		if (coveredBytes != end - begin)
+		{
+			throw std::runtime_error("Compressed texture chunks do not line up with its mips");
+		}
+		return compressedBytes;
+	}
+
+	// Creates an immutable texture holding firstMip and every smaller mip. Runs on any thread.
+	com_ptr<ID3D11ShaderResourceView> TextureStreamer::LoadMips(const StreamingTexture& texture, uint32_t firstMip)
+	{
+		const auto& first = texture.m_mips[firstMip];
+		const auto& last = texture.m_mips.back();
+		const uint64_t size = last.offset + last.slicePitch - first.offset;
+
+		// Either the mapping or the buffer must outlive CreateTexture2D
+		std::shared_ptr<const MappedFile> pFile;
+		std::vector<uint8_t> data;
+		const uint8_t* pFirst = nullptr;
+		if (!texture.m_chunks.empty())
+		{
+			pFile = m_files.Open(texture.m_filename);
+			data.resize(static_cast<size_t>(size));
+			m_bytesRead += DecompressChunks(*pFile, texture.m_chunks, first.offset, first.offset + size, data.data());
+			pFirst = data.data();
+		}
+		else if (m_mode == TextureReadMode::eMemoryMapped)
+		{
+			pFile = m_files.Open(texture.m_filename);
+			if (pFile->GetSize() < first.offset + size)
+			{
+				throw std::runtime_error("Failed to read mips of " + texture.m_filename);
+			}
+			pFirst = pFile->GetData() + first.offset;
+			m_bytesRead += size;
+		}
+		else
+		{
+			data.resize(static_cast<size_t>(size));
+			std::ifstream ifs(texture.m_filename, std::ios::binary);
+			ifs.seekg(first.offset);
+			ifs.read(reinterpret_cast<char*>(data.data()), data.size());
+			if (!ifs)
+			{
+				throw std::runtime_error("Failed to read mips of " + texture.m_filename);
+			}
+			pFirst = data.data();
+			m_bytesRead += size;
+		}
+
+		std::vector<D3D11_SUBRESOURCE_DATA> initialData;
+		for (size_t mip = firstMip; mip < texture.m_mips.size(); mip++)
+		{
+			const auto& layout = texture.m_mips[mip];
+			initialData.push_back({ pFirst + (layout.offset - first.offset),
+				static_cast<unsigned int>(layout.rowPitch), static_cast<unsigned int>(layout.slicePitch) });
+		}
+
+		D3D11_TEXTURE2D_DESC desc{};
+		desc.Width = std::max(1u, texture.m_width >> firstMip);
+		desc.Height = std::max(1u, texture.m_height >> firstMip);
+		desc.MipLevels = static_cast<unsigned int>(initialData.size());
+		desc.ArraySize = 1;
+		desc.Format = texture.m_format;
+		desc.SampleDesc.Count = 1;
+		desc.Usage = D3D11_USAGE_IMMUTABLE;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+		com_ptr<ID3D11Texture2D> pTexture;
+		check_hresult(m_pDevice->CreateTexture2D(&desc, initialData.data(), pTexture.put()));
+		com_ptr<ID3D11ShaderResourceView> pView;
+		check_hresult(m_pDevice->CreateShaderResourceView(pTexture.get(), nullptr, pView.put()));
+		return pView;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "TaskPool.h"
+#include "MappedFile.h"
+#include "TextureContainer.h"
+
+namespace dx
+{
+	// Where one mip of a texture's pixel data is stored in its DDS file
+	struct MipLayout
+	{
+		uint64_t offset;
+		size_t rowPitch;
+		size_t slicePitch;
+	};
+
+	// Mip layout of a single 2D image whose pixel data starts at dataOffset, with each mip
+	// following the previous one. Returns false if the format has no defined pitch.
+	bool GetMipLayout(DXGI_FORMAT format, size_t width, size_t height, size_t mipLevels, uint64_t dataOffset,
+		std::vector<MipLayout>* pMips);
+
+	// Parses the header of a DDS file without touching the device. pHeader holds at least the
+	// legacy header, and the DX10 extension if there is one, and fileSize tells which, since
+	// the pixel data must fill the rest of the file. Streaming is limited to single 2D images
+	// with mips, stored as is after the header. Returns false for anything else.
+	bool ParseStreamableLayout(const uint8_t* pHeader, size_t headerSize, uint64_t fileSize,
+		DirectX::TexMetadata* pMetadata, std::vector<MipLayout>* pMips);
+
+	// Like ParseStreamableLayout for a whole DDS file or compressed container in memory. Mip
+	// offsets of a container are into the DDS file it holds, and its chunk table is returned.
+	// Throws if a container is damaged.
+	bool ParseStreamableFile(const uint8_t* pData, size_t size, DirectX::TexMetadata* pMetadata,
+		std::vector<MipLayout>* pMips, std::vector<ContainerChunk>* pChunks);
+
+	// The most detailed mip worth loading for a texture drawn at requestedSize texels across.
+	// The mip is the smallest one still at least as large as the request.
+	uint32_t GetRequiredMip(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t requestedSize);
+
+	// The most detailed mip kept when dropping the top skipMips mips and every mip larger than
+	// maxDimension across, where zero means no limit. The smallest mip is always kept.
+	uint32_t GetFirstLoadedMip(uint32_t width, uint32_t height, uint32_t mipCount, uint32_t skipMips,
+		uint32_t maxDimension);
+
+	// The maxsize argument that makes DDSTextureLoader drop the mips left out by skipMips and
+	// maxDimension. Zero, meaning no limit to the loader, if every mip is kept.
+	size_t GetLoaderMaxSize(const DirectX::TexMetadata& metadata, uint32_t skipMips, uint32_t maxDimension);
+
+	// Creates a texture from a whole DDS file in memory, leaving out the mips dropped by skipMips
+	// and maxDimension. Their pixels are never read, so a mapped file never faults them in.
+	// Returns null if the texture could not be created.
+	winrt::com_ptr<ID3D11ShaderResourceView> CreateTextureFromDDSMemory(ID3D11Device* pDevice, const uint8_t* pData,
+		size_t size, uint32_t skipMips = 0, uint32_t maxDimension = 0);
+
+	// Texels across needed to draw a mesh at about one texel per pixel. Uses the point of the
+	// bounding sphere nearest the eye, and the mesh's texture coordinate density in UV units per
+	// world unit. Returns zero for meshes without texture coordinates.
+	uint32_t GetRequiredTextureSize(DirectX::FXMVECTOR eye, const DirectX::BoundingSphere& bounds,
+		float texcoordDensity, float fov, float viewportHeight);
+
+	// A streamed texture that could give up memory by dropping its most detailed resident mip
+	struct EvictionCandidate
+	{
+		uint64_t lastDrawnFrame;
+		uint64_t topMipBytes;
+	};
+
+	// Picks candidates to drop their top mip until at least excessBytes are freed. The least
+	// recently drawn go first, and the largest among those drawn in the same frame. Returns
+	// candidate indices in eviction order, which cover less than excessBytes if all of them do.
+	std::vector<size_t> SelectEvictions(const std::vector<EvictionCandidate>& candidates, uint64_t excessBytes);
+
+	// How texture files are read
+	enum class TextureReadMode
+	{
+		// Mips are read into a heap buffer which is then uploaded
+		eRead,
+		// Files are memory mapped and the device reads the pixels straight from the mapping.
+		// Compressed containers are always mapped and decompressed from the mapping.
+		eMemoryMapped
+	};
+
+	// A texture whose mips are loaded progressively by a TextureStreamer. It starts with the
+	// low resolution mip tail, and more detailed mips replace the view as they arrive.
+	class StreamingTexture
+	{
+	public:
+		// The most detailed version loaded so far. Only changes in TextureStreamer::Update.
+		ID3D11ShaderResourceView* GetView() const { return m_pView.get(); }
+
+		// Records that the texture is drawn needing this many texels across. Requests are
+		// collected over a frame and the largest one is used.
+		void RequestSize(uint32_t size) { m_requestedSize = std::max(m_requestedSize, size); }
+
+		// Most detailed mip currently loaded. Zero once fully streamed without mip limits, or if
+		// the texture could not be streamed and was loaded whole.
+		uint32_t GetResidentMip() const { return m_residentMip; }
+
+		// Records that the texture was drawn, for least recently used eviction. Render thread only.
+		void MarkDrawn() { m_drawn = true; }
+
+	private:
+		friend class TextureStreamer;
+
+		std::string m_filename;
+		DXGI_FORMAT m_format = DXGI_FORMAT_UNKNOWN;
+		uint32_t m_width = 0;
+		uint32_t m_height = 0;
+		std::vector<MipLayout> m_mips;		// Empty if the texture is not streamed
+		std::vector<ContainerChunk> m_chunks;	// Empty unless the file is a compressed container
+		winrt::com_ptr<ID3D11ShaderResourceView> m_pView;
+		uint32_t m_residentMip = 0;
+		uint32_t m_firstMip = 0;			// Most detailed mip allowed by the mip limits
+		uint32_t m_requestedSize = 0;
+		bool m_loading = false;
+		bool m_drawn = false;
+		uint64_t m_lastDrawnFrame = 0;
+		uint64_t m_unstreamedBytes = 0;		// Size of a texture loaded whole
+	};
+
+	// Streams texture mips from DDS files on a worker thread. Loading reads only the mip tail,
+	// starting from the smallest mip at least MIP_TAIL_SIZE across. Each frame, textures drawn larger than their resident mips are
+	// queued, and a worker reads the missing mips and creates a new immutable texture with the
+	// whole remaining chain. The immediate context is never used, so nothing stalls the render
+	// thread, which swaps the new view in on a later frame.
+	//
+	// Streamed mips are kept within a memory budget. Upgrades are only queued while they fit,
+	// and when the textures outgrow the budget, eg. after it was lowered or as textures that
+	// cannot be streamed are loaded, the least recently drawn textures are reloaded without their
+	// top mip. Evicted textures never drop below their mip tail.
+	//
+	// Files may also be compressed containers, described in TextureContainer.h. The chunks of
+	// the requested mips are decompressed in parallel straight into the initial data of the
+	// new texture, and only their compressed bytes are read.
+	//
+	// Memory mapped files are kept in a small cache, so streaming further mips of a recently
+	// used texture does not map its file again.
+	class TextureStreamer
+	{
+	public:
+		explicit TextureStreamer(ID3D11Device* pDevice, TextureReadMode mode = TextureReadMode::eMemoryMapped);
+
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		// Loads the mip tail, or the whole texture if it is not a single 2D image with mips.
+		// Textures are shared by filename. The view is null if the file could not be loaded.
+		std::shared_ptr<StreamingTexture> Load(const std::string& filename);
+
+		// Loads many textures at once, reading, parsing and creating them in parallel on
+		// threadCount workers, or one per hardware thread if zero. Returns a texture for each
+		// filename in order. Repeated and already loaded filenames share one texture.
+		std::vector<std::shared_ptr<StreamingTexture>> LoadBatch(const std::vector<std::string>& filenames,
+			unsigned int threadCount = 0);
+
+		// Called once per frame on the render thread after sizes have been requested. Swaps in
+		// finished loads and queues the textures furthest from their requested size.
+		void Update();
+
+		// Drops the top skipMips mips, and mips larger than maxDimension across, from textures
+		// loaded afterwards. Dropped mips are never read. Zero means no limit for both.
+		void SetMipLimits(uint32_t skipMips, uint32_t maxDimension)
+		{
+			m_skipMips = skipMips;
+			m_maxDimension = maxDimension;
+		}
+
+		// Limits the video memory used by textures. Unlimited by default.
+		void SetBudget(uint64_t bytes) { m_budget = bytes; }
+
+		// Video memory used by the resident mips of every texture
+		uint64_t GetResidentBytes() const;
+		uint64_t GetBudget() const { return m_budget; }
+		uint64_t GetEvictionCount() const { return m_evictionCount; }
+
+		// Bytes of texture data read so far, including mip tails and textures loaded whole.
+		// Mapped pixels count as read once they have been handed to the device.
+		uint64_t GetBytesRead() const { return m_bytesRead; }
+
+	private:
+		static constexpr uint32_t MIP_TAIL_SIZE = 128;
+		static constexpr size_t MAX_LOADS_IN_FLIGHT = 4;
+
+		// Replaces a texture's view with one starting at a more or less detailed mip
+		struct Reload
+		{
+			std::shared_ptr<StreamingTexture> pTexture;
+			uint32_t mip;
+			int64_t deltaBytes;
+			winrt::com_ptr<ID3D11ShaderResourceView> pView;
+		};
+
+		winrt::com_ptr<ID3D11Device> m_pDevice;
+		TextureReadMode m_mode;
+		MappedFileCache m_files;
+		std::unordered_map<std::string, std::shared_ptr<StreamingTexture>> m_textures;
+		size_t m_loadsInFlight;
+		int64_t m_pendingBytes;		// Change in resident bytes once the loads in flight finish
+		uint64_t m_budget;
+		uint32_t m_skipMips;
+		uint32_t m_maxDimension;
+		uint64_t m_frame;
+		uint64_t m_evictionCount;
+		std::atomic<uint64_t> m_bytesRead;
+
+		std::mutex m_mutex;
+		std::vector<Reload> m_finished;
+
+		// Declared last so that loads finish before anything they use is destroyed, with
+		// decompression outliving the loads waiting on it
+		TaskPool m_decompressPool;
+		TaskPool m_pool;
+
+		std::shared_ptr<StreamingTexture> CreateTexture(const std::string& filename);
+		bool ReadLayout(StreamingTexture* pTexture);
+		void LoadWhole(StreamingTexture* pTexture);
+		uint64_t DecompressChunks(const MappedFile& file, const std::vector<ContainerChunk>& chunks, uint64_t begin,
+			uint64_t end, uint8_t* pDst);
+		void Evict(uint64_t excessBytes);
+		void SubmitReload(const std::shared_ptr<StreamingTexture>& pTexture, uint32_t mip);
+		static uint32_t GetTailMip(const StreamingTexture& texture);
+		static uint64_t GetMipBytes(const StreamingTexture& texture, uint32_t firstMip, uint32_t endMip);
+		static uint64_t GetTextureBytes(const StreamingTexture& texture);
+		winrt::com_ptr<ID3D11ShaderResourceView> LoadMips(const StreamingTexture& texture, uint32_t firstMip);
+	};
+}
\ No newline at end of file
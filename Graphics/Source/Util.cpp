@@ -85,4 +85,28 @@ namespace dx
     {
         pContext->CSSetShader(pShader, nullptr, 0);
     }
+
+    size_t GetTextureSize(ID3D11ShaderResourceView* pView)
+    {
+        winrt::com_ptr<ID3D11Resource> pResource;
+        pView->GetResource(pResource.put());
+        auto pTexture = pResource.try_as<ID3D11Texture2D>();
+        if (!pTexture)
+        {
+            return 0;
+        }
+
+        D3D11_TEXTURE2D_DESC desc{};
+        pTexture->GetDesc(&desc);
+        size_t bytes = 0;
+        for (unsigned int mip = 0; mip < desc.MipLevels; mip++)
+        {
+            size_t rowPitch = 0;
+            size_t slicePitch = 0;
+            DirectX::ComputePitch(desc.Format, std::max(1u, desc.Width >> mip), std::max(1u, desc.Height >> mip),
+                rowPitch, slicePitch);
+            bytes += slicePitch;
+        }
+        return bytes * desc.ArraySize;
+    }
 }
\ No newline at end of file
@@ -138,18 +138,92 @@ namespace dx
         return static_cast<Type>(a) != 0;
     }
 
-    // Converts a POD struct into a string
+    // 64-bit FNV-1a hash of a byte range. Pass a previous result as the seed to hash
+    // several ranges in sequence.
+    constexpr uint64_t HASH_SEED = 14695981039346656037ull;
+
+    inline uint64_t HashBytes(const void* pData, size_t size, uint64_t seed = HASH_SEED)
+    {
+        const auto* pBytes = static_cast<const unsigned char*>(pData);
+        uint64_t hash = seed;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= pBytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Same result as HashBytes over the characters, and usable at compile time
+    constexpr uint64_t HashString(std::string_view str, uint64_t seed = HASH_SEED)
+    {
+        uint64_t hash = seed;
+        for (char c : str)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Hash and bytewise equality of POD structs such as D3D11 descriptions, for use as hash map
+    // keys. Padding takes part in both, so descriptions must be zero initialized.
+    template<typename T>
+    uint64_t HashPod(const T& s)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "HashPod requires a POD type");
+        return HashBytes(&s, sizeof(T));
+    }
+
+    template<typename T>
+    struct PodHash
+    {
+        size_t operator()(const T& s) const
+        {
+            return static_cast<size_t>(HashPod(s));
+        }
+    };
+
     template<typename T>
-    std::string CreateKey(const T& s)
+    struct PodEqual
     {
-        std::array<unsigned char, sizeof(T)> arr{};
-        memcpy(arr.data(), &s, sizeof(T));
-        std::stringstream ss;
-        for (const auto& val : arr)
+        bool operator()(const T& a, const T& b) const
         {
-            ss << val;
+            return memcmp(&a, &b, sizeof(T)) == 0;
+        }
+    };
+
+    namespace detail
+    {
+        // Converts to any field type, for probing how many initializers an aggregate accepts
+        struct AnyField
+        {
+            template<typename T>
+            constexpr operator T() const noexcept
+            {
+                return T{};
+            }
+        };
+
+        template<typename T, typename... Fields>
+        constexpr size_t CountFields(long)
+        {
+            return sizeof...(Fields);
+        }
+
+        template<typename T, typename... Fields>
+        constexpr auto CountFields(int) -> decltype(T{ Fields{}..., AnyField{} }, size_t())
+        {
+            return CountFields<T, Fields..., AnyField>(0);
         }
-        return ss.str();
+    }
+
+    // Number of fields in an aggregate without base classes, eg. a struct of option bits
+    template<typename T>
+    constexpr size_t CountFields()
+    {
+        static_assert(std::is_aggregate_v<T>, "CountFields requires an aggregate");
+        return detail::CountFields<T>(0);
     }
 
     // String conversion functions, assuming std::string uses UTF-8
@@ -304,6 +378,9 @@ namespace dx
     void SetPS(ID3D11DeviceContext* pContext, ID3D11PixelShader* pShader);
     void SetCS(ID3D11DeviceContext* pContext, ID3D11ComputeShader* pShader);
 
+    // Approximate video memory used by a 2D texture and all its mips. Zero for other resources.
+    size_t GetTextureSize(ID3D11ShaderResourceView* pView);
+
     // Sets or clears all 8 render targets. pDSV can be null if there is no depth target.
     template<typename... Args>
     void BindRenderTargets(ID3D11DeviceContext* pContext, ID3D11DepthStencilView* pDSV, const Args&... args)
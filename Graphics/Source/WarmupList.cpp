@@ -0,0 +1,285 @@
+#include "stdafx.h"
+
+#include "WarmupList.h"
+
+namespace
+{
+	using namespace dx;
+
+	constexpr uint32_t WARMUP_MAGIC = 0x55575844;	// "DXWU"
+	constexpr uint32_t WARMUP_VERSION = 2;
+
+	void WriteString(std::string& out, const std::string& str)
+	{
+		uint16_t size = static_cast<uint16_t>(str.size());
+		out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+		out.append(str);
+	}
+
+	// Bounds checked reads from a loaded file
+	class Reader
+	{
+	public:
+		explicit Reader(const std::string& data) :
+			m_data(data),
+			m_offset(0)
+		{
+		}
+
+		template<typename T>
+		bool Read(T* pValue)
+		{
+			if (m_offset + sizeof(T) > m_data.size())
+			{
+				return false;
+			}
+			memcpy(pValue, m_data.data() + m_offset, sizeof(T));
+			m_offset += sizeof(T);
+			return true;
+		}
+
+		bool ReadBytes(size_t size, std::string* pBytes)
+		{
+			if (m_offset + size > m_data.size())
+			{
+				return false;
+			}
+			pBytes->assign(m_data, m_offset, size);
+			m_offset += size;
+			return true;
+		}
+
+		bool ReadString(std::string* pStr)
+		{
+			uint16_t size = 0;
+			return Read(&size) && ReadBytes(size, pStr);
+		}
+
+		size_t GetOffset() const
+		{
+			return m_offset;
+		}
+
+	private:
+		const std::string& m_data;
+		size_t m_offset;
+	};
+
+	size_t GetDescSize(WarmupList::EntryType type)
+	{
+		switch (type)
+		{
+		case WarmupList::EntryType::eSamplerState:
+			return sizeof(D3D11_SAMPLER_DESC);
+		case WarmupList::EntryType::eRasterizerState:
+			return sizeof(D3D11_RASTERIZER_DESC);
+		case WarmupList::EntryType::eDepthStencilState:
+			return sizeof(D3D11_DEPTH_STENCIL_DESC);
+		case WarmupList::EntryType::eBlendState:
+			return sizeof(D3D11_BLEND_DESC);
+		default:
+			return 0;
+		}
+	}
+
+	// Reads one record, returning its serialized form and the decoded entry
+	bool ReadRecord(Reader& reader, const std::string& data, std::string* pRecord, WarmupList::Entry* pEntry)
+	{
+		size_t start = reader.GetOffset();
+
+		uint8_t type = 0;
+		if (!reader.Read(&type) || type > static_cast<uint8_t>(WarmupList::EntryType::ePipelineState))
+		{
+			return false;
+		}
+		pEntry->type = static_cast<WarmupList::EntryType>(type);
+
+		if (pEntry->type == WarmupList::EntryType::eShader)
+		{
+			uint8_t stage = 0;
+			uint8_t defineCount = 0;
+			if (!reader.Read(&stage) || (stage > static_cast<uint8_t>(ShaderStage::eCompute)) ||
+				!reader.ReadString(&pEntry->path) || !reader.Read(&defineCount))
+			{
+				return false;
+			}
+			pEntry->stage = static_cast<ShaderStage>(stage);
+			pEntry->defines.resize(defineCount);
+			for (auto& [name, value] : pEntry->defines)
+			{
+				if (!reader.ReadString(&name) || !reader.ReadString(&value))
+				{
+					return false;
+				}
+			}
+		}
+		else if (pEntry->type == WarmupList::EntryType::ePipelineState)
+		{
+			if (!reader.Read(&pEntry->pipeline))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			std::string desc;
+			if (!reader.ReadBytes(GetDescSize(pEntry->type), &desc))
+			{
+				return false;
+			}
+			pEntry->desc.assign(desc.begin(), desc.end());
+		}
+
+		pRecord->assign(data, start, reader.GetOffset() - start);
+		return true;
+	}
+
+	// Whether a pipeline state's reference is to an earlier entry of the given type, or is empty
+	// where that is allowed
+	bool IsValidReference(const std::vector<WarmupList::Entry>& entries, uint32_t index,
+		WarmupList::EntryType type, bool optional)
+	{
+		if (index == WarmupList::NO_ENTRY)
+		{
+			return optional;
+		}
+		return (index < entries.size()) && (entries[index].type == type);
+	}
+
+	bool IsValidPipelineState(const std::vector<WarmupList::Entry>& entries,
+		const WarmupList::PipelineStateEntry& pipeline)
+	{
+		using EntryType = WarmupList::EntryType;
+		return IsValidReference(entries, pipeline.vs, EntryType::eShader, false) &&
+			(entries[pipeline.vs].stage == ShaderStage::eVertex) &&
+			IsValidReference(entries, pipeline.ps, EntryType::eShader, true) &&
+			((pipeline.ps == WarmupList::NO_ENTRY) || (entries[pipeline.ps].stage == ShaderStage::ePixel)) &&
+			IsValidReference(entries, pipeline.rasterizerState, EntryType::eRasterizerState, true) &&
+			IsValidReference(entries, pipeline.blendState, EntryType::eBlendState, true) &&
+			IsValidReference(entries, pipeline.depthStencilState, EntryType::eDepthStencilState, true);
+	}
+}
+
+namespace dx
+{
+	uint32_t WarmupList::AddShader(ShaderStage stage, const std::string& path,
+		const std::vector<std::pair<std::string, std::string>>& defines)
+	{
+		std::string record(1, static_cast<char>(EntryType::eShader));
+		record.push_back(static_cast<char>(stage));
+		WriteString(record, path);
+		record.push_back(static_cast<char>(defines.size()));
+		for (const auto& [name, value] : defines)
+		{
+			WriteString(record, name);
+			WriteString(record, value);
+		}
+		return AddRecord(std::move(record));
+	}
+
+	uint32_t WarmupList::AddPipelineState(const PipelineStateEntry& pipeline)
+	{
+		std::string record(1, static_cast<char>(EntryType::ePipelineState));
+		record.append(reinterpret_cast<const char*>(&pipeline), sizeof(pipeline));
+		return AddRecord(std::move(record));
+	}
+
+	uint32_t WarmupList::AddRecord(std::string record)
+	{
+		std::lock_guard lock(m_mutex);
+		auto [it, inserted] = m_recorded.try_emplace(record, static_cast<uint32_t>(m_records.size()));
+		if (inserted)
+		{
+			m_records.push_back(std::move(record));
+		}
+		return it->second;
+	}
+
+	bool WarmupList::Load(const std::filesystem::path& path)
+	{
+		std::lock_guard lock(m_mutex);
+		m_records.clear();
+		m_recorded.clear();
+
+		std::ifstream ifs(path, std::ios::binary);
+		if (!ifs)
+		{
+			return false;
+		}
+		const std::string data(std::istreambuf_iterator<char>(ifs), {});
+
+		Reader reader(data);
+		uint32_t magic = 0;
+		uint32_t version = 0;
+		uint32_t count = 0;
+		if (!reader.Read(&magic) || !reader.Read(&version) || !reader.Read(&count) ||
+			(magic != WARMUP_MAGIC) || (version != WARMUP_VERSION))
+		{
+			return false;
+		}
+
+		std::vector<std::string> records;
+		std::vector<Entry> entries;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			std::string record;
+			Entry entry{};
+			if (!ReadRecord(reader, data, &record, &entry) ||
+				((entry.type == EntryType::ePipelineState) && !IsValidPipelineState(entries, entry.pipeline)))
+			{
+				return false;
+			}
+			records.push_back(std::move(record));
+			entries.push_back(std::move(entry));
+		}
+
+		m_records = std::move(records);
+		for (uint32_t i = 0; i < m_records.size(); i++)
+		{
+			m_recorded.try_emplace(m_records[i], i);
+		}
+		return true;
+	}
+
+	void WarmupList::Save(const std::filesystem::path& path) const
+	{
+		std::lock_guard lock(m_mutex);
+
+		std::ofstream ofs(path, std::ios::binary);
+		if (!ofs)
+		{
+			throw std::runtime_error("Failed to open warm-up list " + path.string());
+		}
+
+		uint32_t count = static_cast<uint32_t>(m_records.size());
+		ofs.write(reinterpret_cast<const char*>(&WARMUP_MAGIC), sizeof(WARMUP_MAGIC));
+		ofs.write(reinterpret_cast<const char*>(&WARMUP_VERSION), sizeof(WARMUP_VERSION));
+		ofs.write(reinterpret_cast<const char*>(&count), sizeof(count));
+		for (const auto& record : m_records)
+		{
+			ofs.write(record.data(), record.size());
+		}
+	}
+
+	std::vector<WarmupList::Entry> WarmupList::GetEntries() const
+	{
+		std::lock_guard lock(m_mutex);
+
+		std::vector<Entry> entries;
+		for (const auto& record : m_records)
+		{
+			Reader reader(record);
+			std::string unused;
+			Entry entry{};
+			ReadRecord(reader, record, &unused, &entry);
+			entries.push_back(std::move(entry));
+		}
+		return entries;
+	}
+
+	size_t WarmupList::GetEntryCount() const
+	{
+		std::lock_guard lock(m_mutex);
+		return m_records.size();
+	}
+}
\ No newline at end of file
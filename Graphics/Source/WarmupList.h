@@ -0,0 +1,105 @@
+#pragma once
+
+#include "ShaderCache.h"
+
+namespace dx
+{
+	// The shaders and pipeline states requested during a session, saved so the next launch can
+	// create them all up front rather than on first use. Duplicates are recorded once.
+	//
+	// File layout: magic "DXWU" | version | entry count | entries, where an entry is a type byte
+	// followed by a shader request (stage, path, defines), the raw state description, or the
+	// indices of the earlier entries a pipeline state is made of.
+	class WarmupList
+	{
+	public:
+		enum class EntryType : uint8_t
+		{
+			eShader,
+			eSamplerState,
+			eRasterizerState,
+			eDepthStencilState,
+			eBlendState,
+			ePipelineState
+		};
+
+		// Marks a pipeline state without a pixel shader or one of its states
+		static constexpr uint32_t NO_ENTRY = ~0u;
+
+		struct PipelineStateEntry
+		{
+			uint32_t vs;
+			uint32_t ps;
+			uint32_t rasterizerState;
+			uint32_t blendState;
+			uint32_t depthStencilState;
+			uint32_t stencilRef;
+			uint32_t topology;
+		};
+
+		struct Entry
+		{
+			EntryType type;
+
+			// Shader requests
+			ShaderStage stage;
+			std::string path;
+			std::vector<std::pair<std::string, std::string>> defines;
+
+			// State descriptions
+			std::vector<uint8_t> desc;
+
+			// Pipeline states
+			PipelineStateEntry pipeline;
+
+			template<typename Desc>
+			bool GetDesc(Desc* pDesc) const
+			{
+				if (desc.size() != sizeof(Desc))
+				{
+					return false;
+				}
+				memcpy(pDesc, desc.data(), sizeof(Desc));
+				return true;
+			}
+		};
+
+		WarmupList() = default;
+
+		WarmupList(const WarmupList&) = delete;
+		WarmupList& operator=(const WarmupList&) = delete;
+
+		// Safe to call from any thread. Each returns the index of the entry, which pipeline
+		// states use to refer to the entries they are made of.
+		uint32_t AddShader(ShaderStage stage, const std::string& path,
+			const std::vector<std::pair<std::string, std::string>>& defines);
+
+		template<typename Desc>
+		uint32_t AddState(EntryType type, const Desc& desc)
+		{
+			std::string record(1, static_cast<char>(type));
+			record.append(reinterpret_cast<const char*>(&desc), sizeof(Desc));
+			return AddRecord(std::move(record));
+		}
+
+		uint32_t AddPipelineState(const PipelineStateEntry& pipeline);
+
+		// Replaces the contents with the list in a file. Returns false, leaving the list empty,
+		// if the file is missing or damaged, including a pipeline state referring to an entry
+		// that does not precede it or has the wrong type.
+		bool Load(const std::filesystem::path& path);
+		void Save(const std::filesystem::path& path) const;
+
+		std::vector<Entry> GetEntries() const;
+
+		size_t GetEntryCount() const;
+
+	private:
+		// Entries are kept serialized, which doubles as their identity for deduplication
+		std::vector<std::string> m_records;
+		std::unordered_map<std::string, uint32_t> m_recorded;
+		mutable std::mutex m_mutex;
+
+		uint32_t AddRecord(std::string record);
+	};
+}
\ No newline at end of file
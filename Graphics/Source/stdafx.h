@@ -6,11 +6,13 @@
 #include <Windows.h>
 #include <Unknwn.h>
 #include <winrt/base.h>
+#include <compressapi.h>
 
 // DirectX includes
 #include <d3d11_4.h>
 #include <d3dcompiler.h>
 #include <DirectXMath.h>
+#include <DirectXCollision.h>
 #include <dxgi1_6.h>
 #include <DirectXTex.h>
 
@@ -19,7 +21,14 @@
 
 // Standard library includes
 #include <string>
+#include <string_view>
 #include <vector>
+#include <array>
+#include <map>
+#include <list>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <functional>
 #include <algorithm>
 #include <type_traits>
@@ -29,6 +38,14 @@
 #include <cmath>
 #include <bitset>
 #include <variant>
+#include <optional>
 #include <locale>
 #include <codecvt>
-#include <sstream>
\ No newline at end of file
+#include <sstream>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <future>
+#include <condition_variable>
+#include <queue>
+#include <chrono>
\ No newline at end of file
@@ -0,0 +1,102 @@
+// Compiles every shader permutation the renderer can request into ShaderCache/shaders.pak,
+// so the application never has to invoke the compiler at runtime. Must be built with the same
+// configuration (debug/release and DX_SHADOW_* settings) as the application it is shipped with.
+
+#include "stdafx.h"
+
+#include "ShaderCache.h"
+#include "ShaderArchive.h"
+#include "PBREffect.h"
+#include "ShadowMapEffect.h"
+#include "RenderFromTextureEffect.h"
+#include "RenderPass.h"
+#include "ParallelFor.h"
+
+#include <atomic>
+#include <chrono>
+
+using namespace dx;
+
+namespace
+{
+	std::vector<ShaderPermutation> GetAllPermutations()
+	{
+		std::vector<ShaderPermutation> ret;
+		for (auto&& list : { PBREffect::GetPermutations(), ShadowMapEffect::GetPermutations(),
+			RenderFromTextureEffect::GetPermutations(), ShadowPass::GetPermutations() })
+		{
+			ret.insert(ret.end(), list.begin(), list.end());
+		}
+		return ret;
+	}
+
+	void PrintUsage()
+	{
+		std::cout << "Usage: ShaderCompiler [graphics project directory]\n";
+	}
+}
+
+int wmain(int argc, wchar_t** argv)
+{
+	if (argc > 2)
+	{
+		PrintUsage();
+		return 0;
+	}
+	// Shader paths and the cache are relative to the Graphics project
+	if (argc == 2)
+	{
+		std::filesystem::current_path(argv[1]);
+	}
+
+	const auto permutations = GetAllPermutations();
+	auto& archive = GetShaderArchive();
+	const size_t entriesBefore = archive.GetEntryCount();
+	const uint64_t sizeBefore = archive.GetFileSize();
+
+	std::atomic<size_t> failures = 0;
+	std::mutex outputMutex;
+	std::unordered_map<uint64_t, size_t> uniqueShaders;
+
+	auto start = std::chrono::steady_clock::now();
+	ParallelFor(permutations.size(), [&](size_t i)
+		{
+			const auto& permutation = permutations[i];
+			try
+			{
+				auto bytecode = CompileShader(permutation.path, permutation.defines, permutation.stage);
+				std::lock_guard lock(outputMutex);
+				uniqueShaders[bytecode.key] = bytecode.size;
+			}
+			catch (const std::exception& e)
+			{
+				std::lock_guard lock(outputMutex);
+				std::cerr << "Failed to compile " << permutation.path;
+				for (const auto& [name, value] : permutation.defines)
+				{
+					std::cerr << " " << name << "=" << value;
+				}
+				std::cerr << ": " << e.what() << "\n";
+				failures++;
+			}
+		});
+	archive.Commit();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	size_t bytecodeSize = 0;
+	for (const auto& [key, size] : uniqueShaders)
+	{
+		bytecodeSize += size;
+	}
+	std::cout << "\n" << permutations.size() << " permutations in " << elapsed.count() << " s\n";
+	std::cout << "Unique shaders: " << uniqueShaders.size() << ", " << bytecodeSize / 1024 << " KiB of bytecode\n";
+	std::cout << "Archive: " << archive.GetEntryCount() - entriesBefore << " new entries, "
+		<< (archive.GetFileSize() - sizeBefore) / 1024 << " KiB written, "
+		<< archive.GetFileSize() / 1024 << " KiB total\n";
+	if (failures > 0)
+	{
+		std::cerr << failures << " permutations failed\n";
+		return 1;
+	}
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "stdafx.h"
+
+#include "Test.h"
+#include "BindingLayout.h"
+
+using namespace dx;
+
+namespace
+{
+	SlotMask MakeMask(std::initializer_list<unsigned int> slots)
+	{
+		SlotMask mask;
+		for (unsigned int slot : slots)
+		{
+			mask.set(slot);
+		}
+		return mask;
+	}
+
+	bool RangesEqual(const std::vector<BindingRange>& actual, const std::vector<BindingRange>& expected)
+	{
+		return std::equal(actual.begin(), actual.end(), expected.begin(), expected.end(),
+			[](const BindingRange& a, const BindingRange& b) { return a.start == b.start && a.count == b.count; });
+	}
+}
+
+TEST(NoRangesForUnusedSlots)
+{
+	CHECK(GetBindingRanges(SlotMask(), SlotMask()).empty());
+	CHECK(GetBindingRanges(MakeMask({ 2, 3 }), MakeMask({ 2, 3 })).empty());
+}
+
+TEST(ContiguousSlotsShareRange)
+{
+	CHECK(RangesEqual(GetBindingRanges(MakeMask({ 0, 1, 2 }), SlotMask()), { { 0, 3 } }));
+}
+
+TEST(UnusedGapIsCovered)
+{
+	// Whatever is bound to slots 1 and 2 is never read, so one call is enough
+	CHECK(RangesEqual(GetBindingRanges(MakeMask({ 0, 3 }), SlotMask()), { { 0, 4 } }));
+}
+
+TEST(ExcludedSlotSplitsRange)
+{
+	CHECK(RangesEqual(GetBindingRanges(MakeMask({ 0, 3 }), MakeMask({ 1 })), { { 0, 1 }, { 3, 1 } }));
+	CHECK(RangesEqual(GetBindingRanges(MakeMask({ 0, 1, 2 }), MakeMask({ 1 })), { { 0, 1 }, { 2, 1 } }));
+}
+
+TEST(ExcludedSlotsOutsideRangesAreIgnored)
+{
+	CHECK(RangesEqual(GetBindingRanges(MakeMask({ 5, 6 }), MakeMask({ 0, 9 })), { { 5, 2 } }));
+}
+
+TEST(RangeReachesLastSlot)
+{
+	const unsigned int last = static_cast<unsigned int>(SlotMask().size()) - 1;
+	CHECK(RangesEqual(GetBindingRanges(MakeMask({ last - 1, last }), SlotMask()), { { last - 1, 2 } }));
+}
+
+TEST(ShaderBindingsByKind)
+{
+	// Arrays cover bindCount slots, and unordered access views are not tracked
+	const auto bindings = GetShaderBindings({
+		{ D3D_SIT_TEXTURE, 4, 3 },
+		{ D3D_SIT_STRUCTURED, 0, 1 },
+		{ D3D_SIT_CBUFFER, 1, 1 },
+		{ D3D_SIT_SAMPLER, 0, 2 },
+		{ D3D_SIT_UAV_RWTYPED, 2, 1 } });
+	CHECK(bindings.shaderResources == MakeMask({ 0, 4, 5, 6 }));
+	CHECK(bindings.constantBuffers == MakeMask({ 1 }));
+	CHECK(bindings.samplers == MakeMask({ 0, 1 }));
+}
+
+TEST(LayoutLeavesOutPassBindings)
+{
+	ShaderBindings bindings;
+	bindings.shaderResources = MakeMask({ 0, 1, 2, 8, 9 });
+	bindings.constantBuffers = MakeMask({ 0, 2 });
+	ShaderBindings excluded;
+	excluded.shaderResources = MakeMask({ 8, 9 });
+	excluded.constantBuffers = MakeMask({ 0 });
+
+	const BindingLayout layout(bindings, excluded);
+	CHECK(RangesEqual(layout.GetShaderResources(), { { 0, 3 } }));
+	CHECK(RangesEqual(layout.GetConstantBuffers(), { { 2, 1 } }));
+	CHECK(layout.GetSamplers().empty());
+}
\ No newline at end of file
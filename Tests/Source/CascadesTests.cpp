@@ -0,0 +1,77 @@
+#include "stdafx.h"
+
+#include "Test.h"
+#include "Cascades.h"
+
+using namespace dx;
+
+TEST(LogarithmicCascadeBoundaries)
+{
+	// Each cascade covers the same depth ratio
+	const auto boundaries = ComputeCascadeBoundaries<3>(1.0f, 1000.0f, 1.0f);
+	CHECK_NEAR(boundaries[0], 1.0f, 1e-4f);
+	CHECK_NEAR(boundaries[1], 10.0f, 1e-3f);
+	CHECK_NEAR(boundaries[2], 100.0f, 1e-2f);
+	CHECK_NEAR(boundaries[3], 1000.0f, 1e-1f);
+}
+
+TEST(UniformCascadeBoundaries)
+{
+	const auto boundaries = ComputeCascadeBoundaries<4>(2.0f, 10.0f, 0.0f);
+	CHECK_NEAR(boundaries[0], 2.0f, 1e-5f);
+	CHECK_NEAR(boundaries[1], 4.0f, 1e-5f);
+	CHECK_NEAR(boundaries[2], 6.0f, 1e-5f);
+	CHECK_NEAR(boundaries[3], 8.0f, 1e-5f);
+	CHECK_NEAR(boundaries[4], 10.0f, 1e-5f);
+}
+
+TEST(BlendedCascadeBoundaries)
+{
+	// Halfway between the logarithmic and uniform splits, and increasing
+	const auto log = ComputeCascadeBoundaries<3>(0.5f, 50.0f, 1.0f);
+	const auto uniform = ComputeCascadeBoundaries<3>(0.5f, 50.0f, 0.0f);
+	const auto blended = ComputeCascadeBoundaries<3>(0.5f, 50.0f, 0.5f);
+	for (size_t i = 0; i < blended.size(); i++)
+	{
+		CHECK_NEAR(blended[i], 0.5f * (log[i] + uniform[i]), 1e-4f);
+		if (i > 0)
+		{
+			CHECK(blended[i] > blended[i - 1]);
+		}
+	}
+}
+
+TEST(FitCascadesToReducedDepths)
+{
+	// The reduced range is padded by the margin on both sides
+	const auto fitted = FitCascadeBoundaries<2>(10.0f, 20.0f, 0.2f, 25.0f, 0.5f, 0.1f);
+	const auto expected = ComputeCascadeBoundaries<2>(9.0f, 22.0f, 0.5f);
+	for (size_t i = 0; i < fitted.size(); i++)
+	{
+		CHECK_NEAR(fitted[i], expected[i], 1e-4f);
+	}
+}
+
+TEST(FitCascadesClampsToClipRange)
+{
+	const auto fitted = FitCascadeBoundaries<2>(0.01f, 100.0f, 0.2f, 25.0f, 0.5f, 0.1f);
+	const auto expected = ComputeCascadeBoundaries<2>(0.2f, 25.0f, 0.5f);
+	for (size_t i = 0; i < fitted.size(); i++)
+	{
+		CHECK_NEAR(fitted[i], expected[i], 1e-4f);
+	}
+}
+
+TEST(FitCascadesFallsBackWithoutReduction)
+{
+	// An empty reduction leaves min above max, and NaN must not reach the splits
+	const auto expected = ComputeCascadeBoundaries<3>(0.2f, 25.0f, 0.5f);
+	for (const auto& fitted : { FitCascadeBoundaries<3>(FLT_MAX, 0.0f, 0.2f, 25.0f, 0.5f, 0.1f),
+		FitCascadeBoundaries<3>(NAN, NAN, 0.2f, 25.0f, 0.5f, 0.1f) })
+	{
+		for (size_t i = 0; i < fitted.size(); i++)
+		{
+			CHECK_NEAR(fitted[i], expected[i], 1e-4f);
+		}
+	}
+}
\ No newline at end of file
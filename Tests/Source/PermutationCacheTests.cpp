@@ -0,0 +1,180 @@
+#include "stdafx.h"
+
+#include "Test.h"
+#include "PermutationCache.h"
+
+using namespace dx;
+
+namespace
+{
+	// Stands in for the device. Compiling a key returns the key itself, and keys in the blocked
+	// set wait for the gate to open so that a test can observe the fallback.
+	class FakeBackend
+	{
+	public:
+		PermutationCache<uint32_t>::CompileFunc GetCompiler()
+		{
+			return [this](uint32_t key)
+			{
+				m_compileCount++;
+				if (m_blocked.count(key) > 0)
+				{
+					m_gate.wait();
+				}
+				if (m_failing.count(key) > 0)
+				{
+					throw std::runtime_error("Fake compile error");
+				}
+				return std::make_shared<const uint32_t>(key);
+			};
+		}
+
+		void Block(uint32_t key) { m_blocked.insert(key); }
+		void Open() { m_open.set_value(); }
+
+		// Only changed while nothing is compiling
+		void SetFailing(uint32_t key, bool failing)
+		{
+			if (failing)
+			{
+				m_failing.insert(key);
+			}
+			else
+			{
+				m_failing.erase(key);
+			}
+		}
+
+		int GetCompileCount() const { return m_compileCount; }
+
+	private:
+		std::set<uint32_t> m_blocked;
+		std::set<uint32_t> m_failing;
+		std::promise<void> m_open;
+		std::shared_future<void> m_gate = m_open.get_future().share();
+		std::atomic<int> m_compileCount = 0;
+	};
+
+	uint32_t GetValue(const PermutationHandle<uint32_t>& handle)
+	{
+		auto pValue = handle.Get();
+		return pValue ? *pValue : ~0u;
+	}
+}
+
+TEST(NoFallbackWithoutReadyPermutations)
+{
+	uint32_t fallback = 0;
+	CHECK(!SelectFallback(0b111, 0, {}, &fallback));
+}
+
+TEST(FallbackNeverEnablesExtraFeatures)
+{
+	// 0b100 would read a resource the request does not bind
+	uint32_t fallback = 0;
+	CHECK(!SelectFallback(0b011, 0, { 0b100, 0b111 }, &fallback));
+	CHECK(SelectFallback(0b011, 0, { 0b100, 0b000 }, &fallback));
+	CHECK(fallback == 0b000);
+}
+
+TEST(FallbackMatchesRequiredBits)
+{
+	uint32_t fallback = 0;
+	CHECK(!SelectFallback(0b1001, 0b1000, { 0b0001, 0b0000 }, &fallback));
+	CHECK(SelectFallback(0b1011, 0b1000, { 0b0011, 0b1000 }, &fallback));
+	CHECK(fallback == 0b1000);
+}
+
+TEST(FallbackSharesMostFeatures)
+{
+	uint32_t fallback = 0;
+	CHECK(SelectFallback(0b1111, 0, { 0b0001, 0b0111, 0b0011 }, &fallback));
+	CHECK(fallback == 0b0111);
+}
+
+TEST(PermutationCompiledOnce)
+{
+	TaskPool pool(2);
+	FakeBackend backend;
+	PermutationCache<uint32_t> cache(pool, backend.GetCompiler(), 0);
+
+	auto pFirst = cache.Request(5);
+	auto pSecond = cache.Request(5);
+	cache.Wait();
+	auto pReady = cache.Request(5);
+
+	CHECK(backend.GetCompileCount() == 1);
+	for (const auto& pHandle : { pFirst, pSecond, pReady })
+	{
+		CHECK(pHandle->IsFinal());
+		CHECK(GetValue(*pHandle) == 5);
+	}
+}
+
+TEST(FallbackReplacedOnceCompiled)
+{
+	TaskPool pool(2);
+	FakeBackend backend;
+	PermutationCache<uint32_t> cache(pool, backend.GetCompiler(), 0);
+	cache.Request(0b001);
+	cache.Wait();
+
+	backend.Block(0b011);
+	auto pHandle = cache.Request(0b011);
+	CHECK(!pHandle->IsFinal());
+	CHECK(GetValue(*pHandle) == 0b001);
+
+	backend.Open();
+	cache.Wait();
+	CHECK(pHandle->IsFinal());
+	CHECK(GetValue(*pHandle) == 0b011);
+}
+
+TEST(BetterFallbackTakesOver)
+{
+	// A permutation finishing while another is still compiling becomes its stand-in
+	TaskPool pool(2);
+	FakeBackend backend;
+	PermutationCache<uint32_t> cache(pool, backend.GetCompiler(), 0);
+	cache.Request(0b000);
+	cache.Wait();
+
+	backend.Block(0b111);
+	auto pHandle = cache.Request(0b111);
+	CHECK(GetValue(*pHandle) == 0b000);
+
+	cache.Request(0b110);
+	cache.GetFuture(0b110).wait();
+	CHECK(!pHandle->IsFinal());
+	CHECK(GetValue(*pHandle) == 0b110);
+
+	backend.Open();
+	cache.Wait();
+	CHECK(GetValue(*pHandle) == 0b111);
+}
+
+TEST(FailedPermutationRetried)
+{
+	TaskPool pool(2);
+	FakeBackend backend;
+	PermutationCache<uint32_t> cache(pool, backend.GetCompiler(), 0);
+	cache.Request(0b01);
+	cache.Wait();
+
+	// The handle keeps its fallback, and a later request does not compile again
+	backend.SetFailing(0b11, true);
+	auto pHandle = cache.Request(0b11);
+	cache.Wait();
+	cache.Request(0b11);
+	cache.Wait();
+	CHECK(backend.GetCompileCount() == 2);
+	CHECK(!pHandle->IsFinal());
+	CHECK(GetValue(*pHandle) == 0b01);
+
+	backend.SetFailing(0b11, false);
+	CHECK(cache.RetryFailed() == 1);
+	cache.Wait();
+	CHECK(pHandle->IsFinal());
+	CHECK(GetValue(*pHandle) == 0b11);
+	CHECK(cache.RetryFailed() == 0);
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "stdafx.h"
+
+#include "Test.h"
+#include "ShadowMoments.h"
+
+using namespace dx;
+using DirectX::XMFLOAT2;
+
+namespace
+{
+	std::vector<XMFLOAT2> MakeImpulse(unsigned int width, unsigned int height, unsigned int x, unsigned int y,
+		XMFLOAT2 value)
+	{
+		std::vector<XMFLOAT2> image(static_cast<size_t>(width) * height, XMFLOAT2(0.0f, 0.0f));
+		image[y * width + x] = value;
+		return image;
+	}
+}
+
+TEST(BlurKeepsConstantImage)
+{
+	const std::vector<XMFLOAT2> image(6 * 4, XMFLOAT2(2.0f, 4.0f));
+	for (bool horizontal : { true, false })
+	{
+		for (const auto& moments : BoxBlurMoments(image, 6, 4, horizontal))
+		{
+			CHECK_NEAR(moments.x, 2.0f, 1e-5f);
+			CHECK_NEAR(moments.y, 4.0f, 1e-5f);
+		}
+	}
+}
+
+TEST(BlurSpreadsImpulseAlongRow)
+{
+	const auto blurred = BoxBlurMoments(MakeImpulse(7, 1, 3, 0, XMFLOAT2(5.0f, 25.0f)), 7, 1, true, 2);
+	for (unsigned int x = 0; x < 7; x++)
+	{
+		const bool covered = x >= 1 && x <= 5;
+		CHECK_NEAR(blurred[x].x, covered ? 1.0f : 0.0f, 1e-5f);
+		CHECK_NEAR(blurred[x].y, covered ? 5.0f : 0.0f, 1e-5f);
+	}
+}
+
+TEST(BlurClampsAtEdges)
+{
+	// The edge texel is repeated for taps outside the image, in both directions
+	const float expected[] = { 3.0f / 5.0f, 2.0f / 5.0f, 1.0f / 5.0f, 0.0f, 0.0f };
+	const auto horizontal = BoxBlurMoments(MakeImpulse(5, 1, 0, 0, XMFLOAT2(1.0f, 1.0f)), 5, 1, true, 2);
+	const auto vertical = BoxBlurMoments(MakeImpulse(1, 5, 0, 0, XMFLOAT2(1.0f, 1.0f)), 1, 5, false, 2);
+	for (unsigned int i = 0; i < 5; i++)
+	{
+		CHECK_NEAR(horizontal[i].x, expected[i], 1e-5f);
+		CHECK_NEAR(vertical[i].x, expected[i], 1e-5f);
+	}
+}
+
+TEST(SeparableBlurCoversSquare)
+{
+	const auto horizontal = BoxBlurMoments(MakeImpulse(5, 5, 2, 2, XMFLOAT2(9.0f, 81.0f)), 5, 5, true, 1);
+	const auto blurred = BoxBlurMoments(horizontal, 5, 5, false, 1);
+	for (unsigned int y = 0; y < 5; y++)
+	{
+		for (unsigned int x = 0; x < 5; x++)
+		{
+			const bool covered = x >= 1 && x <= 3 && y >= 1 && y <= 3;
+			CHECK_NEAR(blurred[y * 5 + x].x, covered ? 1.0f : 0.0f, 1e-5f);
+			CHECK_NEAR(blurred[y * 5 + x].y, covered ? 9.0f : 0.0f, 1e-4f);
+		}
+	}
+}
+
+TEST(MomentVisibility)
+{
+	// Receivers in front of the occluder are lit, and those well behind it are shadowed
+	const auto moments = ComputeMoments(0.3f);
+	CHECK_NEAR(EVSMVisibility(moments, 0.3f), 1.0f, 1e-5f);
+	CHECK_NEAR(EVSMVisibility(moments, 0.1f), 1.0f, 1e-5f);
+	CHECK(EVSMVisibility(moments, 0.8f) < 0.01f);
+}
\ No newline at end of file
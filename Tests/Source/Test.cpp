@@ -0,0 +1,52 @@
+// Runs every test case and returns the number that failed
+
+#include "stdafx.h"
+
+#include "Test.h"
+
+namespace
+{
+	size_t g_failures = 0;
+}
+
+namespace dx::test
+{
+	std::vector<TestCase>& GetTests()
+	{
+		static std::vector<TestCase> tests;
+		return tests;
+	}
+
+	void ReportFailure(const char* expression, const char* file, int line)
+	{
+		std::cerr << file << "(" << line << "): CHECK(" << expression << ") failed\n";
+		g_failures++;
+	}
+}
+
+int main()
+{
+	using namespace dx::test;
+
+	int failedTests = 0;
+	for (const auto& test : GetTests())
+	{
+		const size_t failuresBefore = g_failures;
+		try
+		{
+			test.func();
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << test.name << " threw: " << e.what() << "\n";
+			g_failures++;
+		}
+
+		const bool passed = g_failures == failuresBefore;
+		std::cout << (passed ? "[  OK  ] " : "[ FAIL ] ") << test.name << "\n";
+		failedTests += passed ? 0 : 1;
+	}
+
+	std::cout << GetTests().size() - failedTests << " of " << GetTests().size() << " tests passed\n";
+	return failedTests;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+// Minimal test runner. TEST defines a test case that main runs, and CHECK records a failure
+// without stopping the test, so one run reports every broken expectation.
+namespace dx::test
+{
+	using TestFunc = void (*)();
+
+	struct TestCase
+	{
+		const char* name;
+		TestFunc func;
+	};
+
+	std::vector<TestCase>& GetTests();
+	void ReportFailure(const char* expression, const char* file, int line);
+
+	struct Registrar
+	{
+		Registrar(const char* name, TestFunc func)
+		{
+			GetTests().push_back({ name, func });
+		}
+	};
+}
+
+#define TEST(name) \
+	static void name(); \
+	static const dx::test::Registrar name##Registrar(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do \
+	{ \
+		if (!(expression)) \
+		{ \
+			dx::test::ReportFailure(#expression, __FILE__, __LINE__); \
+		} \
+	} while (false)
+
+#define CHECK_NEAR(actual, expected, tolerance) CHECK(std::abs((actual) - (expected)) <= (tolerance))
\ No newline at end of file
@@ -0,0 +1,424 @@
+#include "stdafx.h"
+
+#include "Test.h"
+#include "TextureStreamer.h"
+
+using namespace dx;
+
+namespace
+{
+	constexpr uint32_t WIDTH = 64;
+	constexpr uint32_t HEIGHT = 32;
+	constexpr uint32_t MIP_COUNT = 7;
+	constexpr size_t LEGACY_HEADER_SIZE = 4 + 124;
+	constexpr size_t DX10_HEADER_SIZE = LEGACY_HEADER_SIZE + 20;
+
+	constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) |
+			(static_cast<uint32_t>(d) << 24);
+	}
+
+	// DDS_PIXELFORMAT without its size, which is always 32
+	struct PixelFormat
+	{
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t bitCount;
+		uint32_t masks[4];
+	};
+
+	constexpr uint32_t DDPF_FOURCC = 0x4;
+	constexpr uint32_t DDPF_RGBA = 0x41;
+	constexpr PixelFormat FOURCC_DX10 = { DDPF_FOURCC, MakeFourCC('D', 'X', '1', '0') };
+	constexpr PixelFormat NO_LEGACY_FORMAT = {};
+
+	// A format the asset pipeline produces. Block compressed formats give the bytes of a 4x4
+	// block, others the bytes of a texel. Formats the legacy header can describe give its pixel
+	// format and the format it reads back as, which drops sRGB.
+	struct FormatCase
+	{
+		DXGI_FORMAT format;
+		bool blockCompressed;
+		size_t bytes;
+		PixelFormat legacy;
+		DXGI_FORMAT legacyFormat;
+	};
+
+	const FormatCase g_formats[] = {
+		{ DXGI_FORMAT_BC1_UNORM, true, 8, { DDPF_FOURCC, MakeFourCC('D', 'X', 'T', '1') }, DXGI_FORMAT_BC1_UNORM },
+		{ DXGI_FORMAT_BC1_UNORM_SRGB, true, 8, { DDPF_FOURCC, MakeFourCC('D', 'X', 'T', '1') }, DXGI_FORMAT_BC1_UNORM },
+		{ DXGI_FORMAT_BC3_UNORM_SRGB, true, 16, { DDPF_FOURCC, MakeFourCC('D', 'X', 'T', '5') }, DXGI_FORMAT_BC3_UNORM },
+		{ DXGI_FORMAT_BC5_UNORM, true, 16, { DDPF_FOURCC, MakeFourCC('A', 'T', 'I', '2') }, DXGI_FORMAT_BC5_UNORM },
+		{ DXGI_FORMAT_BC7_UNORM, true, 16, NO_LEGACY_FORMAT, DXGI_FORMAT_UNKNOWN },
+		{ DXGI_FORMAT_R8G8B8A8_UNORM, false, 4, { DDPF_RGBA, 0, 32, { 0xff, 0xff00, 0xff0000, 0xff000000 } },
+			DXGI_FORMAT_R8G8B8A8_UNORM },
+		{ DXGI_FORMAT_R16G16_FLOAT, false, 4, { DDPF_FOURCC, 112 }, DXGI_FORMAT_R16G16_FLOAT },
+		{ DXGI_FORMAT_R16G16B16A16_FLOAT, false, 8, { DDPF_FOURCC, 113 }, DXGI_FORMAT_R16G16B16A16_FLOAT },
+		{ DXGI_FORMAT_R32G32B32A32_FLOAT, false, 16, { DDPF_FOURCC, 116 }, DXGI_FORMAT_R32G32B32A32_FLOAT },
+		{ DXGI_FORMAT_R32G32_FLOAT, false, 8, { DDPF_FOURCC, 115 }, DXGI_FORMAT_R32G32_FLOAT },
+	};
+
+	// Slice pitch of a mip, worked out independently of DirectXTex. Blocks never shrink below
+	// one, and texels below one.
+	size_t GetExpectedSlicePitch(const FormatCase& format, uint32_t mip)
+	{
+		const size_t width = std::max(1u, WIDTH >> mip);
+		const size_t height = std::max(1u, HEIGHT >> mip);
+		if (format.blockCompressed)
+		{
+			return std::max<size_t>(1, (width + 3) / 4) * std::max<size_t>(1, (height + 3) / 4) * format.bytes;
+		}
+		return width * height * format.bytes;
+	}
+
+	size_t GetExpectedDataSize(const FormatCase& format)
+	{
+		size_t size = 0;
+		for (uint32_t mip = 0; mip < MIP_COUNT; mip++)
+		{
+			size += GetExpectedSlicePitch(format, mip);
+		}
+		return size;
+	}
+
+	void Append(std::vector<uint8_t>* pData, uint32_t value)
+	{
+		const auto* pBytes = reinterpret_cast<const uint8_t*>(&value);
+		pData->insert(pData->end(), pBytes, pBytes + sizeof(value));
+	}
+
+	// A DDS file of a WIDTH x HEIGHT texture with every mip. The DX10 header is used when the
+	// pixel format is FOURCC_DX10. Each mip is filled with its index, so its bytes can be found.
+	std::vector<uint8_t> CreateDDSFile(const FormatCase& format, const PixelFormat& pixelFormat)
+	{
+		std::vector<uint8_t> data;
+		Append(&data, MakeFourCC('D', 'D', 'S', ' '));
+		Append(&data, 124);
+		Append(&data, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000);	// Caps, height, width, pixel format, mip count
+		Append(&data, HEIGHT);
+		Append(&data, WIDTH);
+		Append(&data, 0);		// Pitch or linear size
+		Append(&data, 0);		// Depth
+		Append(&data, MIP_COUNT);
+		for (int i = 0; i < 11; i++)
+		{
+			Append(&data, 0);
+		}
+		Append(&data, 32);
+		Append(&data, pixelFormat.flags);
+		Append(&data, pixelFormat.fourCC);
+		Append(&data, pixelFormat.bitCount);
+		for (uint32_t mask : pixelFormat.masks)
+		{
+			Append(&data, mask);
+		}
+		Append(&data, 0x1000 | 0x400000 | 0x8);	// Texture, mipmap, complex
+		for (int i = 0; i < 4; i++)
+		{
+			Append(&data, 0);
+		}
+
+		if (pixelFormat.fourCC == FOURCC_DX10.fourCC)
+		{
+			Append(&data, format.format);
+			Append(&data, 3);		// Texture2D
+			Append(&data, 0);		// Misc flags
+			Append(&data, 1);		// Array size
+			Append(&data, 0);		// Misc flags 2
+		}
+
+		for (uint32_t mip = 0; mip < MIP_COUNT; mip++)
+		{
+			data.insert(data.end(), GetExpectedSlicePitch(format, mip), static_cast<uint8_t>(mip));
+		}
+		return data;
+	}
+
+	// Wraps a DDS file in a compressed container, with one uncompressed chunk per mip
+	std::vector<uint8_t> CreateContainer(const std::vector<uint8_t>& ddsFile, const std::vector<MipLayout>& mips)
+	{
+		const uint32_t ddsHeaderSize = static_cast<uint32_t>(mips[0].offset);
+		const ContainerHeader header{ CONTAINER_MAGIC, CONTAINER_VERSION, ddsHeaderSize,
+			static_cast<uint32_t>(mips.size()) };
+
+		std::vector<ContainerChunk> chunks;
+		uint64_t fileOffset = sizeof(header) + ddsHeaderSize + mips.size() * sizeof(ContainerChunk);
+		for (const auto& mip : mips)
+		{
+			const auto size = static_cast<uint32_t>(mip.slicePitch);
+			chunks.push_back({ mip.offset, fileOffset, size, size });
+			fileOffset += size;
+		}
+
+		std::vector<uint8_t> container(reinterpret_cast<const uint8_t*>(&header),
+			reinterpret_cast<const uint8_t*>(&header) + sizeof(header));
+		container.insert(container.end(), ddsFile.begin(), ddsFile.begin() + ddsHeaderSize);
+		container.insert(container.end(), reinterpret_cast<const uint8_t*>(chunks.data()),
+			reinterpret_cast<const uint8_t*>(chunks.data() + chunks.size()));
+		container.insert(container.end(), ddsFile.begin() + ddsHeaderSize, ddsFile.end());
+		return container;
+	}
+
+	// Checks the parsed layout of a file with the given header size against the expected
+	// pitches, and that the loaders skip exactly the dropped mips
+	void CheckLayout(const FormatCase& format, const DirectX::TexMetadata& metadata, const std::vector<MipLayout>& mips,
+		size_t headerSize, const std::vector<uint8_t>& ddsFile)
+	{
+		CHECK(metadata.width == WIDTH && metadata.height == HEIGHT && metadata.mipLevels == MIP_COUNT);
+		CHECK(mips.size() == MIP_COUNT);
+		if (mips.size() != MIP_COUNT)
+		{
+			return;
+		}
+
+		uint64_t offset = headerSize;
+		for (uint32_t mip = 0; mip < MIP_COUNT; mip++)
+		{
+			CHECK(mips[mip].offset == offset);
+			CHECK(mips[mip].slicePitch == GetExpectedSlicePitch(format, mip));
+			CHECK(ddsFile[static_cast<size_t>(mips[mip].offset)] == static_cast<uint8_t>(mip));
+			offset += GetExpectedSlicePitch(format, mip);
+		}
+		CHECK(offset == ddsFile.size());
+
+		// 64x32 with one mip skipped and at most 8 across keeps 8x4 and smaller
+		constexpr uint32_t SKIP_MIPS = 1;
+		constexpr uint32_t MAX_DIMENSION = 8;
+		const uint32_t firstMip = GetFirstLoadedMip(WIDTH, HEIGHT, MIP_COUNT, SKIP_MIPS, MAX_DIMENSION);
+		CHECK(firstMip == 3);
+
+		uint64_t droppedBytes = 0;
+		for (uint32_t mip = 0; mip < firstMip; mip++)
+		{
+			droppedBytes += GetExpectedSlicePitch(format, mip);
+		}
+		CHECK(mips[firstMip].offset - mips[0].offset == droppedBytes);
+
+		// DDSTextureLoader keeps the mips with no dimension above maxsize, and skips past the
+		// bytes of the others
+		const size_t maxSize = GetLoaderMaxSize(metadata, SKIP_MIPS, MAX_DIMENSION);
+		uint64_t loaderSkipped = 0;
+		uint32_t loaderFirstMip = 0;
+		while (loaderFirstMip < MIP_COUNT && (std::max(1u, WIDTH >> loaderFirstMip) > maxSize ||
+			std::max(1u, HEIGHT >> loaderFirstMip) > maxSize))
+		{
+			loaderSkipped += mips[loaderFirstMip].slicePitch;
+			loaderFirstMip++;
+		}
+		CHECK(loaderFirstMip == firstMip);
+		CHECK(loaderSkipped == droppedBytes);
+		CHECK(GetLoaderMaxSize(metadata, 0, 0) == 0);
+	}
+}
+
+TEST(EvictLeastRecentlyDrawnFirst)
+{
+	const std::vector<EvictionCandidate> candidates = { { 5, 100 }, { 2, 100 }, { 9, 100 } };
+	CHECK(SelectEvictions(candidates, 150) == std::vector<size_t>({ 1, 0 }));
+}
+
+TEST(EvictLargestAmongSameFrame)
+{
+	const std::vector<EvictionCandidate> candidates = { { 3, 50 }, { 3, 200 }, { 3, 100 } };
+	CHECK(SelectEvictions(candidates, 250) == std::vector<size_t>({ 1, 2 }));
+}
+
+TEST(EvictOnlyWhatIsNeeded)
+{
+	const std::vector<EvictionCandidate> candidates = { { 1, 100 }, { 2, 100 } };
+	CHECK(SelectEvictions(candidates, 0).empty());
+	CHECK(SelectEvictions(candidates, 100) == std::vector<size_t>({ 0 }));
+	CHECK(SelectEvictions({}, 100).empty());
+}
+
+TEST(EvictEverythingWhenShort)
+{
+	const std::vector<EvictionCandidate> candidates = { { 4, 10 }, { 1, 20 }, { 4, 30 } };
+	CHECK(SelectEvictions(candidates, 1000) == std::vector<size_t>({ 1, 2, 0 }));
+}
+
+TEST(MipLayoutOfBlockCompressedChain)
+{
+	// Mips smaller than a block still take a whole one
+	std::vector<MipLayout> mips;
+	CHECK(GetMipLayout(DXGI_FORMAT_BC1_UNORM, 8, 8, 4, 128, &mips));
+	CHECK(mips.size() == 4);
+	if (mips.size() == 4)
+	{
+		const MipLayout expected[] = { { 128, 16, 32 }, { 160, 8, 8 }, { 168, 8, 8 }, { 176, 8, 8 } };
+		for (size_t i = 0; i < 4; i++)
+		{
+			CHECK(mips[i].offset == expected[i].offset);
+			CHECK(mips[i].rowPitch == expected[i].rowPitch);
+			CHECK(mips[i].slicePitch == expected[i].slicePitch);
+		}
+	}
+}
+
+TEST(MipLayoutOfRectangularChain)
+{
+	// The short side stops at one texel while the long side keeps halving
+	std::vector<MipLayout> mips;
+	CHECK(GetMipLayout(DXGI_FORMAT_R8G8B8A8_UNORM, 4, 1, 3, 0, &mips));
+	CHECK(mips.size() == 3);
+	if (mips.size() == 3)
+	{
+		CHECK(mips[0].offset == 0 && mips[0].slicePitch == 16);
+		CHECK(mips[1].offset == 16 && mips[1].slicePitch == 8);
+		CHECK(mips[2].offset == 24 && mips[2].slicePitch == 4);
+	}
+}
+
+TEST(MipLayoutRejectsUnknownFormat)
+{
+	std::vector<MipLayout> mips;
+	CHECK(!GetMipLayout(DXGI_FORMAT_UNKNOWN, 64, 64, 7, 0, &mips));
+}
+
+TEST(FirstLoadedMipWithoutLimits)
+{
+	CHECK(GetFirstLoadedMip(1024, 512, 11, 0, 0) == 0);
+	CHECK(GetFirstLoadedMip(1024, 512, 0, 2, 0) == 0);
+}
+
+TEST(FirstLoadedMipSkipsTopMips)
+{
+	CHECK(GetFirstLoadedMip(1024, 512, 11, 2, 0) == 2);
+
+	// The smallest mip is always kept
+	CHECK(GetFirstLoadedMip(1024, 512, 11, 20, 0) == 10);
+}
+
+TEST(FirstLoadedMipFitsMaxDimension)
+{
+	CHECK(GetFirstLoadedMip(1024, 512, 11, 0, 256) == 2);
+	CHECK(GetFirstLoadedMip(512, 1024, 11, 0, 300) == 2);
+	CHECK(GetFirstLoadedMip(1024, 1024, 1, 0, 16) == 0);
+}
+
+TEST(FirstLoadedMipUsesStricterLimit)
+{
+	CHECK(GetFirstLoadedMip(1024, 1024, 11, 1, 1024) == 1);
+	CHECK(GetFirstLoadedMip(1024, 1024, 11, 1, 128) == 3);
+}
+
+TEST(ParseDX10HeaderOfEveryFormat)
+{
+	for (const auto& format : g_formats)
+	{
+		const auto file = CreateDDSFile(format, FOURCC_DX10);
+		CHECK(file.size() == DX10_HEADER_SIZE + GetExpectedDataSize(format));
+
+		DirectX::TexMetadata metadata{};
+		std::vector<MipLayout> mips;
+		CHECK(ParseStreamableLayout(file.data(), DX10_HEADER_SIZE, file.size(), &metadata, &mips));
+		CHECK(metadata.format == format.format);
+		CheckLayout(format, metadata, mips, DX10_HEADER_SIZE, file);
+
+		// The pixel data must fill the rest of the file exactly
+		CHECK(!ParseStreamableLayout(file.data(), DX10_HEADER_SIZE, file.size() + 1, &metadata, &mips));
+		CHECK(!ParseStreamableLayout(file.data(), DX10_HEADER_SIZE, file.size() - 1, &metadata, &mips));
+	}
+}
+
+TEST(ParseLegacyHeaderOfEveryFormat)
+{
+	for (const auto& format : g_formats)
+	{
+		if (format.legacyFormat == DXGI_FORMAT_UNKNOWN)
+		{
+			continue;
+		}
+		const auto file = CreateDDSFile(format, format.legacy);
+		CHECK(file.size() == LEGACY_HEADER_SIZE + GetExpectedDataSize(format));
+
+		// Readers pass the first DX10_HEADER_SIZE bytes whatever the header, and the file size
+		// tells that there is no DX10 extension
+		DirectX::TexMetadata metadata{};
+		std::vector<MipLayout> mips;
+		CHECK(ParseStreamableLayout(file.data(), DX10_HEADER_SIZE, file.size(), &metadata, &mips));
+		CHECK(metadata.format == format.legacyFormat);
+		CheckLayout(format, metadata, mips, LEGACY_HEADER_SIZE, file);
+		CHECK(!ParseStreamableLayout(file.data(), DX10_HEADER_SIZE, file.size() + 1, &metadata, &mips));
+	}
+}
+
+TEST(ParseWholeFileOfEveryFormat)
+{
+	for (const auto& format : g_formats)
+	{
+		const auto file = CreateDDSFile(format, FOURCC_DX10);
+		DirectX::TexMetadata metadata{};
+		std::vector<MipLayout> mips;
+		std::vector<ContainerChunk> chunks = { {} };
+		CHECK(ParseStreamableFile(file.data(), file.size(), &metadata, &mips, &chunks));
+		CHECK(chunks.empty());
+		CheckLayout(format, metadata, mips, DX10_HEADER_SIZE, file);
+	}
+}
+
+TEST(ParseContainerOfEveryFormat)
+{
+	for (const auto& format : g_formats)
+	{
+		const auto file = CreateDDSFile(format, FOURCC_DX10);
+		DirectX::TexMetadata metadata{};
+		std::vector<MipLayout> mips;
+		std::vector<ContainerChunk> chunks;
+		CHECK(ParseStreamableLayout(file.data(), DX10_HEADER_SIZE, file.size(), &metadata, &mips));
+		const auto container = CreateContainer(file, mips);
+
+		// Mip offsets are into the DDS file the container holds
+		CHECK(ParseStreamableFile(container.data(), container.size(), &metadata, &mips, &chunks));
+		CHECK(metadata.format == format.format);
+		CheckLayout(format, metadata, mips, DX10_HEADER_SIZE, file);
+		CHECK(chunks.size() == MIP_COUNT);
+		for (size_t i = 0; i < std::min(chunks.size(), mips.size()); i++)
+		{
+			CHECK(chunks[i].dataOffset == mips[i].offset && chunks[i].size == mips[i].slicePitch);
+			CHECK(container[static_cast<size_t>(chunks[i].fileOffset)] == static_cast<uint8_t>(i));
+		}
+	}
+}
+
+TEST(ParseContainerRejectsDamagedChunkTable)
+{
+	const auto& format = g_formats[0];
+	const auto file = CreateDDSFile(format, FOURCC_DX10);
+	DirectX::TexMetadata metadata{};
+	std::vector<MipLayout> mips;
+	std::vector<ContainerChunk> chunks;
+	CHECK(ParseStreamableLayout(file.data(), DX10_HEADER_SIZE, file.size(), &metadata, &mips));
+	auto container = CreateContainer(file, mips);
+
+	// Moves the second chunk so the chunks no longer cover the pixel data in order
+	ContainerChunk chunk{};
+	const size_t chunkOffset = sizeof(ContainerHeader) + DX10_HEADER_SIZE + sizeof(ContainerChunk);
+	memcpy(&chunk, container.data() + chunkOffset, sizeof(chunk));
+	chunk.dataOffset++;
+	memcpy(container.data() + chunkOffset, &chunk, sizeof(chunk));
+
+	bool threw = false;
+	try
+	{
+		ParseStreamableFile(container.data(), container.size(), &metadata, &mips, &chunks);
+	}
+	catch (const std::runtime_error&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+
+	// Truncated containers are caught before the chunk table is read
+	threw = false;
+	try
+	{
+		ParseStreamableFile(container.data(), sizeof(ContainerHeader) + DX10_HEADER_SIZE, &metadata, &mips, &chunks);
+	}
+	catch (const std::runtime_error&)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+}
\ No newline at end of file